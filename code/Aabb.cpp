@@ -190,3 +190,67 @@ Aabb aabbFromConvexCollider(ConvexHullColliderComponent* collider)
     return result;
 }
 
+Aabb aabbFromRenderComponents(ComponentGroup<RenderComponent>& rcg)
+{
+    Vec3 minPoint = Vec3(FLT_MAX);
+    Vec3 maxPoint = Vec3(-FLT_MAX);
+    
+    for (uint32 i = 0; i < rcg.numComponents; i++)
+    {
+        RenderComponent* it = &rcg[i];
+        Aabb bounds = aabbFromRenderComponent(it);
+        Vec3 boundsMin = bounds.center - bounds.halfDim;
+        Vec3 boundsMax = bounds.center + bounds.halfDim;
+
+        minPoint = componentwiseMin(minPoint, boundsMin);
+        maxPoint = componentwiseMax(maxPoint, boundsMax);
+    }
+
+    Vec3 aabbCenter = (maxPoint + minPoint) / 2;
+    Vec3 halfDims = (maxPoint - minPoint) / 2;
+
+    Aabb result = Aabb(aabbCenter, halfDims);
+    return result;
+}
+
+Aabb aabbFromColliders(ComponentGroup<ColliderComponent>& colliders)
+{
+    Vec3 minPoint = Vec3(FLT_MAX);
+    Vec3 maxPoint = Vec3(-FLT_MAX);
+
+    for (uint32 i = 0; i < colliders.numComponents; i++)    
+    {
+        ColliderComponent* it = &colliders[i];
+
+        Aabb bounds = aabbFromCollider(it);
+        Vec3 boundsMin = bounds.center - bounds.halfDim;
+        Vec3 boundsMax = bounds.center + bounds.halfDim;
+
+        minPoint = componentwiseMin(minPoint, boundsMin);
+        maxPoint = componentwiseMax(maxPoint, boundsMax);
+    }
+
+    Aabb result = aabbFromMinMax(minPoint, maxPoint);
+    return result;
+}
+
+Aabb aabbFromConvexColliders(ComponentGroup<ConvexHullColliderComponent>& colliders)
+{
+    Vec3 minPoint = Vec3(FLT_MAX);
+    Vec3 maxPoint = Vec3(-FLT_MAX);
+
+    for (uint32 i = 0; i < colliders.numComponents; i++)    
+    {
+        ConvexHullColliderComponent* it = &colliders[i];
+
+        Aabb bounds = aabbFromConvexCollider(it);
+        Vec3 boundsMin = bounds.center - bounds.halfDim;
+        Vec3 boundsMax = bounds.center + bounds.halfDim;
+
+        minPoint = componentwiseMin(minPoint, boundsMin);
+        maxPoint = componentwiseMax(maxPoint, boundsMax);
+    }
+
+    Aabb result = aabbFromMinMax(minPoint, maxPoint);
+    return result;
+}
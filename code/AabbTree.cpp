@@ -0,0 +1,302 @@
+#include "AabbTree.h"
+
+namespace
+{
+    float32 surfaceArea(Vec3 minPoint, Vec3 maxPoint)
+    {
+        Vec3 d = maxPoint - minPoint;
+        return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    float32 combinedSurfaceArea(AabbTreeNode* a, AabbTreeNode* b)
+    {
+        return surfaceArea(componentwiseMin(a->minPoint, b->minPoint), componentwiseMax(a->maxPoint, b->maxPoint));
+    }
+
+    bool contains(AabbTreeNode* node, Vec3 minPoint, Vec3 maxPoint)
+    {
+        return node->minPoint.x <= minPoint.x && node->minPoint.y <= minPoint.y && node->minPoint.z <= minPoint.z &&
+               node->maxPoint.x >= maxPoint.x && node->maxPoint.y >= maxPoint.y && node->maxPoint.z >= maxPoint.z;
+    }
+
+    int32 allocateNode(DynamicAabbTree* tree)
+    {
+        int32 index;
+
+        if (tree->freeList == AABB_TREE_NULL_NODE)
+        {
+            tree->nodes.push_back(AabbTreeNode());
+            index = tree->nodes.size() - 1;
+        }
+        else
+        {
+            index = tree->freeList;
+            tree->freeList = tree->nodes[index].nextFree;
+        }
+
+        AabbTreeNode* node = &tree->nodes[index];
+        node->userData = nullptr;
+        node->parent = AABB_TREE_NULL_NODE;
+        node->child1 = AABB_TREE_NULL_NODE;
+        node->child2 = AABB_TREE_NULL_NODE;
+        node->height = 0;
+
+        return index;
+    }
+
+    void freeNode(DynamicAabbTree* tree, int32 index)
+    {
+        AabbTreeNode* node = &tree->nodes[index];
+        node->nextFree = tree->freeList;
+        node->height = -1;
+        tree->freeList = index;
+    }
+
+    void fitToChildren(DynamicAabbTree* tree, int32 index)
+    {
+        AabbTreeNode* node = &tree->nodes[index];
+        AabbTreeNode* child1 = &tree->nodes[node->child1];
+        AabbTreeNode* child2 = &tree->nodes[node->child2];
+
+        node->minPoint = componentwiseMin(child1->minPoint, child2->minPoint);
+        node->maxPoint = componentwiseMax(child1->maxPoint, child2->maxPoint);
+        node->height = 1 + (child1->height > child2->height ? child1->height : child2->height);
+    }
+
+    void replaceChild(DynamicAabbTree* tree, int32 parent, int32 oldChild, int32 newChild)
+    {
+        if (parent == AABB_TREE_NULL_NODE)
+        {
+            tree->root = newChild;
+            return;
+        }
+
+        AabbTreeNode* parentNode = &tree->nodes[parent];
+        if (parentNode->child1 == oldChild)
+        {
+            parentNode->child1 = newChild;
+        }
+        else
+        {
+            assert(parentNode->child2 == oldChild);
+            parentNode->child2 = newChild;
+        }
+    }
+
+    //
+    // If one of a's children is more than 1 level taller than the other, rotate it up into a's place and hand its
+    // shorter child down to a. Returns the index of the node now sitting where a was.
+    //
+    int32 balance(DynamicAabbTree* tree, int32 a)
+    {
+        AabbTreeNode* nodeA = &tree->nodes[a];
+        if (nodeA->isLeaf() || nodeA->height < 2) return a;
+
+        int32 b = nodeA->child1;
+        int32 c = nodeA->child2;
+        int32 heightDifference = tree->nodes[c].height - tree->nodes[b].height;
+
+        if (heightDifference > 1 || heightDifference < -1)
+        {
+            // up is the taller child, stay is the other one
+            bool rotateC = heightDifference > 1;
+            int32 up = rotateC ? c : b;
+
+            AabbTreeNode* nodeUp = &tree->nodes[up];
+            int32 upChild1 = nodeUp->child1;
+            int32 upChild2 = nodeUp->child2;
+
+            nodeUp->child1 = a;
+            nodeUp->parent = nodeA->parent;
+            nodeA->parent = up;
+            replaceChild(tree, nodeUp->parent, a, up);
+
+            // The taller of up's children stays with up, the shorter one takes up's old slot under a
+            int32 keep = upChild1;
+            int32 give = upChild2;
+            if (tree->nodes[upChild2].height > tree->nodes[upChild1].height)
+            {
+                keep = upChild2;
+                give = upChild1;
+            }
+
+            nodeUp->child2 = keep;
+            if (rotateC) nodeA->child2 = give;
+            else         nodeA->child1 = give;
+
+            tree->nodes[give].parent = a;
+
+            fitToChildren(tree, a);
+            fitToChildren(tree, up);
+
+            return up;
+        }
+
+        return a;
+    }
+
+    // Refits and rebalances from index up to the root
+    void refitAncestors(DynamicAabbTree* tree, int32 index)
+    {
+        while (index != AABB_TREE_NULL_NODE)
+        {
+            index = balance(tree, index);
+            fitToChildren(tree, index);
+            index = tree->nodes[index].parent;
+        }
+    }
+
+    void insertLeaf(DynamicAabbTree* tree, int32 leaf)
+    {
+        if (tree->root == AABB_TREE_NULL_NODE)
+        {
+            tree->root = leaf;
+            tree->nodes[leaf].parent = AABB_TREE_NULL_NODE;
+            return;
+        }
+
+        //
+        // Walk down to the best sibling. Pairing the leaf with a node costs the area of their combined bounds, plus
+        // the area every ancestor grows by to fit the leaf (inheritedCost). Stop once descending can't beat pairing
+        // with the current node.
+        //
+        int32 index = tree->root;
+        AabbTreeNode* leafNode = &tree->nodes[leaf];
+
+        while (!tree->nodes[index].isLeaf())
+        {
+            AabbTreeNode* node = &tree->nodes[index];
+
+            float32 area = surfaceArea(node->minPoint, node->maxPoint);
+            float32 combinedArea = combinedSurfaceArea(node, leafNode);
+
+            float32 cost = 2 * combinedArea;
+            float32 inheritedCost = 2 * (combinedArea - area);
+
+            float32 childCosts[2];
+            int32 children[2] = { node->child1, node->child2 };
+
+            for (uint32 i = 0; i < 2; i++)
+            {
+                AabbTreeNode* child = &tree->nodes[children[i]];
+                childCosts[i] = combinedSurfaceArea(child, leafNode) + inheritedCost;
+
+                if (!child->isLeaf())
+                {
+                    // It won't be paired with the child itself, so only the growth counts
+                    childCosts[i] -= surfaceArea(child->minPoint, child->maxPoint);
+                }
+            }
+
+            if (cost < childCosts[0] && cost < childCosts[1]) break;
+
+            index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+        }
+
+        int32 sibling = index;
+
+        //
+        // Make a new parent for the leaf and its sibling, in the sibling's place
+        //
+        int32 oldParent = tree->nodes[sibling].parent;
+        int32 newParent = allocateNode(tree); // Invalidates node pointers
+
+        AabbTreeNode* newParentNode = &tree->nodes[newParent];
+        newParentNode->parent = oldParent;
+        newParentNode->child1 = sibling;
+        newParentNode->child2 = leaf;
+
+        replaceChild(tree, oldParent, sibling, newParent);
+
+        tree->nodes[sibling].parent = newParent;
+        tree->nodes[leaf].parent = newParent;
+
+        refitAncestors(tree, newParent);
+    }
+
+    void removeLeaf(DynamicAabbTree* tree, int32 leaf)
+    {
+        if (leaf == tree->root)
+        {
+            tree->root = AABB_TREE_NULL_NODE;
+            return;
+        }
+
+        int32 parent = tree->nodes[leaf].parent;
+        int32 grandParent = tree->nodes[parent].parent;
+        int32 sibling = tree->nodes[parent].child1 == leaf ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+        // The sibling takes the parent's place
+        replaceChild(tree, grandParent, parent, sibling);
+        tree->nodes[sibling].parent = grandParent;
+        freeNode(tree, parent);
+
+        refitAncestors(tree, grandParent);
+    }
+
+    void setFatBounds(AabbTreeNode* node, Aabb bounds)
+    {
+        Vec3 margin = Vec3(AABB_TREE_FAT_MARGIN);
+        node->minPoint = bounds.minPoint() - margin;
+        node->maxPoint = bounds.maxPoint() + margin;
+    }
+}
+
+int32 insertProxy(DynamicAabbTree* tree, Aabb bounds, void* userData)
+{
+    int32 proxy = allocateNode(tree);
+
+    AabbTreeNode* node = &tree->nodes[proxy];
+    setFatBounds(node, bounds);
+    node->userData = userData;
+
+    insertLeaf(tree, proxy);
+    tree->proxyCount++;
+
+    return proxy;
+}
+
+void removeProxy(DynamicAabbTree* tree, int32 proxy)
+{
+    assert(proxy >= 0 && proxy < (int32)tree->nodes.size());
+    assert(tree->nodes[proxy].isLeaf());
+    assert(tree->proxyCount > 0);
+
+    removeLeaf(tree, proxy);
+    freeNode(tree, proxy);
+    tree->proxyCount--;
+}
+
+bool moveProxy(DynamicAabbTree* tree, int32 proxy, Aabb bounds)
+{
+    assert(proxy >= 0 && proxy < (int32)tree->nodes.size());
+    assert(tree->nodes[proxy].isLeaf());
+
+    AabbTreeNode* node = &tree->nodes[proxy];
+
+    Vec3 minPoint = bounds.minPoint();
+    Vec3 maxPoint = bounds.maxPoint();
+
+    if (contains(node, minPoint, maxPoint))
+    {
+        // Also reinsert things that have shrunk a lot, so that the fat bounds don't stay much bigger than they need to be
+        Vec3 margin = Vec3(AABB_TREE_FAT_MARGIN);
+        float32 fittedArea = surfaceArea(minPoint - margin, maxPoint + margin);
+
+        if (surfaceArea(node->minPoint, node->maxPoint) <= 4 * fittedArea) return false;
+    }
+
+    removeLeaf(tree, proxy);
+    setFatBounds(&tree->nodes[proxy], bounds);
+    insertLeaf(tree, proxy);
+
+    return true;
+}
+
+void clearAabbTree(DynamicAabbTree* tree)
+{
+    tree->nodes.clear();
+    tree->root = AABB_TREE_NULL_NODE;
+    tree->freeList = AABB_TREE_NULL_NODE;
+    tree->proxyCount = 0;
+}
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "Aabb.h"
+#include "Ray.h"
+
+#include <assert.h>
+#include <utility>
+#include <vector>
+
+//
+// Dynamic bounding volume hierarchy over AABBs, for broadphase queries.
+//
+// Each leaf (proxy) stores a "fat" AABB: the bounds it was given, grown by AABB_TREE_FAT_MARGIN on every side.
+// moveProxy(..) only touches the tree once the new bounds leave the fat ones, so things that sit still or shuffle around
+// in place cost nothing. This means queries can report proxies whose actual bounds miss, callers still do the exact test.
+//
+// Leaves are inserted next to whichever node grows the total surface area of the tree the least, and the tree is kept
+// balanced with AVL style rotations on the way back up.
+//
+
+#define AABB_TREE_NULL_NODE -1
+#define AABB_TREE_FAT_MARGIN 0.1f
+
+// Bounds how deep a tree the queries can walk. A balanced tree this deep holds far more leaves than we'll ever have.
+#define AABB_TREE_QUERY_STACK_SIZE 256
+
+struct AabbTreeNode
+{
+    Vec3 minPoint;
+    Vec3 maxPoint;
+
+    void* userData;
+
+    union
+    {
+        int32 parent;
+        int32 nextFree;
+    };
+
+    int32 child1;
+    int32 child2;
+
+    int32 height; // 0 for leaves, -1 for nodes on the free list
+
+    inline bool isLeaf() { return child1 == AABB_TREE_NULL_NODE; }
+};
+
+struct DynamicAabbTree
+{
+    std::vector<AabbTreeNode> nodes;
+    int32 root = AABB_TREE_NULL_NODE;
+    int32 freeList = AABB_TREE_NULL_NODE;
+    uint32 proxyCount = 0;
+};
+
+// Returns the proxy id, which stays valid until removeProxy(..)
+int32 insertProxy(DynamicAabbTree* tree, Aabb bounds, void* userData);
+void removeProxy(DynamicAabbTree* tree, int32 proxy);
+
+// Returns true if the proxy had to be reinserted, false if the new bounds still fit in its fat AABB
+bool moveProxy(DynamicAabbTree* tree, int32 proxy, Aabb bounds);
+
+void clearAabbTree(DynamicAabbTree* tree);
+
+inline void* proxyUserData(DynamicAabbTree* tree, int32 proxy)
+{
+    assert(proxy >= 0 && proxy < (int32)tree->nodes.size());
+    assert(tree->nodes[proxy].isLeaf());
+
+    return tree->nodes[proxy].userData;
+}
+
+// For when whatever userData points at moves
+inline void setProxyUserData(DynamicAabbTree* tree, int32 proxy, void* userData)
+{
+    assert(proxy >= 0 && proxy < (int32)tree->nodes.size());
+    assert(tree->nodes[proxy].isLeaf());
+
+    tree->nodes[proxy].userData = userData;
+}
+
+inline Aabb fatAabb(DynamicAabbTree* tree, int32 proxy)
+{
+    assert(proxy >= 0 && proxy < (int32)tree->nodes.size());
+
+    AabbTreeNode* node = &tree->nodes[proxy];
+    return aabbFromMinMax(node->minPoint, node->maxPoint);
+}
+
+inline bool aabbTreeNodeOverlaps(AabbTreeNode* node, Vec3 minPoint, Vec3 maxPoint)
+{
+    return node->minPoint.x <= maxPoint.x && node->maxPoint.x >= minPoint.x &&
+           node->minPoint.y <= maxPoint.y && node->maxPoint.y >= minPoint.y &&
+           node->minPoint.z <= maxPoint.z && node->maxPoint.z >= minPoint.z;
+}
+
+// Slab test. Returns the t the ray enters the node at, or -1 if it misses or only enters after maxT.
+inline float32 rayVsAabbTreeNode(Vec3 rayPosition, Vec3 inverseDirection, float32 maxT, AabbTreeNode* node)
+{
+    float32 nearT, farT;
+    raySlabs(rayPosition, inverseDirection, node->minPoint, node->maxPoint, &nearT, &farT);
+
+    nearT = fmax(nearT, 0.0f);
+    farT = fmin(farT, maxT);
+
+    if (nearT > farT) return -1;
+    return nearT;
+}
+
+//
+// Queries
+//
+
+// Calls fn(int32 proxy, void* userData) for every proxy whose fat AABB overlaps bounds
+template<class FN>
+void queryOverlap(DynamicAabbTree* tree, Aabb bounds, FN fn)
+{
+    if (tree->root == AABB_TREE_NULL_NODE) return;
+
+    Vec3 minPoint = bounds.minPoint();
+    Vec3 maxPoint = bounds.maxPoint();
+
+    int32 stack[AABB_TREE_QUERY_STACK_SIZE];
+    uint32 stackCount = 0;
+    stack[stackCount++] = tree->root;
+
+    while (stackCount > 0)
+    {
+        int32 index = stack[--stackCount];
+        AabbTreeNode* node = &tree->nodes[index];
+
+        if (!aabbTreeNodeOverlaps(node, minPoint, maxPoint)) continue;
+
+        if (node->isLeaf())
+        {
+            fn(index, node->userData);
+        }
+        else
+        {
+            assert(stackCount + 2 <= AABB_TREE_QUERY_STACK_SIZE);
+            stack[stackCount++] = node->child1;
+            stack[stackCount++] = node->child2;
+        }
+    }
+}
+
+//
+// Calls fn(int32 proxy, void* userData) for every proxy whose fat AABB the ray enters before maxT. fn returns the t the
+// ray hits the proxy's actual shape at, or a negative number if it misses. Each hit pulls maxT in, so nodes behind the
+// closest hit so far are skipped.
+//
+// Returns the t of the closest hit, or -1 if nothing was hit.
+//
+template<class FN>
+float32 queryRay(DynamicAabbTree* tree, Ray ray, float32 maxT, FN fn)
+{
+    if (tree->root == AABB_TREE_NULL_NODE) return -1;
+
+    Vec3 rayInverseDirection = inverseDirection(ray);
+
+    float32 closestT = -1;
+
+    float32 rootT = rayVsAabbTreeNode(ray.position, rayInverseDirection, maxT, &tree->nodes[tree->root]);
+    if (rootT < 0) return -1;
+
+    // Each node is pushed with the t the ray enters it at, so ones that end up behind a closer hit are skipped
+    int32 stack[AABB_TREE_QUERY_STACK_SIZE];
+    float32 stackTs[AABB_TREE_QUERY_STACK_SIZE];
+    uint32 stackCount = 0;
+
+    stack[stackCount] = tree->root;
+    stackTs[stackCount] = rootT;
+    stackCount++;
+
+    while (stackCount > 0)
+    {
+        stackCount--;
+        if (stackTs[stackCount] > maxT) continue;
+
+        int32 index = stack[stackCount];
+        AabbTreeNode* node = &tree->nodes[index];
+
+        if (node->isLeaf())
+        {
+            float32 t = fn(index, node->userData);
+
+            if (t >= 0 && t <= maxT)
+            {
+                maxT = t;
+                closestT = t;
+            }
+
+            continue;
+        }
+
+        int32 firstChild = node->child1;
+        int32 secondChild = node->child2;
+
+        // Both children in one slab test
+        Aabb4 children;
+        setAabb4Lane(&children, 0, tree->nodes[firstChild].minPoint, tree->nodes[firstChild].maxPoint);
+        setAabb4Lane(&children, 1, tree->nodes[secondChild].minPoint, tree->nodes[secondChild].maxPoint);
+
+        float32 nearTs[4];
+        uint32 hitMask = rayVsAabb4(ray.position, rayInverseDirection, maxT, &children, 2, nearTs);
+
+        float32 firstT = (hitMask & 1) ? fmax(nearTs[0], 0.0f) : -1;
+        float32 secondT = (hitMask & 2) ? fmax(nearTs[1], 0.0f) : -1;
+
+        // The nearer child is pushed last so it's visited first, and its hits can cull the other one
+        if (firstT >= 0 && secondT >= 0 && firstT < secondT)
+        {
+            std::swap(firstChild, secondChild);
+            std::swap(firstT, secondT);
+        }
+
+        assert(stackCount + 2 <= AABB_TREE_QUERY_STACK_SIZE);
+
+        if (firstT >= 0)
+        {
+            stack[stackCount] = firstChild;
+            stackTs[stackCount] = firstT;
+            stackCount++;
+        }
+
+        if (secondT >= 0)
+        {
+            stack[stackCount] = secondChild;
+            stackTs[stackCount] = secondT;
+            stackCount++;
+        }
+    }
+
+    return closestT;
+}
+
+//
+// Calls fn(int32 proxy, void* userData) for every proxy whose fat AABB isn't entirely behind any of the planes. The
+// inside of each plane is the side its normal points to.
+//
+// @Note: Like any plane vs AABB culling this is conservative. Boxes near the corners of the frustum can be reported
+//        even though they're outside.
+//
+template<class FN>
+void queryFrustum(DynamicAabbTree* tree, const Plane* planes, uint32 planeCount, FN fn)
+{
+    if (tree->root == AABB_TREE_NULL_NODE) return;
+
+    int32 stack[AABB_TREE_QUERY_STACK_SIZE];
+    uint32 stackCount = 0;
+    stack[stackCount++] = tree->root;
+
+    while (stackCount > 0)
+    {
+        int32 index = stack[--stackCount];
+        AabbTreeNode* node = &tree->nodes[index];
+
+        bool outside = false;
+        for (uint32 i = 0; i < planeCount; i++)
+        {
+            // The corner furthest along the normal. If it's behind the plane, the whole box is.
+            Vec3 normal = planes[i].normal;
+            Vec3 corner = Vec3(
+                normal.x >= 0 ? node->maxPoint.x : node->minPoint.x,
+                normal.y >= 0 ? node->maxPoint.y : node->minPoint.y,
+                normal.z >= 0 ? node->maxPoint.z : node->minPoint.z
+            );
+
+            if (dot(corner - planes[i].point, normal) < 0)
+            {
+                outside = true;
+                break;
+            }
+        }
+
+        if (outside) continue;
+
+        if (node->isLeaf())
+        {
+            fn(index, node->userData);
+        }
+        else
+        {
+            assert(stackCount + 2 <= AABB_TREE_QUERY_STACK_SIZE);
+            stack[stackCount++] = node->child1;
+            stack[stackCount++] = node->child2;
+        }
+    }
+}
@@ -0,0 +1,434 @@
+#include "ContactManifold.h"
+
+#include <float.h>
+
+// Most corners a feature can have. Anything past this on a hull's face is ignored.
+#define CONTACT_FEATURE_MAX_POINTS 64
+static_assert(CONTACT_FEATURE_MAX_POINTS <= HULL_FEATURE_MAX_POINTS, "Hulls can't return features this big");
+
+// Clipping a polygon against another one can add a point per clipping edge
+#define CONTACT_CLIP_MAX_POINTS (CONTACT_FEATURE_MAX_POINTS * 2 + 4)
+
+namespace
+{
+    // Unit vectors perpendicular to normal and each other
+    void planeBasis(Vec3 normal, Vec3* u, Vec3* v)
+    {
+        Vec3 axis = fabs(normal.x) < 0.57735f ? Vec3(Axis3D::X) : Vec3(Axis3D::Y);
+
+        *u = normalize(cross(normal, axis));
+        *v = cross(normal, *u);
+    }
+
+    //
+    // Puts the points of a face feature in counter-clockwise order around normal, dropping any that are inside the
+    // outline (e.g. a hull vertex in the middle of a flat face). Gift wrapping, since there are only ever a few points.
+    // Returns the new count.
+    //
+    uint32 orderFeature(Vec3* points, uint32 count, Vec3 normal)
+    {
+        if (count < 3) return count;
+
+        Vec3 u, v;
+        planeBasis(normal, &u, &v);
+
+        Vec2 projected[CONTACT_FEATURE_MAX_POINTS];
+        for (uint32 i = 0; i < count; i++)
+        {
+            projected[i] = Vec2(dot(points[i], u), dot(points[i], v));
+        }
+
+        uint32 start = 0;
+        for (uint32 i = 1; i < count; i++)
+        {
+            if (projected[i].x < projected[start].x ||
+                (projected[i].x == projected[start].x && projected[i].y < projected[start].y))
+            {
+                start = i;
+            }
+        }
+
+        Vec3 ordered[CONTACT_FEATURE_MAX_POINTS];
+        uint32 orderedCount = 0;
+
+        uint32 current = start;
+        do
+        {
+            ordered[orderedCount++] = points[current];
+
+            uint32 candidate = (current + 1) % count;
+            for (uint32 i = 0; i < count; i++)
+            {
+                if (i == current) continue;
+
+                Vec2 toCandidate = projected[candidate] - projected[current];
+                Vec2 toI = projected[i] - projected[current];
+                float32 turn = toCandidate.x * toI.y - toCandidate.y * toI.x;
+
+                // i is clockwise of the candidate, or in line with it but further away
+                if (turn < 0 || (turn == 0 && lengthSquared(toI) > lengthSquared(toCandidate)))
+                {
+                    candidate = i;
+                }
+            }
+
+            current = candidate;
+        } while (current != start && orderedCount < count);
+
+        for (uint32 i = 0; i < orderedCount; i++)
+        {
+            points[i] = ordered[i];
+        }
+
+        return orderedCount;
+    }
+
+    //
+    // Sutherland-Hodgman: keeps the part of the incident polygon (or segment, or point) on the inside of each edge of
+    // the reference face, with the edges' planes running along referenceNormal. reference must be counter-clockwise
+    // around referenceNormal.
+    //
+    uint32 clipAgainstFace(Vec3* reference, uint32 referenceCount, Vec3 referenceNormal, Vec3* incident, uint32 incidentCount, Vec3* out)
+    {
+        Vec3 buffers[2][CONTACT_CLIP_MAX_POINTS];
+
+        Vec3* input = buffers[0];
+        uint32 inputCount = incidentCount;
+        for (uint32 i = 0; i < incidentCount; i++) input[i] = incident[i];
+
+        Vec3* output = buffers[1];
+
+        for (uint32 edge = 0; edge < referenceCount && inputCount > 0; edge++)
+        {
+            Vec3 edgeStart = reference[edge];
+            Vec3 edgeEnd = reference[(edge + 1) % referenceCount];
+
+            // Points towards the inside of the face
+            Vec3 inward = cross(referenceNormal, edgeEnd - edgeStart);
+
+            uint32 outputCount = 0;
+
+            if (inputCount == 1)
+            {
+                if (dot(input[0] - edgeStart, inward) >= 0) output[outputCount++] = input[0];
+            }
+            else if (inputCount == 2)
+            {
+                // A segment isn't closed, so it only has the one edge to clip
+                float32 startSide = dot(input[0] - edgeStart, inward);
+                float32 endSide = dot(input[1] - edgeStart, inward);
+
+                if (startSide >= 0 && endSide >= 0)
+                {
+                    output[outputCount++] = input[0];
+                    output[outputCount++] = input[1];
+                }
+                else if (startSide >= 0 || endSide >= 0)
+                {
+                    Vec3 crossing = input[0] + (startSide / (startSide - endSide)) * (input[1] - input[0]);
+
+                    output[outputCount++] = startSide >= 0 ? input[0] : crossing;
+                    output[outputCount++] = endSide >= 0 ? input[1] : crossing;
+                }
+            }
+            else
+            {
+                for (uint32 i = 0; i < inputCount; i++)
+                {
+                    Vec3 current = input[i];
+                    Vec3 next = input[(i + 1) % inputCount];
+
+                    float32 currentSide = dot(current - edgeStart, inward);
+                    float32 nextSide = dot(next - edgeStart, inward);
+
+                    if (currentSide >= 0 && outputCount < CONTACT_CLIP_MAX_POINTS)
+                    {
+                        output[outputCount++] = current;
+                    }
+
+                    if ((currentSide >= 0) != (nextSide >= 0) && outputCount < CONTACT_CLIP_MAX_POINTS)
+                    {
+                        float32 t = currentSide / (currentSide - nextSide);
+                        output[outputCount++] = current + t * (next - current);
+                    }
+                }
+            }
+
+            Vec3* temp = input;
+            input = output;
+            output = temp;
+            inputCount = outputCount;
+        }
+
+        for (uint32 i = 0; i < inputCount; i++) out[i] = input[i];
+        return inputCount;
+    }
+
+    //
+    // Keeps the deepest point, the one furthest from it, the one making the biggest triangle with those two, and the
+    // one adding the most area on the far side of that triangle. Those 4 cover the contact area about as well as all
+    // of them did.
+    //
+    void reduceContactPoints(ContactPoint* points, uint32* count, Vec3 normal)
+    {
+        if (*count <= CONTACT_MANIFOLD_MAX_POINTS) return;
+
+        uint32 chosen[CONTACT_MANIFOLD_MAX_POINTS];
+
+        chosen[0] = 0;
+        for (uint32 i = 1; i < *count; i++)
+        {
+            if (points[i].depth > points[chosen[0]].depth) chosen[0] = i;
+        }
+
+        Vec3 p0 = points[chosen[0]].pointB;
+
+        chosen[1] = chosen[0];
+        float32 best = -1;
+        for (uint32 i = 0; i < *count; i++)
+        {
+            float32 distanceSquared = lengthSquared(points[i].pointB - p0);
+            if (distanceSquared > best)
+            {
+                best = distanceSquared;
+                chosen[1] = i;
+            }
+        }
+
+        Vec3 p1 = points[chosen[1]].pointB;
+
+        chosen[2] = chosen[0];
+        best = -1;
+        float32 triangleSign = 1;
+        for (uint32 i = 0; i < *count; i++)
+        {
+            float32 area = dot(cross(p1 - p0, points[i].pointB - p0), normal);
+            if (fabs(area) > best)
+            {
+                best = fabs(area);
+                chosen[2] = i;
+                triangleSign = area < 0 ? -1.0f : 1.0f;
+            }
+        }
+
+        Vec3 p2 = points[chosen[2]].pointB;
+
+        // Outside any edge of the (p0, p1, p2) triangle means the opposite sign from the triangle itself
+        chosen[3] = chosen[0];
+        best = 0;
+        for (uint32 i = 0; i < *count; i++)
+        {
+            Vec3 p = points[i].pointB;
+
+            float32 area01 = -triangleSign * dot(cross(p1 - p0, p - p0), normal);
+            float32 area12 = -triangleSign * dot(cross(p2 - p1, p - p1), normal);
+            float32 area20 = -triangleSign * dot(cross(p0 - p2, p - p2), normal);
+
+            float32 area = fmax(area01, fmax(area12, area20));
+            if (area > best)
+            {
+                best = area;
+                chosen[3] = i;
+            }
+        }
+
+        ContactPoint reduced[CONTACT_MANIFOLD_MAX_POINTS];
+        uint32 reducedCount = 0;
+
+        for (uint32 i = 0; i < CONTACT_MANIFOLD_MAX_POINTS; i++)
+        {
+            bool duplicate = false;
+            for (uint32 j = 0; j < i; j++)
+            {
+                if (chosen[j] == chosen[i]) duplicate = true;
+            }
+
+            if (!duplicate) reduced[reducedCount++] = points[chosen[i]];
+        }
+
+        for (uint32 i = 0; i < reducedCount; i++) points[i] = reduced[i];
+        *count = reducedCount;
+    }
+
+    void addContactPoint(ContactPoint* points, uint32* count, Vec3 pointA, Vec3 pointB, float32 depth, Vec3 centerA, Vec3 centerB)
+    {
+        if (*count >= CONTACT_CLIP_MAX_POINTS) return;
+
+        ContactPoint* point = &points[*count];
+        point->pointA = pointA;
+        point->pointB = pointB;
+        point->localA = pointA - centerA;
+        point->localB = pointB - centerB;
+        point->depth = depth;
+        point->normalImpulse = 0;
+        point->lifetime = 0;
+
+        (*count)++;
+    }
+}
+
+void buildContactManifold(ICollider* a, ICollider* b, GjkResult* gjkResult, ContactManifold* out)
+{
+    out->a = a;
+    out->b = b;
+    out->keyA = a->colliderKey();
+    out->keyB = b->colliderKey();
+    out->pointCount = 0;
+
+    if (!gjkResult->collides) return;
+
+    Vec3 normal = gjkResult->contactNormal;
+    Vec3 centerA = a->center();
+    Vec3 centerB = b->center();
+
+    if (isZeroVector(normal))
+    {
+        // Only just touching, EPA didn't find a direction
+        out->normal = normal;
+        addContactPoint(out->points, &out->pointCount, gjkResult->contactPointA, gjkResult->contactPointB, 0, centerA, centerB);
+        return;
+    }
+
+    out->normal = normal;
+
+    Vec3 featureA[CONTACT_FEATURE_MAX_POINTS];
+    Vec3 featureB[CONTACT_FEATURE_MAX_POINTS];
+    uint32 featureACount = a->supportFeature(normal, CONTACT_FEATURE_TOLERANCE, featureA, CONTACT_FEATURE_MAX_POINTS, nullptr);
+    uint32 featureBCount = b->supportFeature(-normal, CONTACT_FEATURE_TOLERANCE, featureB, CONTACT_FEATURE_MAX_POINTS, nullptr);
+
+    ContactPoint points[CONTACT_CLIP_MAX_POINTS];
+    uint32 pointCount = 0;
+
+    //
+    // Clipping needs a face to clip against. Anything else (a point on a curved surface, two edges crossing) touches at
+    // one point, which EPA already found.
+    //
+    if (featureACount >= 3 || featureBCount >= 3)
+    {
+        // The feature with more corners is the reference face, the other one gets clipped to it
+        bool referenceIsA = featureACount >= featureBCount;
+
+        Vec3* reference = referenceIsA ? featureA : featureB;
+        uint32 referenceCount = referenceIsA ? featureACount : featureBCount;
+        Vec3* incident = referenceIsA ? featureB : featureA;
+        uint32 incidentCount = referenceIsA ? featureBCount : featureACount;
+
+        // Out of the reference collider, towards the other one
+        Vec3 referenceNormal = referenceIsA ? normal : -normal;
+
+        referenceCount = orderFeature(reference, referenceCount, referenceNormal);
+        incidentCount = orderFeature(incident, incidentCount, referenceNormal);
+
+        Vec3 clipped[CONTACT_CLIP_MAX_POINTS];
+        uint32 clippedCount = clipAgainstFace(reference, referenceCount, referenceNormal, incident, incidentCount, clipped);
+
+        for (uint32 i = 0; i < clippedCount; i++)
+        {
+            // How far behind the reference face this point of the other collider is
+            float32 depth = -dot(clipped[i] - reference[0], referenceNormal);
+            if (depth < 0) continue;
+
+            Vec3 onReference = clipped[i] + referenceNormal * depth;
+
+            if (referenceIsA) addContactPoint(points, &pointCount, onReference, clipped[i], depth, centerA, centerB);
+            else              addContactPoint(points, &pointCount, clipped[i], onReference, depth, centerA, centerB);
+        }
+    }
+
+    if (pointCount == 0)
+    {
+        addContactPoint(points, &pointCount, gjkResult->contactPointA, gjkResult->contactPointB, gjkResult->penetrationDepth, centerA, centerB);
+    }
+
+    reduceContactPoints(points, &pointCount, normal);
+
+    for (uint32 i = 0; i < pointCount; i++)
+    {
+        out->points[i] = points[i];
+    }
+
+    out->pointCount = pointCount;
+}
+
+ContactManifold* updateContactManifold(ContactManifoldCache* cache, ICollider* a, ICollider* b, GjkResult* gjkResult)
+{
+    ContactManifold rebuilt;
+    buildContactManifold(a, b, gjkResult, &rebuilt);
+
+    ContactManifold* old = findContactManifold(cache, a, b);
+    if (old) warmStartContactManifold(old, &rebuilt);
+
+    return storeContactManifold(cache, &rebuilt);
+}
+
+void warmStartContactManifold(ContactManifold* old, ContactManifold* rebuilt)
+{
+    for (uint32 i = 0; i < rebuilt->pointCount; i++)
+    {
+        ContactPoint* point = &rebuilt->points[i];
+
+        float32 closestDistanceSquared = CONTACT_MATCH_DISTANCE * CONTACT_MATCH_DISTANCE;
+        ContactPoint* closest = nullptr;
+
+        for (uint32 j = 0; j < old->pointCount; j++)
+        {
+            ContactPoint* oldPoint = &old->points[j];
+
+            float32 distanceSquared = fmax(lengthSquared(point->localA - oldPoint->localA), lengthSquared(point->localB - oldPoint->localB));
+            if (distanceSquared < closestDistanceSquared)
+            {
+                closestDistanceSquared = distanceSquared;
+                closest = oldPoint;
+            }
+        }
+
+        if (closest)
+        {
+            point->normalImpulse = closest->normalImpulse;
+            point->lifetime = closest->lifetime + 1;
+        }
+    }
+}
+
+ContactManifold* storeContactManifold(ContactManifoldCache* cache, ContactManifold* manifold)
+{
+    GjkPairKey key;
+    key.a = manifold->keyA;
+    key.b = manifold->keyB;
+
+    ContactManifold* stored = &cache->manifolds[key];
+
+    *stored = *manifold;
+    stored->lastUpdatedFrame = cache->frame;
+
+    return stored;
+}
+
+ContactManifold* findContactManifold(ContactManifoldCache* cache, ICollider* a, ICollider* b)
+{
+    GjkPairKey key;
+    key.a = a->colliderKey();
+    key.b = b->colliderKey();
+
+    auto it = cache->manifolds.find(key);
+    if (it == cache->manifolds.end()) return nullptr;
+
+    return &it->second;
+}
+
+void ageContactManifoldCache(ContactManifoldCache* cache)
+{
+    for (auto it = cache->manifolds.begin(); it != cache->manifolds.end();)
+    {
+        if (cache->frame - it->second.lastUpdatedFrame >= CONTACT_MANIFOLD_MAX_AGE || it->second.pointCount == 0)
+        {
+            it = cache->manifolds.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+
+    cache->frame++;
+}
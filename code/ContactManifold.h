@@ -0,0 +1,101 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "Gjk.h"
+#include "ICollider.h"
+
+#include <unordered_map>
+
+//
+// Contact manifolds: up to 4 points where two colliders touch, all sharing one normal. Built from EPA's normal by
+// taking the feature (face, edge or point) of each collider furthest along it and clipping one against the other. A
+// box resting on a face gets its 4 corners, instead of EPA's single point somewhere on the face.
+//
+// Manifolds persist across frames, keyed by the colliders' ColliderKeys like GjkPairCache. When a pair's manifold is rebuilt, new
+// points close to old ones keep the old points' accumulated impulses, so a solver can warm start from them.
+//
+
+#define CONTACT_MANIFOLD_MAX_POINTS 4
+
+// How far from the support plane a vertex can be and still count as part of the touching feature
+#define CONTACT_FEATURE_TOLERANCE 0.005f
+
+// New points within this distance of an old one (relative to the colliders' centers) are the same contact
+#define CONTACT_MATCH_DISTANCE 0.02f
+
+// Manifolds that haven't been updated for this many frames are dropped by ageContactManifoldCache(..)
+#define CONTACT_MANIFOLD_MAX_AGE 8
+
+struct ContactPoint
+{
+    // World space. pointA - pointB = normal * depth.
+    Vec3 pointA;
+    Vec3 pointB;
+
+    // pointA and pointB relative to their collider's center when found, for matching against next time's points
+    Vec3 localA;
+    Vec3 localB;
+
+    float32 depth;
+
+    float32 normalImpulse;  // Accumulated by a solver. Carried over to the matching point when the manifold is rebuilt.
+    uint32 lifetime;        // Number of rebuilds this point has survived
+};
+
+struct ContactManifold
+{
+    // Only good until something is next added to or removed from the colliders' ECS, like any component pointer. The
+    // cache goes by keyA and keyB.
+    ICollider* a = nullptr;
+    ICollider* b = nullptr;
+
+    ColliderKey keyA;
+    ColliderKey keyB;
+
+    // Unit, from a towards b. Moving a by -normal * depth (or b by +normal * depth) separates a point.
+    Vec3 normal;
+
+    ContactPoint points[CONTACT_MANIFOLD_MAX_POINTS];
+    uint32 pointCount = 0;
+
+    uint32 lastUpdatedFrame = 0;
+};
+
+struct ContactManifoldCache
+{
+    std::unordered_map<GjkPairKey, ContactManifold, GjkPairKeyHash> manifolds;
+    uint32 frame = 0;
+};
+
+//
+// Builds a fresh manifold for a and b, from a gjk(..) result that collided and has its penetration vector calculated.
+// pointCount is 0 if the result didn't collide.
+//
+void buildContactManifold(ICollider* a, ICollider* b, GjkResult* gjkResult, ContactManifold* out);
+
+//
+// Rebuilds the persistent manifold for a and b (adding it if it's new) and returns it. Points that match the previous
+// manifold's keep their impulses and lifetimes. Not thread safe.
+//
+ContactManifold* updateContactManifold(ContactManifoldCache* cache, ICollider* a, ICollider* b, GjkResult* gjkResult);
+
+//
+// The two halves of updateContactManifold(..), for solvers that build and solve manifolds somewhere they can't touch the
+// cache (e.g. on a worker) and store them afterwards.
+//
+// warmStartContactManifold(..) gives the points of rebuilt that match one of old's its impulse and lifetime. Only reads
+// old, so it's safe to call on workers as long as nothing stores into the cache at the same time.
+//
+// storeContactManifold(..) replaces the pair's persistent manifold with manifold, as is. It's stored under manifold->keyA
+// and manifold->keyB, so one built from a stand-in collider (e.g. one offset to where it was when it touched) goes
+// under the real one as long as the stand-in forwards colliderKey(..). Not thread safe.
+//
+void warmStartContactManifold(ContactManifold* old, ContactManifold* rebuilt);
+ContactManifold* storeContactManifold(ContactManifoldCache* cache, ContactManifold* manifold);
+
+// Returns nullptr if the pair doesn't have one
+ContactManifold* findContactManifold(ContactManifoldCache* cache, ICollider* a, ICollider* b);
+
+// Call once a frame. Drops the manifolds of pairs that stopped touching.
+void ageContactManifoldCache(ContactManifoldCache* cache);
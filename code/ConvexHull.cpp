@@ -1,5 +1,7 @@
 #include "ConvexHull.h"
 
+#include <algorithm>
+
 Vec3 approximateHullCentroid(ConvexHull* hull)
 {
     // Since the hull data structure doesn't store any face information, take the weighted average of the center of
@@ -47,3 +49,147 @@ void recalculateBounds(ConvexHull * hull)
 
     hull->bounds = aabbFromMinMax(minPoint, maxPoint);
 }
+
+void buildHullAdjacency(ConvexHull* hull)
+{
+    uint32 vertexCount = hull->positions.size();
+
+    hull->adjacencyOffsets.assign(vertexCount + 1, 0);
+    hull->adjacency.resize(2 * hull->edges.size());
+
+    // Count each vertex's neighbors, then turn the counts into offsets
+    for (ConvexHullEdge& edge: hull->edges)
+    {
+        hull->adjacencyOffsets[edge.index0 + 1]++;
+        hull->adjacencyOffsets[edge.index1 + 1]++;
+    }
+
+    for (uint32 i = 0; i < vertexCount; i++)
+    {
+        hull->adjacencyOffsets[i + 1] += hull->adjacencyOffsets[i];
+    }
+
+    std::vector<uint32> cursors(hull->adjacencyOffsets.begin(), hull->adjacencyOffsets.end() - 1);
+
+    for (ConvexHullEdge& edge: hull->edges)
+    {
+        hull->adjacency[cursors[edge.index0]++] = edge.index1;
+        hull->adjacency[cursors[edge.index1]++] = edge.index0;
+    }
+}
+
+uint32 hillClimbSupportIndex(
+    const float32* xs, const float32* ys, const float32* zs,
+    const uint32* adjacencyOffsets, const uint32* adjacency,
+    uint32 start, Vec3 direction)
+{
+    uint32 current = start;
+    float32 currentDot = xs[current] * direction.x + ys[current] * direction.y + zs[current] * direction.z;
+
+    // Every step strictly increases the dot product, so this can't cycle
+    while (true)
+    {
+        uint32 best = current;
+        float32 bestDot = currentDot;
+
+        for (uint32 i = adjacencyOffsets[current]; i < adjacencyOffsets[current + 1]; i++)
+        {
+            uint32 neighbor = adjacency[i];
+
+            float32 dotp = xs[neighbor] * direction.x + ys[neighbor] * direction.y + zs[neighbor] * direction.z;
+            if (dotp > bestDot)
+            {
+                best = neighbor;
+                bestDot = dotp;
+            }
+        }
+
+        if (best == current) return current;
+
+        current = best;
+        currentDot = bestDot;
+    }
+}
+
+uint32 hullSupportIndex(
+    const float32* xs, const float32* ys, const float32* zs, uint32 count,
+    const std::vector<uint32>& adjacencyOffsets, const std::vector<uint32>& adjacency,
+    HullSupportWarmStart* warmStart, Vec3 direction)
+{
+    if (count < HULL_HILL_CLIMB_MIN_VERTICES || adjacencyOffsets.size() != count + 1)
+    {
+        return maxDotIndex(xs, ys, zs, count, direction);
+    }
+
+    if (warmStart == nullptr)
+    {
+        return hillClimbSupportIndex(xs, ys, zs, adjacencyOffsets.data(), adjacency.data(), 0, direction);
+    }
+
+    uint32 octant = (direction.x < 0 ? 1 : 0) | (direction.y < 0 ? 2 : 0) | (direction.z < 0 ? 4 : 0);
+
+    uint32 start = warmStart->vertices[octant];
+    if (start >= count) start = 0;
+
+    uint32 result = hillClimbSupportIndex(xs, ys, zs, adjacencyOffsets.data(), adjacency.data(), start, direction);
+    warmStart->vertices[octant] = result;
+
+    return result;
+}
+
+uint32 hullSupportFeature(
+    const float32* xs, const float32* ys, const float32* zs, uint32 count,
+    const std::vector<uint32>& adjacencyOffsets, const std::vector<uint32>& adjacency,
+    HullSupportWarmStart* warmStart, Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount)
+{
+    assert(maxCount > 0);
+
+    direction = normalize(direction);
+
+    uint32 support = hullSupportIndex(xs, ys, zs, count, adjacencyOffsets, adjacency, warmStart, direction);
+    float32 threshold = xs[support] * direction.x + ys[support] * direction.y + zs[support] * direction.z - tolerance;
+
+    if (adjacencyOffsets.size() != count + 1)
+    {
+        uint32 featureCount = 0;
+        for (uint32 i = 0; i < count && featureCount < maxCount; i++)
+        {
+            if (xs[i] * direction.x + ys[i] * direction.y + zs[i] * direction.z >= threshold)
+            {
+                out[featureCount] = Vec3(xs[i], ys[i], zs[i]);
+                featureCount++;
+            }
+        }
+
+        return featureCount;
+    }
+
+    assert(maxCount <= HULL_FEATURE_MAX_POINTS);
+
+    // Features are a handful of vertices, so the visited list is just searched
+    uint32 feature[HULL_FEATURE_MAX_POINTS];
+    uint32 featureCount = 0;
+    feature[featureCount++] = support;
+
+    for (uint32 next = 0; next < featureCount && featureCount < maxCount; next++)
+    {
+        uint32 vertex = feature[next];
+
+        for (uint32 i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+        {
+            uint32 neighbor = adjacency[i];
+            if (xs[neighbor] * direction.x + ys[neighbor] * direction.y + zs[neighbor] * direction.z < threshold) continue;
+            if (std::find(feature, feature + featureCount, neighbor) != feature + featureCount) continue;
+
+            feature[featureCount++] = neighbor;
+            if (featureCount == maxCount) break;
+        }
+    }
+
+    for (uint32 i = 0; i < featureCount; i++)
+    {
+        out[i] = Vec3(xs[feature[i]], ys[feature[i]], zs[feature[i]]);
+    }
+
+    return featureCount;
+}
@@ -15,14 +15,82 @@ struct ConvexHullEdge
     uint32 index1;
 };
 
+// Plane of a face: outward unit normal, and one of the face's vertices to get the offset from
+struct ConvexHullFace
+{
+    ConvexHullFace(Vec3 normal, uint32 vertex)
+        : normal(normal)
+        , vertex(vertex)
+    {}
+
+    Vec3 normal;
+    uint32 vertex;
+};
+
 struct ConvexHull
 {
     std::vector<Vec3> positions;
     std::vector<ConvexHullEdge> edges;
+    std::vector<ConvexHullFace> faces;
+
+    //
+    // Built from edges by buildHullAdjacency(..). The neighbors of vertex i are adjacency[adjacencyOffsets[i]] up to
+    // adjacency[adjacencyOffsets[i + 1]].
+    //
+    std::vector<uint32> adjacencyOffsets;
+    std::vector<uint32> adjacency;
 
     Aabb bounds;
 };
 
+//
+// Last support vertex found for directions in each octant. Successive support queries in a similar direction (GJK
+// iterations, or the same pair next frame) usually end up at or next to it, so it's where the next walk starts.
+//
+struct HullSupportWarmStart
+{
+    uint32 vertices[8] = {};
+};
+
+// Hulls smaller than this just get scanned, the walk doesn't save anything on them
+#define HULL_HILL_CLIMB_MIN_VERTICES 32
+
 Vec3 approximateHullCentroid(ConvexHull* hull);
 void recalculatePositionsRelativeToCentroid(ConvexHull* hull, Vec3 centroid);
 void recalculateBounds(ConvexHull* hull);
+void buildHullAdjacency(ConvexHull* hull);
+
+//
+// Walks from start to whichever neighbor has the biggest dot product with direction, until no neighbor is bigger. On a
+// convex hull a vertex that none of its neighbors beat is a support point, so this finds the same dot product as a
+// full scan after visiting a handful of vertices.
+//
+uint32 hillClimbSupportIndex(
+    const float32* xs, const float32* ys, const float32* zs,
+    const uint32* adjacencyOffsets, const uint32* adjacency,
+    uint32 start, Vec3 direction);
+
+//
+// Support vertex of a hull stored as separate x, y and z arrays. Scans small hulls (or ones without adjacency) with
+// maxDotIndex(..), and walks bigger ones from warmStart, which is updated with the result. Without a warmStart the
+// walk starts from vertex 0.
+//
+// @Note: The hull itself is only read, so it can be queried from any number of threads as long as each one has its own
+//        warmStart (or none)
+//
+uint32 hullSupportIndex(
+    const float32* xs, const float32* ys, const float32* zs, uint32 count,
+    const std::vector<uint32>& adjacencyOffsets, const std::vector<uint32>& adjacency,
+    HullSupportWarmStart* warmStart, Vec3 direction);
+
+//
+// Same as ICollider::supportFeature(..) for a hull stored like hullSupportIndex(..)'s. The vertices within tolerance of
+// the support plane are always connected to each other, so it floods out from the support vertex through adjacency
+// rather than checking every vertex. maxCount can't be more than HULL_FEATURE_MAX_POINTS.
+//
+#define HULL_FEATURE_MAX_POINTS 64
+
+uint32 hullSupportFeature(
+    const float32* xs, const float32* ys, const float32* zs, uint32 count,
+    const std::vector<uint32>& adjacencyOffsets, const std::vector<uint32>& adjacency,
+    HullSupportWarmStart* warmStart, Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount);
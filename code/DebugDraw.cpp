@@ -523,12 +523,13 @@ DebugDraw::drawSphere(Vec3 position, float radius)
     transform.scaleInPlace(Vec3(radius));
     transform.translateInPlace(position);
 
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "model", transform);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", color);
 
     glBindVertexArray(this->vao);
@@ -557,12 +558,13 @@ DebugDraw::drawRect3(Vec3 center, Vec3 dimensions, Quaternion orientation)
     transform.rotateInPlace(orientation);
     transform.translateInPlace(center);
 
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "model", transform);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", color);
 
     glBindVertexArray(this->vao);
@@ -587,12 +589,13 @@ DebugDraw::drawCylinder(Vec3 center, float32 radius, float32 length, Axis3D axis
     transform.rotateInPlace(rotationNeeded);
     transform.translateInPlace(center);
 
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "model", transform);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", color);
 
     glBindVertexArray(this->vao);
@@ -629,12 +632,13 @@ void
 DebugDraw::drawLine(Vec3 start, Vec3 end)
 {
     Mat4 transform;
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "model", transform);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", color);
     
     glBindVertexArray(this->vao);
@@ -661,12 +665,13 @@ DebugDraw::drawCone(Vec3 position, float32 radius, float32 height, Quaternion or
     transform.rotateInPlace(orientation);
     transform.translateInPlace(position);
 
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "model", transform);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", this->color);
 
     glBindVertexArray(this->vao);
@@ -801,11 +806,12 @@ DebugDraw::drawCapsule(Vec3 center, float32 radius, float32 length, Axis3D axis,
     botEndcapXfm.rotateInPlace(rotationNeeded);
     botEndcapXfm.translateInPlace(center);
 
-    Mat4 view = worldToView(this->cameraXfm);
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(this->camera);
+    Mat4 view = worldToView(getComponent<TransformComponent>(this->camera));
     
     bind(shader);
     setMat4(shader, "view", view);
-    setMat4(shader, "projection", this->cameraComponent->projectionMatrix);
+    setMat4(shader, "projection", cameraComponent->projectionMatrix);
     setVec3(shader, "debugColor", color);
 
     glBindVertexArray(this->vao);
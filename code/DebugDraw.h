@@ -1,6 +1,7 @@
 #pragma once
 
 #include "als/als_math.h"
+#include "ecs/Entity.h"
 
 // not tweakable defines
 #define CUBE_VERTICES 8
@@ -10,9 +11,6 @@
 #define SPHERE_SUBDIVISIONS 3
 #define CIRCLE_EDGES       32
 
-struct Entity;
-struct CameraComponent;
-struct TransformComponent;
 struct ColliderComponent;
 struct Window;
 struct Shader;
@@ -26,8 +24,7 @@ struct DebugDraw
     Shader* shader;
     Vec3 color;
 
-    CameraComponent* cameraComponent;
-    TransformComponent* cameraXfm;
+    Entity camera; // Its camera and transform components are looked up on each draw, since they can move
 
     Window* window; // used for screen to pixel conversions
 
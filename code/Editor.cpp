@@ -27,6 +27,7 @@
 #include "ecs/components/AgentComponent.h"
 #include "ecs/components/WalkComponent.h"
 #include "ecs/components/TerrainComponent.h"
+#include "ecs/systems/CollisionSystem.h"
 
 #include <thread>
 
@@ -223,6 +224,12 @@ void showEditor(EditorState* editor)
                     Vec3 delta = projection - prevProjection;
 
                     tc->setPosition(tc->position() + delta);
+
+                    // Static colliders are baked into world space
+                    if (getComponent<EntityDetails>(editor->selectedEntity)->flags & EntityFlag_Static)
+                    {
+                        markStaticCollisionWorldDirty(editor->selectedEntity.ecs);
+                    }
                 }
             }
         }
@@ -304,11 +311,13 @@ void showEditor(EditorState* editor)
 
             // Note: Use short-circuit evaluation to not show selectable for components
             //       that we can't add (e.g., if we already have a camera component)
-            if (ImGui::Selectable("Collider"))          addComponent<ColliderComponent>(e);
-            if (!camera && ImGui::Selectable("Camera")) addComponent<CameraComponent>(e);
-            if (!portal && ImGui::Selectable("Portal")) addComponent<PortalComponent>(e);
-            if (ImGui::Selectable("Directional Light")) addComponent<DirectionalLightComponent>(e);
-            if (ImGui::Selectable("Point Light"))       addComponent<PointLightComponent>(e);
+            // Note: The editor runs as a system, so adds and removes go through the command buffer. They also move the
+            //       components this window is holding pointers to.
+            if (ImGui::Selectable("Collider"))          recordAddComponent<ColliderComponent>(&game->commands, e);
+            if (!camera && ImGui::Selectable("Camera")) recordAddComponent<CameraComponent>(&game->commands, e);
+            if (!portal && ImGui::Selectable("Portal")) recordAddComponent<PortalComponent>(&game->commands, e);
+            if (ImGui::Selectable("Directional Light")) recordAddComponent<DirectionalLightComponent>(&game->commands, e);
+            if (ImGui::Selectable("Point Light"))       recordAddComponent<PointLightComponent>(&game->commands, e);
 
             // Select mesh modal window
             {
@@ -337,8 +346,16 @@ void showEditor(EditorState* editor)
 
                             if (!isUploadedToGpuOpenGl(m)) uploadToGpuOpenGl(m);
 
-                            auto rcc = addComponents<RenderComponent>(e, m->submeshes.size());
-                            initRenderComponents(&rcc, m);
+                            EcsCommand command;
+                            command.type = EcsCommandType::Apply;
+                            command.entity = e;
+                            command.apply = [m](Entity target)
+                            {
+                                auto rcc = addComponents<RenderComponent>(target, m->submeshes.size());
+                                initRenderComponents(&rcc, m);
+                            };
+
+                            recordCommand(&game->commands, command);
 
                             closePopup = true;
                         }
@@ -482,7 +499,7 @@ void showEditor(EditorState* editor)
                             ImGui::TreePop();
                         }
 
-                        if (!xNotClicked) removeComponent<ColliderComponent>(&cc);
+                        if (!xNotClicked) recordRemoveComponent<ColliderComponent>(&game->commands, e, i);
                     }
                 }
 
@@ -521,7 +538,7 @@ void showEditor(EditorState* editor)
                             ImGui::TreePop();
                         }
 
-                        if (!xNotClicked) removeComponent(&chcc);
+                        if (!xNotClicked) recordRemoveComponent<ConvexHullColliderComponent>(&game->commands, e, i);
                     }
                 }
 
@@ -588,7 +605,7 @@ void showEditor(EditorState* editor)
                             ImGui::TreePop();
                         }
 
-                        if (!xNotClicked) removeComponent<DirectionalLightComponent>(&component);
+                        if (!xNotClicked) recordRemoveComponent<DirectionalLightComponent>(&game->commands, e, i);
                     }
                 }
 
@@ -627,7 +644,7 @@ void showEditor(EditorState* editor)
                             ImGui::TreePop();
                         }
 
-                        if (!xNotClicked) removeComponent<PointLightComponent>(&component);
+                        if (!xNotClicked) recordRemoveComponent<PointLightComponent>(&game->commands, e, i);
                     }
                 }
 
@@ -673,8 +690,7 @@ void showEditor(EditorState* editor)
 
                 if (!xNotClicked)
                 {
-                    removeComponent<PortalComponent>(&portal);
-                    assert(portal == nullptr);
+                    recordRemoveComponents<PortalComponent>(&game->commands, e);
                 }
             }
 
@@ -704,12 +720,7 @@ void showEditor(EditorState* editor)
 
                 if (!xNotClicked)
                 {
-                    for (uint32 i = 0; i < renderComponents.numComponents; i++)
-                    {
-                        RenderComponent* rc = &renderComponents[i];
-                        removeComponent<RenderComponent>(&rc);
-                        assert(rc == nullptr);
-                    }
+                    recordRemoveComponents<RenderComponent>(&game->commands, e);
                 }
             }
     
@@ -717,6 +728,30 @@ void showEditor(EditorState* editor)
         }
     
 
+        // Anything being edited on a static entity might be baked into the static collision world. Rebake while it is.
+        // @Slow: Rebakes the whole world every frame that a widget is held
+        if ((details->flags & EntityFlag_Static) && ImGui::IsWindowFocused() && ImGui::IsAnyItemActive())
+        {
+            markStaticCollisionWorldDirty(e.ecs);
+        }
+
+        // The picking tree and the broadphase only refit entities whose transforms moved, so they have to be told about
+        // resized colliders and swapped meshes too
+        if (ImGui::IsWindowFocused() && ImGui::IsAnyItemActive())
+        {
+            markPickingEntityDirty(&e.ecs->scene->pickingTree, e);
+
+            for (uint32 i = 0; i < colliders.numComponents; i++)
+            {
+                markColliderBoundsDirty(&colliders[i]);
+            }
+
+            for (uint32 i = 0; i < convexHullColliders.numComponents; i++)
+            {
+                markColliderBoundsDirty(&convexHullColliders[i]);
+            }
+        }
+
         reflector.endReflection();
         ImGui::End();
 
@@ -782,7 +817,7 @@ void showEditor(EditorState* editor)
 
                 if (!xNotClicked)
                 {
-                    markEntityForDeletion(e);
+                    recordDestroyEntity(&getGame(e)->commands, e);
                 }
 
                 ImGui::PopStyleColor();
@@ -802,7 +837,8 @@ void showEditor(EditorState* editor)
         {
             if (ImGui::Selectable("Blank Entity"))
             {
-                Entity e = makeEntity(&game->activeScene->ecs, "New Entity");
+                // Exists once the command buffer plays back, which is before the editor runs again
+                Entity e = recordMakeEntity(&game->commands, &game->activeScene->ecs, "New Entity");
                 selectEntity(editor, e);
             }
 
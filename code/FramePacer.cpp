@@ -0,0 +1,46 @@
+#include "FramePacer.h"
+
+#include "Window.h"
+
+#include <thread>
+
+void initFramePacer(FramePacer* pacer, FramePacing pacing, float32 targetFrameMs)
+{
+    pacer->pacing = pacing;
+    pacer->targetFrameMs = targetFrameMs;
+    pacer->frameStart = std::chrono::steady_clock::now();
+
+    glfwSwapInterval(pacing == FramePacing::VSYNC ? 1 : 0);
+}
+
+void waitForNextFrame(FramePacer* pacer)
+{
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<float32, std::milli>;
+
+    Clock::time_point now = Clock::now();
+
+    if (pacer->pacing != FramePacing::SLEEP)
+    {
+        pacer->frameStart = now;
+        return;
+    }
+
+    Clock::time_point frameEnd = pacer->frameStart + std::chrono::duration_cast<Clock::duration>(Milliseconds(pacer->targetFrameMs));
+
+    if (now >= frameEnd)
+    {
+        pacer->frameStart = now;
+        return;
+    }
+
+    Clock::time_point spinStart = frameEnd - std::chrono::duration_cast<Clock::duration>(Milliseconds(FRAME_PACER_SPIN_MS));
+    if (now < spinStart) std::this_thread::sleep_until(spinStart);
+
+    while (Clock::now() < frameEnd)
+    {
+        std::this_thread::yield();
+    }
+
+    pacer->frameStart = frameEnd;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "als/als_types.h"
+
+#include <chrono>
+
+//
+// How the main loop waits out the rest of each frame. The simulation steps at a fixed rate regardless (see
+// SIMULATION_STEP_MS), so this only decides how often it renders.
+//
+enum class FramePacing : uint8
+{
+    UNCAPPED,       // Never waits. For benchmarking, where the frame rate is what's being measured.
+    SLEEP,          // Sleeps until the target frame time, then spins for the last FRAME_PACER_SPIN_MS
+    VSYNC,          // Leaves it to the swap interval
+
+    ENUM_VALUE_COUNT
+};
+
+// A sleep can overshoot by a whole scheduler tick, so the end of the frame is spun out instead
+#define FRAME_PACER_SPIN_MS 2.0f
+
+struct FramePacer
+{
+    FramePacing pacing = FramePacing::SLEEP;
+    float32 targetFrameMs = 1000.0f / 60.0f;
+
+    std::chrono::steady_clock::time_point frameStart;
+};
+
+// Also sets the swap interval, so the window's GL context must be current
+void initFramePacer(FramePacer* pacer, FramePacing pacing, float32 targetFrameMs);
+
+//
+// Call once a frame, after swapping buffers. Waits (or doesn't) until the next frame should start. Frames are paced
+// from when the last one was due to start rather than when it finished, so the frame rate doesn't drift. A frame that
+// runs long starts the schedule over instead of rushing the next few to catch up.
+//
+void waitForNextFrame(FramePacer* pacer);
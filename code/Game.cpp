@@ -33,6 +33,7 @@
 #include "GL/glew.h"
 #include "Ray.h"
 #include "Gjk.h"
+#include "ecs/systems/CollisionSystem.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -41,6 +42,10 @@
 #include "Reflection.h"
 
 #include "ecs/systems/MovementSystem.h"
+#include "ecs/systems/CharacterControllerSystem.h"
+#include "ecs/systems/SystemScheduler.h"
+#include "ecs/TransformHierarchy.h"
+#include "als/als_job_system.h"
 
 #include "platform/platform.h"
 
@@ -82,46 +87,33 @@ void loadLevel(Scene* scene, FilenameString levelFilename)
     FilenameString fullFilename = ResourceManager::instance().toFullPath(levelFilename);
     assert(fullFilename.substring(fullFilename.length - 4) == ".obj");
 
+    // Levels are almost entirely static, which is what sweep and prune is good at
+    setBroadphase(&scene->ecs, Broadphase::SweepAndPrune);
     loadObjSubobjectsAsEntities(levelFilename, &scene->ecs, true, true);
+
+    // The level geometry doesn't move, so it can go straight into world space
+    bakeStaticCollisionWorld(&scene->ecs);
 }
 
 EntityDetails* getEntityDetails(Game* game, uint32 entityId)
 {
-    //
-    // @Slow
-    // Can we accelerate this somehow? It is very convenient to be able to get the entire entity just from its id
-    // (so that way we can only store the ID of "linked" entities (like portals) and not worry about having things
-    // like the entity's ecs go out of date (if the entity were to, say, enter a new scene)
-    //
-    
-    EntityDetails* result = nullptr;
-    
-    for (uint32 i = 0; i < game->numScenes; i++)
-    {
-        Entity probe;
-        probe.id = entityId;
-        probe.ecs = &game->scenes[i].ecs;
-
-        result = getComponent<EntityDetails>(probe);
-
-        if (result) break;
-    }
+    const EntityDirectoryEntry* entry = lookupEntity(entityId);
+    if (entry == nullptr) return nullptr;
 
-    return result;
+    return entry->details;
 }
 
 Entity getEntity(Game* game, uint32 entityId)
 {
-    // @Slow
-    // Can we accelerate this somehow? It is very convenient to be able to get the entire entity just from its id
-    // (so that way we can only store the ID of "linked" entities (like portals) and not worry about having things
-    // like the entity's ecs go out of date (if the entity were to, say, enter a new scene)
+    // Note: Ids are global, so the game isn't actually needed to find the entity. The entity directory knows which
+    //       ECS owns it (even if it has moved to another scene).
     Entity result;
-    EntityDetails* details = getEntityDetails(game, entityId);
+    const EntityDirectoryEntry* entry = lookupEntity(entityId);
 
-    if (details)
+    if (entry)
     {
-        result = details->entity;
+        result.id = entityId;
+        result.ecs = entry->ecs;
     }
 
     return result;
@@ -129,17 +121,18 @@ Entity getEntity(Game* game, uint32 entityId)
 
 Entity getEntity(Game* game, PotentiallyStaleEntity* potentiallyStaleEntity)
 {
-    Entity result; potentiallyStaleEntity;
+    Entity result;
     result.id = potentiallyStaleEntity->id;
     result.ecs = potentiallyStaleEntity->ecs;
 
     if (potentiallyStaleEntity->id == 0) return result;
 
-    if (result.ecs == nullptr || getComponent<EntityDetails>(result) == nullptr)
+    result = getEntity(game, potentiallyStaleEntity->id);
+
+    if (potentiallyStaleEntity->ecs != result.ecs)
     {
-        // Stale!
-        result = getEntity(game, potentiallyStaleEntity->id);
-        potentiallyStaleEntity->ecs = result.ecs; // Update the stale entity so it won't be stale next time!
+        // Stale! Update it so it won't be stale next time
+        potentiallyStaleEntity->ecs = result.ecs;
     }
 
     return result;
@@ -150,96 +143,6 @@ Game* getGame(Entity e)
     return e.ecs->game;
 }
 
-void deleteMarkedEntities(Game* game)
-{
-    for (PotentiallyStaleEntity staleEntity : game->entitiesMarkedForDeletion)
-    {
-        Entity e = getEntity(game, &staleEntity);
-        EntityDetails* details = getComponent<EntityDetails>(e);
-        if (details == nullptr)
-        {
-            assert(false);
-            continue;
-        }
-
-        TransformComponent*        xfm              = getComponent<TransformComponent>(e);
-        CameraComponent*           camera           = getComponent<CameraComponent>(e);
-        DirectionalLightComponent* directionalLight = getComponent<DirectionalLightComponent>(e);
-        TerrainComponent*          terrain          = getComponent<TerrainComponent>(e);
-        auto                       pointLights      = getComponents<PointLightComponent>(e);
-        auto                       renderComponents = getComponents<RenderComponent>(e);
-        PortalComponent*           portal           = getComponent<PortalComponent>(e);
-        auto                       colliders        = getComponents<ColliderComponent>(e);
-        WalkComponent*             walk             = getComponent<WalkComponent>(e);
-
-        Ecs* ecs = e.ecs;
-
-        // Remove mandatory components
-        {
-            removeComponent(&details);
-            removeComponent(&xfm);
-        }
-
-        //
-        // @Note: For the most part, we could directly call templated removeComponent function and just pass the correct collection,
-        //        but some components have some logic when they get removed. For example, portal components will unlink their
-        //        connected portal (if any) when they are removed.
-        //
-        //        We do call the templated version for the mandatory components simply because they are so few and we know none of
-        //        them require special logic. This isn't necessarily so however, so it could be changed.
-        //
-    
-        // Remove optional single components
-        {
-            if (camera)           removeComponent(&camera);
-            if (directionalLight) removeComponent(&directionalLight);
-            if (terrain)          removeComponent(&terrain);
-            if (portal)           removeComponent(&portal);
-            if (walk)             removeComponent(&walk);
-        }
-
-        // Remove optional multi components
-        {
-            if (pointLights.numComponents > 0)
-            {
-                for (uint32 i = 0; i < pointLights.numComponents; i++)
-                {
-                    PointLightComponent* component = &pointLights[i];
-                    removeComponent<PointLightComponent>(&component);
-                }
-            }
-
-            if (renderComponents.numComponents > 0)
-            {
-                for (uint32 i = 0; i < renderComponents.numComponents; i++)
-                {
-                    RenderComponent* component = &renderComponents[i];
-                    removeComponent<RenderComponent>(&component);
-                }
-            }
-
-            if (colliders.numComponents > 0)
-            {
-                for (uint32 i = 0; i < colliders.numComponents; i++)
-                {
-                    ColliderComponent* component = &colliders[i];
-                    removeComponent<ColliderComponent>(&component);
-                }
-            }
-        }
-
-        e.ecs->entities.erase(std::find(e.ecs->entities.begin(), e.ecs->entities.end(), e));
-
-        if (game->editor.selectedEntity.id == e.id)
-        {
-            game->editor.selectedEntity.id = 0;
-        }
-    }
-
-
-    game->entitiesMarkedForDeletion.clear();
-}
-
 ///////////////////////////////////////////////////////////////////////
 //////////// BEGIN SCRATCHPAD (throwaway or refactorable code)
 
@@ -496,14 +399,14 @@ void buildTestScene2(Scene* scene)
 
         auto rcc = addComponents<RenderComponent>(e, icosahedronMesh->submeshes.size());
 
-        ColliderComponent *cc = addComponent<ColliderComponent>(e);
-        new (cc) ColliderComponent(e, icosahedronMesh->bounds);
-                                   
         for(uint32 j = 0; j < icosahedronMesh->submeshes.size(); j++)
         {
             RenderComponent *rc = &rcc[j];
             new (rc) RenderComponent(e, &(icosahedronMesh->submeshes[j]));
         }
+
+        ColliderComponent *cc = addComponent<ColliderComponent>(e);
+        new (cc) ColliderComponent(e, icosahedronMesh->bounds);
     }
 }
 
@@ -513,7 +416,7 @@ void buildTestScene3(Scene* scene)
 
     ResourceManager& rm = ResourceManager::instance();
     
-    Mesh *shuttleMesh = rm.initMesh("shuttle/shuttle.obj", true, MeshLoadOptions::CPU_AND_GPU);
+    Mesh *shuttleMesh = rm.initMesh("shuttle/shuttle.obj", true, MeshLoadOptions::CPU_AND_GPU, true);
     Mesh *bulb = rm.initMesh("bulb/bulb.obj", false, MeshLoadOptions::CPU_AND_GPU);
 
     // Set up directional light
@@ -547,8 +450,6 @@ void buildTestScene3(Scene* scene)
         
         auto rcc = addComponents<RenderComponent>(e, shuttleMesh->submeshes.size());
 
-        auto it = (rcc).bucketArray->addressOf((rcc).components[0]);
-
         for (uint32 j = 0; j < rcc.numComponents; j++)
         {
             RenderComponent *rc = &rcc[j];
@@ -557,63 +458,215 @@ void buildTestScene3(Scene* scene)
     }
 }
 
+void updateCameraFollow(Game* game, float32 alpha)
+{
+    TransformComponent* playerXfm = getComponent<TransformComponent>(game->player);
+    Vec3 playerPos = interpolatedPosition(&game->activeScene->ecs.transformHierarchy, playerXfm, alpha);
+    Vec3 camPos = playerPos + Vec3(0, 12, 20);
+    Quaternion camRot = lookRotation(playerPos - camPos, Vec3(0, 1, 0));
+
+    TransformComponent* camXfm = getComponent<TransformComponent>(game->activeCamera);
+    camXfm->setPosition(camPos);
+    camXfm->setOrientation(camRot);
+}
+
+void toggleEditor(Game* game)
+{
+    if (keys[GLFW_KEY_GRAVE_ACCENT] && !lastKeys[GLFW_KEY_GRAVE_ACCENT])
+    {
+        game->editor.isEnabled = !game->editor.isEnabled;
+
+        if (game->editor.isEnabled)
+        {
+            glfwSetInputMode(game->window->glfwWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        }
+        else
+        {
+            glfwSetInputMode(game->window->glfwWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        }
+    }
+}
+
+void renderActiveScene(Game* game)
+{
+    CameraComponent* camComponent = getComponent<CameraComponent>(game->activeCamera);
+    TransformComponent* camXfm = getComponent<TransformComponent>(game->activeCamera);
+
+    renderScene(&game->renderer, game->activeScene, camComponent, camXfm);
+}
+
 void updateGame(Game* game)
 {
     assert(game->activeScene != nullptr);
 
+    SystemScheduler* scheduler = &game->scheduler;
+    Ecs* activeEcs = &game->activeScene->ecs;
+
+    ComponentMask transform = componentBit(ComponentType::Transform);
+    ComponentMask colliders = componentBit(ComponentType::Collider) | componentBit(ComponentType::ConvexHullCollider);
+
     //
-    // Update camera and position
+    // Fixed timestep. The simulation steps by SIMULATION_STEP_MS however long the frame took, and rendering interpolates
+    // between the last two steps, alpha of the way from the second to last.
     //
-    walkAndCamera(game);
+    game->simulationAccumulatorMs += deltaTMs;
+
+    uint32 stepCount = 0;
+    while (game->simulationAccumulatorMs >= SIMULATION_STEP_MS && stepCount < MAX_SIMULATION_STEPS_PER_FRAME)
+    {
+        game->simulationAccumulatorMs -= SIMULATION_STEP_MS;
+        stepCount++;
+    }
+
+    // Too far behind. Drop the time instead of carrying it into the next frame.
+    if (game->simulationAccumulatorMs >= SIMULATION_STEP_MS) game->simulationAccumulatorMs = 0;
+
+    float32 alpha = game->simulationAccumulatorMs / SIMULATION_STEP_MS;
+
+    // @Note: The systems are re-added every frame since the scene they run on (activeScene) can change. The order they
+    //        are added in is the order that conflicting systems run in.
+    clearSystems(scheduler);
 
     //
-    // Update camera
+    // Player input. Once a frame, before any steps. A jump stays pressed until a step uses it.
     //
     {
-        Vec3 playerPos = getComponent<TransformComponent>(game->player)->position();
-        Vec3 camPos = playerPos + Vec3(0, 12, 20);
-        Quaternion camRot = lookRotation(playerPos - camPos, Vec3(0, 1, 0));
-
-        TransformComponent* camXfm = getComponent<TransformComponent>(game->activeCamera);
-        camXfm->setPosition(camPos);
-        camXfm->setOrientation(camRot);
+        SystemDesc playerIntent;
+        playerIntent.name = "playerIntent";
+        playerIntent.ecs = activeEcs;
+        playerIntent.reads = transform;
+        playerIntent.writes = componentBit(ComponentType::Agent);
+        playerIntent.update = [game]() { updatePlayerIntent(game); };
+        addSystem(scheduler, playerIntent);
     }
-    
+
     //
-    // Enable/disable editor
+    // Simulation steps. Each one records where everything was before it, for interpolation.
     //
-    if (keys[GLFW_KEY_GRAVE_ACCENT] && !lastKeys[GLFW_KEY_GRAVE_ACCENT])
+    // @Note: The scheduler refreshes the transforms' cached world values after anything that moves them, so the systems
+    //        that only read transforms (the snapshot, the broadphase, player input) can run at the same time.
+    //
+    for (uint32 step = 0; step < stepCount; step++)
     {
-        game->editor.isEnabled = !game->editor.isEnabled;
+        SystemDesc snapshot;
+        snapshot.name = "snapshotTransforms";
+        snapshot.ecs = activeEcs;
+        snapshot.reads = transform;
+        snapshot.update = [game, activeEcs]() { snapshotTransforms(&game->jobs, activeEcs); };
+        addSystem(scheduler, snapshot);
 
-        if (game->editor.isEnabled)
+        //
+        // Refit the broadphase
+        //
+        SystemDesc broadphase;
+        broadphase.name = "broadphase";
+        broadphase.ecs = activeEcs;
+        broadphase.reads = transform;
+        broadphase.writes = colliders;
+        broadphase.update = [activeEcs]() { updateBroadphase(activeEcs); };
+        addSystem(scheduler, broadphase);
+
+        //
+        // Move every agent
+        //
+        SystemDesc characterControllers;
+        characterControllers.name = "characterControllers";
+        characterControllers.ecs = activeEcs;
+        characterControllers.reads = colliders;
+        characterControllers.writes = transform | componentBit(ComponentType::Agent);
+        characterControllers.update = [game, activeEcs]() { updateCharacterControllers(activeEcs, &game->jobs, SIMULATION_STEP_MS / 1000.0f); };
+        addSystem(scheduler, characterControllers);
+
+        // Only the last step is interpolated. After any earlier one, the next step's snapshot would throw it away.
+        if (step == stepCount - 1)
         {
-            glfwSetInputMode(game->window->glfwWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+            SystemDesc markMoved;
+            markMoved.name = "markMovedTransforms";
+            markMoved.ecs = activeEcs;
+            markMoved.reads = transform;
+            markMoved.update = [game, activeEcs]() { markMovedTransforms(&game->jobs, activeEcs); };
+            addSystem(scheduler, markMoved);
         }
-        else
+    }
+
+    //
+    // Update camera
+    //
+    {
+        SystemDesc cameraFollow;
+        cameraFollow.name = "cameraFollow";
+        cameraFollow.ecs = activeEcs;
+        cameraFollow.writes = transform;
+        cameraFollow.update = [game, alpha]() { updateCameraFollow(game, alpha); };
+        addSystem(scheduler, cameraFollow);
+    }
+
+    //
+    // Bring world matrices up to date for rendering. Every scene, since portals render the scenes they lead to. Only the
+    // active scene is simulated, so only it is interpolated.
+    //
+    {
+        SystemDesc worldMatrices;
+        worldMatrices.name = "worldMatrices";
+        worldMatrices.ecs = nullptr;
+        worldMatrices.writes = transform;
+        worldMatrices.update = [game, alpha]()
         {
-            glfwSetInputMode(game->window->glfwWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-        }
+            for (uint32 i = 0; i < game->numScenes; i++)
+            {
+                Ecs* ecs = &game->scenes[i].ecs;
+                updateWorldMatrices(&game->jobs, ecs, ecs == &game->activeScene->ecs ? alpha : 1);
+            }
+        };
+        addSystem(scheduler, worldMatrices);
     }
 
     //
-    // Render
+    // Enable/disable editor
     //
     {
-        CameraComponent* camComponent = getComponent<CameraComponent>(game->activeCamera);
-        TransformComponent* camXfm = getComponent<TransformComponent>(game->activeCamera);
+        SystemDesc editorToggle;
+        editorToggle.name = "toggleEditor";
+        editorToggle.flags = SystemFlag_MainThreadOnly;
+        editorToggle.update = [game]() { toggleEditor(game); };
+        addSystem(scheduler, editorToggle);
+    }
 
-        renderScene(&game->renderer, game->activeScene, camComponent, camXfm);
+    //
+    // Render
+    // Note: Portals render the scenes they connect to, so this can't be confined to the active ECS
+    //
+    {
+        SystemDesc render;
+        render.name = "render";
+        render.ecs = nullptr;
+        render.reads = transform | colliders |
+            componentBit(ComponentType::Camera) |
+            componentBit(ComponentType::Render) |
+            componentBit(ComponentType::PointLight) |
+            componentBit(ComponentType::DirectionalLight) |
+            componentBit(ComponentType::Portal);
+        render.flags = SystemFlag_MainThreadOnly;
+        render.update = [game]() { renderActiveScene(game); };
+        addSystem(scheduler, render);
     }
 
     //
     // Editor mode
-    // Note: Editor should always be shown AFTER rendering
+    // Note: Editor should always be shown AFTER rendering. It can edit anything, so it declares that it does.
     //
     if (game->editor.isEnabled)
     {
-        showEditor(&game->editor);
+        SystemDesc editor;
+        editor.name = "editor";
+        editor.ecs = nullptr;
+        editor.writes = componentBit(ComponentType::ENUM_VALUE_COUNT) - 1;
+        editor.flags = SystemFlag_MainThreadOnly;
+        editor.update = [game]() { showEditor(&game->editor); };
+        addSystem(scheduler, editor);
     }
+
+    runSystems(scheduler);
 }
 
 // END SCRATCHPAD
@@ -702,6 +755,10 @@ int main()
     game->window = &window;
     
     initRenderer(&game->renderer, game->window);
+
+    uint32 hardwareThreads = std::thread::hardware_concurrency();
+    initJobSystem(&game->jobs, hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+    initSystemScheduler(&game->scheduler, &game->jobs);
     
     Scene* testScene1 = makeScene(game);
     buildTestScene1(testScene1);
@@ -717,9 +774,7 @@ int main()
     // scene. Maybe the game has its own ECS outside of scenes or maybe make system to transfer ownership
     // from one scene to another scene
     Entity camera = makeEntity(&testScene1->ecs, "camera");
-    TransformComponent* cameraXfm = getComponent<TransformComponent>(camera);
-    CameraComponent* cameraComponent = addComponent<CameraComponent>(camera);
-    cameraComponent->window = &window;
+    addComponent<CameraComponent>(camera)->window = &window;
 
     // Set up player
     // @Hack: same as camera hack
@@ -750,6 +805,8 @@ int main()
         //assert(testScene1->ecs.walkComponents.count() > 0);
         //playerWalk->terrain = testScene1->ecs.terrains[0].entity;
     }
+
+    CameraComponent* cameraComponent = getComponent<CameraComponent>(camera);
     
 #if 1
     cameraComponent->isOrthographic = false;
@@ -764,8 +821,7 @@ int main()
     cameraComponent->far = 1000.0f;
     recalculateProjectionMatrix(cameraComponent);
 
-    DebugDraw::instance().cameraComponent = cameraComponent;
-    DebugDraw::instance().cameraXfm = cameraXfm;
+    DebugDraw::instance().camera = camera;
     DebugDraw::instance().window = &window;
     
     ////
@@ -810,6 +866,9 @@ int main()
 
     makeSceneActive(game, testScene1);
     makeCameraActive(game, camera);
+
+    // FramePacing::UNCAPPED to benchmark
+    initFramePacer(&game->pacer, FramePacing::SLEEP, 1000.0f / 60.0f);
     
     while(!glfwWindowShouldClose(window.glfwWindow))
     {
@@ -835,7 +894,7 @@ int main()
         updateJoystickInput();
 
         updateGame(game);
-        deleteMarkedEntities(game);
+        playbackCommandBuffer(game, &game->commands);
 
 #if 0
         bool foo;
@@ -877,7 +936,7 @@ int main()
         updateLastKeysAndMouseButtonsAndJoystickButtons();
         clearTempAlloc();
         
-        std::this_thread::sleep_for(std::chrono::milliseconds(33)); // TODO: proper FPS and timing stuff
+        waitForNextFrame(&game->pacer);
     }
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -3,12 +3,22 @@
 #include "Editor.h"
 #include "Scene.h"
 #include "ecs/systems/RenderSystem.h"
+#include "ecs/systems/SystemScheduler.h"
+#include "als/als_job_system.h"
+#include "ecs/EcsCommandBuffer.h"
+#include "FramePacer.h"
 
 #define MAX_SCENES 8
 #define MOUSE_BUTTON_COUNT 8
 #define JOYSTICK_BUTTON_COUNT 32
 #define KEY_COUNT 1024
 
+// The simulation always steps by this much, however long frames take to render
+#define SIMULATION_STEP_MS (1000.0f / 60.0f)
+
+// Past this many steps in one frame, the simulation slows down instead of falling further and further behind
+#define MAX_SIMULATION_STEPS_PER_FRAME 4
+
 extern float mouseX;
 extern float mouseY;
 extern float mouseXPrev;
@@ -61,6 +71,8 @@ struct Game
     Window* window;
 
     Renderer renderer;
+    JobSystem jobs;
+    SystemScheduler scheduler;
 
     // @TODO: Should these be PotentiallyStaleEntity ?
     Entity activeCamera;
@@ -68,8 +80,13 @@ struct Game
 
     uint32 numScenes;
 
-    // End of frame bookkeeping
-    std::vector<PotentiallyStaleEntity> entitiesMarkedForDeletion;
+    // Structural changes recorded during the frame, played back at the end of it
+    EcsCommandBuffer commands;
+
+    FramePacer pacer;
+
+    // Time that has passed but hasn't been simulated yet. Less than a step once updateGame(..) has stepped.
+    float32 simulationAccumulatorMs;
 };
 
 Scene* makeScene(Game* game);
@@ -82,4 +99,3 @@ Entity getEntity(Game* game, uint32 entityId);
 
 Game* getGame(Entity e);
 
-void deleteMarkedEntities(Game* game);
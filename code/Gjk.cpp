@@ -2,10 +2,24 @@
 #include <assert.h>
 #include "float.h"
 
+#include <queue>
+#include <vector>
+
 // Reference:
 // https://www.youtube.com/watch?v=Qupqu1xe7Io
 
-#define EPA_MAX_FACES 64
+#define GJK_DEGENERATE_LENGTH_SQUARED 1e-12f
+
+// SOME tolerance for things like spheres/cylinders which can almost always get a LIIIIITLE closer
+#define EPA_TOLERANCE 0.01f
+#define EPA_MAX_ITERATIONS 128
+
+// Faces the new point is this close to being in front of count as visible, so it never makes a sliver with a horizon edge
+#define EPA_COPLANAR_EPSILON 1e-5f
+
+// gjkSweep(..) counts the colliders as touching once they're this close
+#define GJK_SWEEP_TOLERANCE 1e-4f
+#define GJK_SWEEP_MAX_ITERATIONS 32
 
 namespace Gjk
 {
@@ -15,22 +29,68 @@ namespace Gjk
         // Most "recent" point is always points[count-1]
         Vec3 points [4];
         uint32 pointCount = 0;
+
+        // The support points on a and b that each point came from, for EPA's contact points
+        Vec3 supportsA[4];
+        Vec3 supportsB[4];
     };
 
-    Vec3 minkowskiSupport(ICollider* a, ICollider* b, Vec3 direction)
+    Vec3 minkowskiSupport(ICollider* a, ICollider* b, GjkCache* cache, Vec3 direction, Vec3* supportA=nullptr, Vec3* supportB=nullptr)
     {
-        Vec3 result = a->support(direction) - b->support(-direction);
+        Vec3 onA = a->support(direction, cache ? &cache->warmStartA : nullptr);
+        Vec3 onB = b->support(-direction, cache ? &cache->warmStartB : nullptr);
+
+        if (supportA) *supportA = onA;
+        if (supportB) *supportB = onB;
+
+        Vec3 result = onA - onB;
         return result;
     }
 
-    void addPointToSimplex(Simplex* simplex, Vec3 valueToAdd)
+    void addPointToSimplex(Simplex* simplex, Vec3 valueToAdd, Vec3 supportA, Vec3 supportB)
     {
         assert(simplex->pointCount < 4);
         
         simplex->points[simplex->pointCount] = valueToAdd;
+        simplex->supportsA[simplex->pointCount] = supportA;
+        simplex->supportsB[simplex->pointCount] = supportB;
         simplex->pointCount++;
     }
 
+    // Too short to search along, or to normalize
+    inline bool isDegenerateDirection(Vec3 direction)
+    {
+        return lengthSquared(direction) < GJK_DEGENERATE_LENGTH_SQUARED;
+    }
+
+    // Any direction perpendicular to the simplex, for when the origin lies on it
+    Vec3 directionOffSimplex(Simplex* simplex)
+    {
+        Vec3 result;
+
+        if (simplex->pointCount >= 3)
+        {
+            Vec3 a = simplex->points[simplex->pointCount - 1];
+            result = cross(simplex->points[1] - a, simplex->points[0] - a);
+            if (!isDegenerateDirection(result)) return result;
+        }
+
+        if (simplex->pointCount >= 2)
+        {
+            // A line, or a triangle so thin it might as well be one. Cross it with whichever axis it's least along.
+            Vec3 ab = simplex->points[1] - simplex->points[0];
+            Vec3 axis = Vec3(Axis3D::X);
+
+            if (fabs(ab.y) < fabs(ab.x) && fabs(ab.y) <= fabs(ab.z)) axis = Vec3(Axis3D::Y);
+            else if (fabs(ab.z) < fabs(ab.x) && fabs(ab.z) < fabs(ab.y)) axis = Vec3(Axis3D::Z);
+
+            result = cross(ab, axis);
+            if (!isDegenerateDirection(result)) return result;
+        }
+
+        return Vec3(Axis3D::X);
+    }
+
     void clearSimplex(Simplex* simplex)
     {
         simplex->pointCount = 0;
@@ -38,10 +98,30 @@ namespace Gjk
 
     void reconstructSimplex(Simplex* simplex, Vec3* points, uint32 numPoints)
     {
+        // points are copies of points already in the simplex. Match them back up to carry their support points along.
+        Vec3 supportsA[4];
+        Vec3 supportsB[4];
+
+        for(uint32 i = 0; i < numPoints; i++)
+        {
+            for(uint32 j = 0; j < simplex->pointCount; j++)
+            {
+                Vec3 existing = simplex->points[j];
+                if(existing.x == points[i].x && existing.y == points[i].y && existing.z == points[i].z)
+                {
+                    supportsA[i] = simplex->supportsA[j];
+                    supportsB[i] = simplex->supportsB[j];
+                    break;
+                }
+            }
+        }
+
         clearSimplex(simplex);
         for(uint32 i = 0; i < numPoints; i++)
         {
             simplex->points[i] = points[i];
+            simplex->supportsA[i] = supportsA[i];
+            simplex->supportsB[i] = supportsB[i];
         }
 
         simplex->pointCount = numPoints;
@@ -206,221 +286,624 @@ namespace Gjk
     }
 }
 
+//
+// Expanding polytope algorithm. Starts from GJK's tetrahedron around the origin and keeps pushing out the face closest to
+// the origin until it's on the surface of the Minkowski difference. That face's normal and distance are the smallest
+// translation that separates the colliders.
+//
+// The polytope is a triangle mesh where each face knows the face and edge on the other side of each of its edges (the
+// twin half-edge), so the faces a new support point can see are found by walking out from the closest face, and their
+// outline (the horizon) comes out in order. Each face's normal and distance are computed once when it's added, and
+// faces are popped closest first from a min-heap. Removed faces stay in the heap and are skipped when they come up.
+//
+// Reference: van den Bergen, "Proximity Queries and Penetration Depth Computation on 3D Game Objects" (GDC 2001)
+//
 namespace Epa
 {
-    struct Simplex
+    struct Vertex
     {
-        Triangle faces[EPA_MAX_FACES];
-        uint32 faceCount;
+        Vec3 point;     // In the Minkowski difference a - b
+        Vec3 supportA;  // The points on a and b it's the difference of
+        Vec3 supportB;
     };
 
-    void addTriangleToSimplex(Simplex* simplex, Triangle triangle)
+    //
+    // Edge i goes from vertices[i] to vertices[(i + 1) % 3], counter-clockwise seen from outside. The same edge going the
+    // other way is edge twinEdges[i] of face twinFaces[i].
+    //
+    struct Face
     {
-        assert(simplex->faceCount < EPA_MAX_FACES);
-        simplex->faces[simplex->faceCount] = triangle;
-        simplex->faceCount++;
+        uint32 vertices[3];
+        uint32 twinFaces[3];
+        uint32 twinEdges[3];
+
+        Vec3 normal;        // Unit, pointing out of the polytope
+        float32 distance;   // From the origin to the face's plane
+
+        bool obsolete;
+    };
+
+    struct HeapEntry
+    {
+        float32 distance;
+        uint32 face;
+    };
+
+    struct FurtherFromOrigin
+    {
+        bool operator()(HeapEntry a, HeapEntry b) const { return a.distance > b.distance; }
+    };
+
+    struct HorizonEdge
+    {
+        uint32 face;
+        uint32 edge;
+    };
+
+    struct Polytope
+    {
+        std::vector<Vertex> vertices;
+        std::vector<Face> faces;
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, FurtherFromOrigin> heap;
+
+        std::vector<HorizonEdge> horizon; // Scratch for expandPolytope(..)
+    };
+
+    // Returns false if the triangle is too thin to have a normal
+    bool addFace(Polytope* polytope, uint32 v0, uint32 v1, uint32 v2)
+    {
+        Vec3 a = polytope->vertices[v0].point;
+        Vec3 b = polytope->vertices[v1].point;
+        Vec3 c = polytope->vertices[v2].point;
+
+        Vec3 normal = cross(b - a, c - a);
+        if (lengthSquared(normal) < GJK_DEGENERATE_LENGTH_SQUARED) return false;
+
+        Face face;
+        face.vertices[0] = v0;
+        face.vertices[1] = v1;
+        face.vertices[2] = v2;
+        face.normal = normalize(normal);
+        face.distance = dot(face.normal, a);
+        face.obsolete = false;
+
+        HeapEntry entry;
+        entry.distance = face.distance;
+        entry.face = polytope->faces.size();
+
+        polytope->faces.push_back(face);
+        polytope->heap.push(entry);
+
+        return true;
     }
-        
-    void initSimplexFromGjkSimplex(Simplex* simplex, Gjk::Simplex* gjkSimplex)
+
+    void linkEdges(Polytope* polytope, uint32 faceA, uint32 edgeA, uint32 faceB, uint32 edgeB)
+    {
+        polytope->faces[faceA].twinFaces[edgeA] = faceB;
+        polytope->faces[faceA].twinEdges[edgeA] = edgeB;
+        polytope->faces[faceB].twinFaces[edgeB] = faceA;
+        polytope->faces[faceB].twinEdges[edgeB] = edgeA;
+    }
+
+    // Returns false if GJK's tetrahedron is flat, which means the colliders are only just touching
+    bool initPolytopeFromGjkSimplex(Polytope* polytope, Gjk::Simplex* gjkSimplex)
     {
         assert(gjkSimplex->pointCount == 4);
-            
-        Vec3 a = gjkSimplex->points[3];
-        Vec3 b = gjkSimplex->points[2];
-        Vec3 c = gjkSimplex->points[1];
-        Vec3 d = gjkSimplex->points[0];
 
-        simplex->faceCount = 0;
-        
-        addTriangleToSimplex(simplex, Triangle(a, c, b));
-        addTriangleToSimplex(simplex, Triangle(a, d, c));
-        addTriangleToSimplex(simplex, Triangle(a, b, d));
-        addTriangleToSimplex(simplex, Triangle(b, c, d));
+        for (uint32 i = 0; i < 4; i++)
+        {
+            Vertex vertex;
+            vertex.point = gjkSimplex->points[i];
+            vertex.supportA = gjkSimplex->supportsA[i];
+            vertex.supportB = gjkSimplex->supportsB[i];
+
+            polytope->vertices.push_back(vertex);
+        }
+
+        // Wind it so that vertex 3 is behind face 012, then every face below is counter-clockwise from outside
+        Vec3 p0 = polytope->vertices[0].point;
+        float32 volume = dot(cross(polytope->vertices[1].point - p0, polytope->vertices[2].point - p0), polytope->vertices[3].point - p0);
+
+        if (fabs(volume) < GJK_DEGENERATE_LENGTH_SQUARED) return false;
+
+        if (volume > 0)
+        {
+            Vertex temp = polytope->vertices[1];
+            polytope->vertices[1] = polytope->vertices[2];
+            polytope->vertices[2] = temp;
+        }
+
+        if (!addFace(polytope, 0, 1, 2)) return false;
+        if (!addFace(polytope, 0, 3, 1)) return false;
+        if (!addFace(polytope, 0, 2, 3)) return false;
+        if (!addFace(polytope, 1, 3, 2)) return false;
+
+        linkEdges(polytope, 0, 0, 1, 2); // 01
+        linkEdges(polytope, 0, 1, 3, 2); // 12
+        linkEdges(polytope, 0, 2, 2, 0); // 20
+        linkEdges(polytope, 1, 0, 2, 2); // 03
+        linkEdges(polytope, 1, 1, 3, 0); // 31
+        linkEdges(polytope, 2, 1, 3, 1); // 23
+
+        return true;
     }
 
-    void unorderedRemoveTriangleFromSimplex(Simplex* simplex, uint32 index)
+    //
+    // Reached face across its edge. If the new point can see it, it's removed and the walk carries on across its other two
+    // edges. If not, edge is part of the horizon. Visiting the edges in winding order puts the horizon in order too.
+    //
+    void findHorizon(Polytope* polytope, uint32 faceIndex, uint32 edge, Vec3 point)
     {
-        assert(index < simplex->faceCount);
-        simplex->faces[index] = simplex->faces[simplex->faceCount - 1];
-        simplex->faceCount--;
+        Face* face = &polytope->faces[faceIndex];
+        if (face->obsolete) return;
+
+        Vec3 onFace = polytope->vertices[face->vertices[0]].point;
+        if (dot(face->normal, point - onFace) <= -EPA_COPLANAR_EPSILON)
+        {
+            HorizonEdge horizonEdge;
+            horizonEdge.face = faceIndex;
+            horizonEdge.edge = edge;
+
+            polytope->horizon.push_back(horizonEdge);
+            return;
+        }
+
+        face->obsolete = true;
+
+        uint32 next = (edge + 1) % 3;
+        uint32 prev = (edge + 2) % 3;
+        findHorizon(polytope, face->twinFaces[next], face->twinEdges[next], point);
+        findHorizon(polytope, face->twinFaces[prev], face->twinEdges[prev], point);
     }
 
-    float32 closestFaceToOrigin(Simplex* simplex, Triangle* out_t, uint32* out_index)
+    // Replaces the faces vertex can see with a fan from the horizon to it. Returns false if that would be degenerate.
+    bool expandPolytope(Polytope* polytope, uint32 closestFace, Vertex vertex)
     {
-        Vec3 origin;
-        assert(simplex->faceCount <= EPA_MAX_FACES);
+        polytope->horizon.clear();
 
-        // We can "cheat" and project the point onto the plane defined by the triangle
-        // because if this gives us a shorter distance than it would be to the triangle
-        // then we are guaranteed to have a different face be even closer (due to the
-        // simplex's convexity)
+        Face* face = &polytope->faces[closestFace];
+        face->obsolete = true;
 
-        Triangle closestTriangle = simplex->faces[0];
-        float32 closestDistance = FLT_MAX;
-        uint32 closestIndex = 0;
-        
-        for(uint32 i = 0; i < simplex->faceCount; i++)
+        for (uint32 i = 0; i < 3; i++)
         {
-            Triangle triangle = simplex->faces[i];
-            Plane triPlane(triangle.a, triangleNormal(triangle));
+            findHorizon(polytope, face->twinFaces[i], face->twinEdges[i], vertex.point);
+        }
 
-            float32 dist = distance(
-                origin,
-                triPlane
-            );
-            
-            if(dist < closestDistance)
+        uint32 horizonCount = polytope->horizon.size();
+        if (horizonCount < 3) return false;
+
+        // Each horizon edge has to end where the next one starts. Numerical trouble right at the surface can break that.
+        for (uint32 i = 0; i < horizonCount; i++)
+        {
+            HorizonEdge current = polytope->horizon[i];
+            HorizonEdge next = polytope->horizon[(i + 1) % horizonCount];
+
+            uint32 currentEnd = polytope->faces[current.face].vertices[current.edge];
+            uint32 nextStart = polytope->faces[next.face].vertices[(next.edge + 1) % 3];
+
+            if (currentEnd != nextStart) return false;
+        }
+
+        uint32 newVertex = polytope->vertices.size();
+        polytope->vertices.push_back(vertex);
+
+        uint32 firstNewFace = polytope->faces.size();
+
+        for (uint32 i = 0; i < horizonCount; i++)
+        {
+            HorizonEdge horizonEdge = polytope->horizon[i];
+            Face* neighbor = &polytope->faces[horizonEdge.face];
+
+            // The new face has the horizon edge the other way around from the face that's staying
+            uint32 v0 = neighbor->vertices[(horizonEdge.edge + 1) % 3];
+            uint32 v1 = neighbor->vertices[horizonEdge.edge];
+
+            if (!addFace(polytope, v0, v1, newVertex)) return false;
+
+            linkEdges(polytope, firstNewFace + i, 0, horizonEdge.face, horizonEdge.edge);
+        }
+
+        for (uint32 i = 0; i < horizonCount; i++)
+        {
+            uint32 nextFace = firstNewFace + (i + 1) % horizonCount;
+            linkEdges(polytope, firstNewFace + i, 1, nextFace, 2);
+        }
+
+        return true;
+    }
+
+    void fillResult(Polytope* polytope, Face* face, GjkResult* result)
+    {
+        float32 depth = fmax(face->distance, 0.0f);
+
+        result->contactNormal = face->normal;
+        result->penetrationDepth = depth;
+        result->penetrationVector = face->normal * depth;
+
+        // The closest point on the face to the origin is the same combination of its vertices as the contact points are
+        // of theirs
+        Vertex a = polytope->vertices[face->vertices[0]];
+        Vertex b = polytope->vertices[face->vertices[1]];
+        Vertex c = polytope->vertices[face->vertices[2]];
+
+        Vec3 weights = barycentricCoordinate(a.point, b.point, c.point, face->normal * face->distance);
+
+        result->contactPointA = weights.x * a.supportA + weights.y * b.supportA + weights.z * c.supportA;
+        result->contactPointB = weights.x * a.supportB + weights.y * b.supportB + weights.z * c.supportB;
+    }
+
+    void epaPenetration(Gjk::Simplex* gjkSimplex, ICollider* a, ICollider* b, GjkCache* cache, GjkResult* result)
+    {
+        Polytope polytope;
+        polytope.vertices.reserve(32);
+        polytope.faces.reserve(64);
+
+        if (!initPolytopeFromGjkSimplex(&polytope, gjkSimplex))
+        {
+            // Zero penetration, somewhere on the GJK simplex
+            result->contactPointA = gjkSimplex->supportsA[3];
+            result->contactPointB = gjkSimplex->supportsB[3];
+            return;
+        }
+
+        uint32 closestFace = 0;
+
+        for (uint32 iteration = 0; iteration < EPA_MAX_ITERATIONS && !polytope.heap.empty(); iteration++)
+        {
+            HeapEntry entry = polytope.heap.top();
+            polytope.heap.pop();
+
+            if (polytope.faces[entry.face].obsolete) continue;
+
+            closestFace = entry.face;
+            Face face = polytope.faces[closestFace];
+
+            Vertex vertex;
+            vertex.point = Gjk::minkowskiSupport(a, b, cache, face.normal, &vertex.supportA, &vertex.supportB);
+
+            // Can't be pushed out any further, so it's the closest face on the surface
+            if (dot(vertex.point, face.normal) <= face.distance + EPA_TOLERANCE) break;
+
+            if (!expandPolytope(&polytope, closestFace, vertex)) break;
+        }
+
+        fillResult(&polytope, &polytope.faces[closestFace], result);
+    }
+}
+
+// Reference:
+// Ray Casting against General Convex Objects with Application to Continuous Collision Detection (van den Bergen)
+namespace GjkSweep
+{
+    // Closest point to the origin on segment ab. used gets a bit set for each of a and b that the point depends on.
+    Vec3 closestOnSegment(Vec3 a, Vec3 b, uint32* used)
+    {
+        Vec3 ab = b - a;
+        float32 t = -dot(a, ab);
+
+        if (t <= 0)
+        {
+            *used = 0x1;
+            return a;
+        }
+
+        float32 lengthSquaredAb = dot(ab, ab);
+        if (t >= lengthSquaredAb)
+        {
+            *used = 0x2;
+            return b;
+        }
+
+        *used = 0x3;
+        return a + ab * (t / lengthSquaredAb);
+    }
+
+    // Closest point to the origin on triangle abc, checking which of its Voronoi regions the origin is in. Real-Time
+    // Collision Detection (Ericson), 5.1.5.
+    Vec3 closestOnTriangle(Vec3 a, Vec3 b, Vec3 c, uint32* used)
+    {
+        Vec3 ab = b - a;
+        Vec3 ac = c - a;
+
+        float32 d1 = -dot(ab, a);
+        float32 d2 = -dot(ac, a);
+        if (d1 <= 0 && d2 <= 0)
+        {
+            *used = 0x1;
+            return a;
+        }
+
+        float32 d3 = -dot(ab, b);
+        float32 d4 = -dot(ac, b);
+        if (d3 >= 0 && d4 <= d3)
+        {
+            *used = 0x2;
+            return b;
+        }
+
+        float32 vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            *used = 0x3;
+            return a + ab * (d1 / (d1 - d3));
+        }
+
+        float32 d5 = -dot(ab, c);
+        float32 d6 = -dot(ac, c);
+        if (d6 >= 0 && d5 <= d6)
+        {
+            *used = 0x4;
+            return c;
+        }
+
+        float32 vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            *used = 0x5;
+            return a + ac * (d2 / (d2 - d6));
+        }
+
+        float32 va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            *used = 0x6;
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        }
+
+        float32 denominator = va + vb + vc;
+        if (denominator <= 0)
+        {
+            // Too thin to have an inside. The closest point is on one of its edges.
+            uint32 usedAb, usedAc, usedBc;
+            Vec3 onAb = closestOnSegment(a, b, &usedAb);
+            Vec3 onAc = closestOnSegment(a, c, &usedAc);
+            Vec3 onBc = closestOnSegment(b, c, &usedBc);
+
+            Vec3 result = onAb;
+            *used = usedAb;
+
+            if (lengthSquared(onAc) < lengthSquared(result))
             {
-                closestDistance = dist;
-                closestTriangle = triangle;
-                closestIndex = i;
+                result = onAc;
+                *used = (usedAc & 0x1) | ((usedAc & 0x2) << 1);
             }
-        }
 
-        assert(closestDistance < FLT_MAX);
-        *out_t = closestTriangle;
-        *out_index = closestIndex;
+            if (lengthSquared(onBc) < lengthSquared(result))
+            {
+                result = onBc;
+                *used = usedBc << 1;
+            }
 
-        return closestDistance;
+            return result;
+        }
+
+        *used = 0x7;
+        return a + ab * (vb / denominator) + ac * (vc / denominator);
     }
 
-    void extendSimplex(Simplex* simplex, Vec3 newPoint)
+    //
+    // Closest point of the simplex to from, relative to from. Drops the points it doesn't depend on. Zero if from is
+    // inside a tetrahedron, which keeps all 4.
+    //
+    Vec3 closestPointOnSimplex(Vec3* points, uint32* pointCount, Vec3 from)
     {
-        // @Slow
-        // TODO: consider making this simplex a half-edge mesh and re-using the "extend simplex" code from quickhull?
-            
-        struct Edge
+        Vec3 shifted[4];
+        for (uint32 i = 0; i < *pointCount; i++)
         {
-            Vec3 p0, p1;
-            Edge() = default;
-            Edge(Vec3 p0, Vec3 p1) { this->p0 = p0; this->p1 = p1; }
-        };
+            shifted[i] = points[i] - from;
+        }
 
-        Edge edges[EPA_MAX_FACES * 3];
-        uint32 edgeCount = 0;
+        Vec3 result;
+        uint32 used = 0;
 
-        for(uint32 i = 0; i < simplex->faceCount; i++)
+        switch (*pointCount)
         {
-            Triangle t = simplex->faces[i];
-            Vec3 normal = triangleNormal(t);
+            case 1:
+            {
+                result = shifted[0];
+                used = 0x1;
+            } break;
 
-            Vec3 aToNew = newPoint - t.a;
-            if(dot(normal, aToNew) > 0)
+            case 2:
             {
-                // This triangle is "visible", thus must be removed
-                
-                unorderedRemoveTriangleFromSimplex(simplex, i);
-                i--;
+                result = closestOnSegment(shifted[0], shifted[1], &used);
+            } break;
 
-                Edge ab(t.a, t.b);
-                Edge bc(t.b, t.c);
-                Edge ca(t.c, t.a);
+            case 3:
+            {
+                result = closestOnTriangle(shifted[0], shifted[1], shifted[2], &used);
+            } break;
 
-                bool abDup = false;
-                bool bcDup = false;
-                bool caDup = false;
-                
-                for(uint32 j = 0; j < edgeCount; j++)
+            case 4:
+            {
+                // The 3 points of each face, then the point opposite it
+                const uint32 faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+
+                bool inside = true;
+                float32 closestDistanceSquared = FLT_MAX;
+
+                //
+                // Closest of the faces' closest points. Only the face(s) the origin is in front of can have it, but on a
+                // sliver (which is most tetrahedrons near the end of a sweep) the side tests are down in the rounding
+                // error, so they only decide whether it's inside.
+                //
+                for (uint32 i = 0; i < 4; i++)
                 {
-                    Edge edge = edges[j];
-                    bool removeEdge = false;
-                    
-                    if(equals(edge.p0, ab.p1) && equals(edge.p1, ab.p0))
-                    {
-                        abDup = true;
-                        removeEdge = true;
-                    }
+                    Vec3 a = shifted[faces[i][0]];
+                    Vec3 b = shifted[faces[i][1]];
+                    Vec3 c = shifted[faces[i][2]];
+                    Vec3 d = shifted[faces[i][3]];
 
-                    if(equals(edge.p0, bc.p1) && equals(edge.p1, bc.p0))
-                    {
-                        bcDup = true;
-                        removeEdge = true;
-                    }
+                    Vec3 normal = cross(b - a, c - a);
+                    float32 originSide = -dot(a, normal);
+                    float32 oppositeSide = dot(d - a, normal);
 
-                    if(equals(edge.p0, ca.p1) && equals(edge.p1, ca.p0))
-                    {
-                        caDup = true;
-                        removeEdge = true;
-                    }
-                        
-                    // The edge is already in our list, which means it must be removed
-                    if(removeEdge)
+                    if (originSide * oppositeSide <= 0) inside = false;
+
+                    uint32 faceUsed;
+                    Vec3 closest = closestOnTriangle(a, b, c, &faceUsed);
+
+                    if (lengthSquared(closest) < closestDistanceSquared)
                     {
-                        edges[j] = edges[edgeCount - 1];
-                        edgeCount--;
-                        j--;
-                    }
-                }
+                        closestDistanceSquared = lengthSquared(closest);
+                        result = closest;
 
-                if(!abDup)
-                {
-                    edges[edgeCount] = ab;
-                    edgeCount++;
+                        used = 0;
+                        for (uint32 j = 0; j < 3; j++)
+                        {
+                            if (faceUsed & (1 << j)) used |= 1 << faces[i][j];
+                        }
+                    }
                 }
 
-                if(!bcDup)
+                if (inside)
                 {
-                    edges[edgeCount] = bc;
-                    edgeCount++;
+                    result = Vec3(0);
+                    used = 0xF;
                 }
+            } break;
 
-                if(!caDup)
-                {
-                    edges[edgeCount] = ca;
-                    edgeCount++;
-                }
-            }
+            default: assert(false);
         }
 
-
-        for(uint32 i = 0; i < edgeCount; i++)
+        uint32 count = 0;
+        for (uint32 i = 0; i < *pointCount; i++)
         {
-            Edge edge = edges[i];
-            Triangle newTri = Triangle(edge.p0, edge.p1, newPoint);
-            addTriangleToSimplex(simplex, newTri);
+            if (used & (1 << i))
+            {
+                points[count] = points[i];
+                count++;
+            }
         }
+
+        *pointCount = count;
+        return result;
     }
+}
 
-    Vec3 epaPenetrationVector(Gjk::Simplex* gjkSimplex, ICollider* a, ICollider* b)
+GjkSweepResult gjkSweep(ICollider* a, Vec3 translation, ICollider* b, GjkCache* cache)
+{
+    using namespace GjkSweep;
+
+    GjkSweepResult result;
+
+    // Points of b - a that the closest point to the ray is found from. Like GJK's simplex, but around the ray's current
+    // point instead of the origin.
+    Vec3 points[4];
+    uint32 pointCount = 0;
+
+    float32 t = 0;
+    Vec3 rayPoint = Vec3(0);
+    Vec3 normal = Vec3(0);
+
+    // From the closest point of the difference found so far, to the ray's current point. Any point in the difference
+    // will do to start from.
+    Vec3 direction = a->center() - b->center();
+    if (Gjk::isDegenerateDirection(direction)) direction = -translation;
+    if (Gjk::isDegenerateDirection(direction)) direction = Vec3(Axis3D::Y);
+
+    for (uint32 iteration = 0; iteration < GJK_SWEEP_MAX_ITERATIONS; iteration++)
     {
-        Simplex simplex;
-        initSimplexFromGjkSimplex(&simplex, gjkSimplex);
+        float32 distanceSquared = lengthSquared(direction);
+        if (distanceSquared <= GJK_SWEEP_TOLERANCE * GJK_SWEEP_TOLERANCE) break;
 
-        Vec3 result;
-    
-        while(true)
+        Vec3 onA = a->support(-direction, cache ? &cache->warmStartA : nullptr);
+        Vec3 onB = b->support(direction, cache ? &cache->warmStartB : nullptr);
+        Vec3 point = onB - onA;
+        Vec3 toRayPoint = rayPoint - point;
+        bool advanced = false;
+
+        if (dot(direction, toRayPoint) > 0)
         {
-            Triangle face;
-            uint32 faceIndex;
-            float32 dist = closestFaceToOrigin(&simplex, &face, &faceIndex);
-        
-            Vec3 faceNormal = triangleNormal(face);
-            Vec3 furthestInNormal = Gjk::minkowskiSupport(a, b, faceNormal);
-            float32 furthestInNormalDistance = dot(furthestInNormal, faceNormal);
+            //
+            // The plane through point, facing along direction, separates the difference from the ray's current point.
+            // Nothing in front of it can be hit, so skip the ray ahead to where it crosses it.
+            //
+            float32 along = dot(direction, translation);
+            if (along >= 0) return result; // Moving away from it, or parallel to it
+
+            t -= dot(direction, toRayPoint) / along;
+            if (t > 1) return result;
+
+            rayPoint = translation * t;
+            normal = direction;
+            advanced = true;
+        }
 
-            // SOME tolerance for things like spheres/cylinders which can almost always get a LIIIIITLE closer
-            if(furthestInNormalDistance > dist + 0.01)
+        bool alreadyInSimplex = false;
+        for (uint32 i = 0; i < pointCount; i++)
+        {
+            Vec3 existing = points[i];
+            if (existing.x == point.x && existing.y == point.y && existing.z == point.z)
             {
-                extendSimplex(&simplex, furthestInNormal);
+                alreadyInSimplex = true;
+                break;
             }
-            else
-            {
-                // Simplex can't be expanded, so we have the closest face!
-                // Calculate distance to plane
-                Plane p(face.a, faceNormal);
+        }
+
+        if (!alreadyInSimplex)
+        {
+            assert(pointCount < 4);
+            points[pointCount] = point;
+            pointCount++;
+        }
+        else if (!advanced)
+        {
+            // Nothing new to get any closer with, so the ray's point is on the surface
+            break;
+        }
 
-                float32 d = distance(Vec3(0), p);
-                result = faceNormal * d;
+        direction = -closestPointOnSimplex(points, &pointCount, rayPoint);
 
-                break;
-            }
+        //
+        // Not getting any closer than the last closest point means it's as close as floats can tell. That can be short of
+        // the tolerance when the difference is big or the hit is at a grazing angle. (The first direction is just a
+        // guess, not a closest point.)
+        //
+        if (iteration > 0 && !advanced && lengthSquared(direction) >= distanceSquared) break;
+    }
+
+    //
+    // t only ever moves up to planes the difference is behind, so stopping early (out of iterations, or with the
+    // distance under the tolerance) still leaves it short of the real hit.
+    //
+    result.hit = true;
+    result.t = t;
+    result.normal = normalizeOrZero(normal);
+
+    return result;
+}
+
+GjkCache* gjkCacheForPair(GjkPairCache* pairCache, ICollider* a, ICollider* b)
+{
+    GjkPairKey key;
+    key.a = a->colliderKey();
+    key.b = b->colliderKey();
+
+    GjkCache* result = &pairCache->caches[key];
+    result->lastUsedFrame = pairCache->frame;
+
+    return result;
+}
+
+void ageGjkPairCache(GjkPairCache* pairCache)
+{
+    for (auto it = pairCache->caches.begin(); it != pairCache->caches.end();)
+    {
+        if (pairCache->frame - it->second.lastUsedFrame >= GJK_CACHE_MAX_AGE)
+        {
+            it = pairCache->caches.erase(it);
+        }
+        else
+        {
+            it++;
         }
-    
-        return result;
     }
+
+    pairCache->frame++;
 }
 
-GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector)
+GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector, GjkCache* cache)
 {
     using namespace Gjk;
 
@@ -428,18 +911,34 @@ GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector)
 
     Simplex simplex;
     
-    // Seed the simplex with any point in the Minkowski difference
+    // Seed the simplex with any point in the Minkowski difference. Where the last test ended is the best guess.
     Vec3 direction(1, 0, 0);
-    Vec3 initialPoint = minkowskiSupport(a, b, direction);
+    if (cache && !isDegenerateDirection(cache->direction))
+    {
+        direction = cache->direction;
+    }
+
+    Vec3 initialSupportA;
+    Vec3 initialSupportB;
+    Vec3 initialPoint = minkowskiSupport(a, b, cache, direction, &initialSupportA, &initialSupportB);
+
+    if (dot(initialPoint, direction) < 0.0f)
+    {
+        // Nothing in the difference reaches the origin along direction, so it's a separating axis. This is where a warm
+        // started test of a pair that's still apart finishes.
+        if (cache) cache->direction = direction;
+        return result;
+    }
 
-    if (isZeroVector(initialPoint))
+    if (isDegenerateDirection(initialPoint))
     {
-        // TODO: handle this edge case for robustness
-        assert(false);
+        // The origin is on the surface of the difference: the colliders are exactly touching. There's no penetration
+        // to resolve, so that doesn't count as colliding.
+        if (cache) cache->direction = Vec3(0);
         return result;
     }
     
-    addPointToSimplex(&simplex, initialPoint);
+    addPointToSimplex(&simplex, initialPoint, initialSupportA, initialSupportB);
 
     // Origin is, by definition, in the opposite direction of the initial point
     direction = -initialPoint;
@@ -448,14 +947,22 @@ GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector)
     int32 iteration = 0;
     for ( ; iteration < MAX_ITERATIONS; iteration++)
     {
-        Vec3 pointTowardsOrigin = minkowskiSupport(a, b, direction);
+        if (isDegenerateDirection(direction))
+        {
+            // The origin is on the simplex. Search off to the side of it so it can still grow around the origin.
+            direction = directionOffSimplex(&simplex);
+        }
+
+        Vec3 supportA;
+        Vec3 supportB;
+        Vec3 pointTowardsOrigin = minkowskiSupport(a, b, cache, direction, &supportA, &supportB);
 
         if (dot(pointTowardsOrigin, direction) < 0.0f)
         {
             break; // No collision
         }
 
-        addPointToSimplex(&simplex, pointTowardsOrigin);
+        addPointToSimplex(&simplex, pointTowardsOrigin, supportA, supportB);
 
         if (doSimplex(&simplex, &direction))
         {
@@ -463,16 +970,19 @@ GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector)
 
             if (calculatePenetrationVector)
             {
-                result.penetrationVector = Epa::epaPenetrationVector(&simplex, a, b);
+                Epa::epaPenetration(&simplex, a, b, cache, &result);
             }
             break;
         }
     }
 
-    if (iteration >= MAX_ITERATIONS)
-    {
-        assert(false); // TODO: investigate what a good number of max iterations should be.
-    }
+    //
+    // Running out of iterations means the simplex kept swapping points right at the surface of the difference without
+    // getting any closer to the origin, which only happens when the colliders are barely touching. Like the exact touch
+    // above, that isn't a collision worth resolving.
+    //
+
+    if (cache) cache->direction = direction;
 
     return result;
 }
@@ -2,13 +2,106 @@
 
 #include "als/als_math.h"
 #include "ICollider.h"
+#include "ConvexHull.h"
+
+#include <unordered_map>
 
 struct GjkResult
 {
     bool collides;
+
+    //
+    // Only filled in if the penetration vector was asked for. Moving a by -penetrationVector (or b by
+    // +penetrationVector) separates them. Zero if they're only just touching.
+    //
     Vec3 penetrationVector;
+    Vec3 contactNormal;         // Unit length penetrationVector
+    float32 penetrationDepth;   // Length of penetrationVector
+
+    // World space. contactPointA is the point of a deepest inside b, and vice versa, so A - B = penetrationVector.
+    Vec3 contactPointA;
+    Vec3 contactPointB;
+
+    GjkResult() : collides(false), penetrationVector(0, 0, 0), penetrationDepth(0) {}
+};
+
+//
+// What gjk(..) ended on the last time it tested a pair. If the pair wasn't colliding that's a separating axis, and since
+// things don't move much between frames it usually still is, so the next test is over after one support query. If it
+// was colliding it's still a better place to start than an arbitrary axis.
+//
+// @Note: Only the direction is kept, not the simplex. The simplex's points are in the Minkowski difference of where the
+//        colliders used to be, so they're wrong as soon as either one moves. Any direction is a valid place to start, so
+//        a stale cache (e.g. one left under a slot that now holds a sibling collider) only costs iterations.
+//
+struct GjkCache
+{
+    Vec3 direction;             // Zero if there's nothing to start from
+    uint32 lastUsedFrame = 0;
+
+    // Where the last support walks on a and b ended, if they're hulls. Kept with the pair rather than the hull, so that
+    // pairs sharing a hull can be tested at the same time.
+    HullSupportWarmStart warmStartA;
+    HullSupportWarmStart warmStartB;
+};
+
+struct GjkPairKey
+{
+    ColliderKey a;
+    ColliderKey b;
+
+    bool operator==(const GjkPairKey& other) const { return a == other.a && b == other.b; }
+};
+
+struct GjkPairKeyHash
+{
+    size_t operator()(const GjkPairKey& key) const
+    {
+        size_t hashA = std::hash<uint64>()(((uint64)key.a.entityId << 32) | key.a.slot);
+        size_t hashB = std::hash<uint64>()(((uint64)key.b.entityId << 32) | key.b.slot);
+        return hashA ^ (hashB + 0x9e3779b9 + (hashA << 6) + (hashA >> 2));
+    }
+};
+
+// Persistent GjkCaches, keyed by the (ordered) pair of colliders' ColliderKeys, since their addresses don't last
+
+struct GjkPairCache
+{
+    std::unordered_map<GjkPairKey, GjkCache, GjkPairKeyHash> caches;
+    uint32 frame = 0;
+};
+
+// Pairs that haven't been looked up for this many frames are dropped by ageGjkPairCache(..)
+#define GJK_CACHE_MAX_AGE 8
+
+// Finds or adds the cache for gjk(a, b). Not thread safe: look up every pair's cache before testing them in parallel.
+GjkCache* gjkCacheForPair(GjkPairCache* pairCache, ICollider* a, ICollider* b);
+
+// Call once a frame. Drops the caches of pairs that stopped being tested.
+void ageGjkPairCache(GjkPairCache* pairCache);
+
+// cache is optional. If given, the test starts from it and leaves its final search direction and support walks in it.
+GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector=true, GjkCache* cache=nullptr);
+
+struct GjkSweepResult
+{
+    bool hit;
+
+    float32 t;      // How much of the translation a gets through before it touches b, from 0 to 1. 1 if it doesn't hit.
+
+    // Unit, out of b towards a where they touch. Zero if they were already touching or overlapping before a moved.
+    Vec3 normal;
 
-    GjkResult() : collides(false), penetrationVector(0, 0, 0) {}
+    GjkSweepResult() : hit(false), t(1), normal(0, 0, 0) {}
 };
 
-GjkResult gjk(ICollider* a, ICollider* b, bool calculatePenetrationVector=true);
+//
+// Time of impact of a moving by translation (without rotating) towards b, which stays put. Casts a ray from the origin
+// along translation against the Minkowski difference b - a, using the same support(..) calls as gjk(..), so it works
+// for any pair of colliders.
+//
+// t is conservative: a can always move by translation * t without ending up inside b. It stops within GJK_SWEEP_TOLERANCE
+// of b, or as close as float precision gets, which along a ray that only grazes b can be a little further back.
+//
+// cache is optional. Only its support walks are used.
+GjkSweepResult gjkSweep(ICollider* a, Vec3 translation, ICollider* b, GjkCache* cache=nullptr);
@@ -2,9 +2,105 @@
 
 #include "als/als_math.h"
 
+enum class PrimitiveShapeType : uint32
+{
+    NONE,       // Only has support(..), so narrowphase(..) has to use GJK
+    SPHERE,
+    CAPSULE,
+    BOX,
+    HULL,
+
+    ENUM_VALUE_COUNT
+};
+
+//
+// A collider's shape in world space, for narrowphase(..)'s closed form tests. Only the fields for its type are filled
+// in. Hull planes point into the collider's own cache, so they're only good until it next updates.
+//
+struct PrimitiveShape
+{
+    PrimitiveShapeType type = PrimitiveShapeType::NONE;
+
+    Vec3 center;
+
+    float32 radius;         // Sphere and capsule
+
+    Vec3 segmentA;          // Capsule: the ends of the segment that the radius is swept along
+    Vec3 segmentB;
+
+    Vec3 axes[3];           // Box: unit x, y and z axes
+    Vec3 halfExtents;       // Box: half its size along each axis
+
+    // Hull: outward unit face normals and their offsets, so a point p is outside face i if dot(normal i, p) > offset i
+    const float32* planeXs;
+    const float32* planeYs;
+    const float32* planeZs;
+    const float32* planeOffsets;
+    uint32 planeCount;
+};
+
+struct HullSupportWarmStart;
+
+//
+// Names a collider across frames, for caches keyed by pair (GjkPairCache, ContactManifoldCache). Its address doesn't:
+// adding or removing any component can move the components of every entity in the ECS (see Archetype.h).
+//
+// slot is which of the entity's colliders it is: its kind, and its index among the entity's colliders of that kind.
+// Removing one of an entity's colliders shifts the index of the ones after it, so their cached pairs can end up under
+// a sibling. Like any other stale cache entry, that only costs GJK iterations or one frame of poor warm starting.
+//
+enum ColliderSlotKind : uint32
+{
+    ColliderSlot_Primitive  = 0 << 16,  // ColliderComponent
+    ColliderSlot_Hull       = 1 << 16,  // ConvexHullColliderComponent
+};
+
+struct ColliderKey
+{
+    uint32 entityId = 0;
+    uint32 slot = 0;        // ColliderSlotKind | index
+
+    bool operator==(const ColliderKey& other) const { return entityId == other.entityId && slot == other.slot; }
+};
+
 struct ICollider
 {
     bool isTrigger = false; // Triggers don't take part in collision detection
+    int32 broadphaseProxy = -1; // Proxy in the ECS's broadphase. -1 until updateBroadphase(..) adds it.
+    bool isBaked = false;       // Copied into the ECS's StaticCollisionWorld, so the broadphase leaves it out
+
+    // The transform's worldVersion() when the proxy was last refit. updateBroadphase(..) skips the collider until it
+    // changes, or until something else changes its bounds and sets proxyBoundsDirty.
+    uint32 proxyWorldVersion = 0;
+    bool proxyBoundsDirty = false;
+
     virtual Vec3 center() = 0;
-    virtual Vec3 support(Vec3 direction) = 0;
+
+    // Which collider this is, for caches that outlive a frame. Doesn't change when the ECS moves the collider.
+    virtual ColliderKey colliderKey() = 0;
+
+    //
+    // warmStart is optional. Hulls start walking to the support vertex from it, and leave where they ended up in it. It
+    // belongs to whoever is querying (e.g., the pair's GjkCache), so a support query never writes to the collider, and
+    // any number of threads can query the same one.
+    //
+    virtual Vec3 support(Vec3 direction, HullSupportWarmStart* warmStart) = 0;
+
+    //
+    // Every point on the surface that's within tolerance of being as far along direction as support(..): a face's
+    // corners, an edge's ends, or just the support point. Writes at most maxCount of them to out and returns how many.
+    // Curved shapes only ever have the one point.
+    //
+    virtual uint32 supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart)
+    {
+        assert(maxCount > 0);
+        out[0] = support(direction, warmStart);
+        return 1;
+    }
+
+    // Shapes narrowphase(..) has a closed form test for override this. The default (type NONE) always goes to GJK.
+    virtual PrimitiveShape primitiveShape()
+    {
+        return PrimitiveShape();
+    }
 };
@@ -0,0 +1,448 @@
+#include "Narrowphase.h"
+#include <assert.h>
+#include "float.h"
+
+// Reference:
+// Real-Time Collision Detection (Ericson), 4.4 and 5.1.9
+
+#define NARROWPHASE_EPSILON 1e-6f
+
+// Box-box only uses an edge-edge axis if it's at least this much shallower than the best face axis. Edge axes that only
+// just win flip back and forth with the face ones from frame to frame.
+#define NARROWPHASE_BOX_EDGE_AXIS_TOLERANCE 0.001f
+
+// Past this many faces, checking every plane costs more than GJK's walk over the hull
+#define NARROWPHASE_HULL_MAX_PLANES 64
+
+namespace Narrowphase
+{
+    //
+    // Fills in out for a and b (of the types it's in the table for), and returns true. Returns false if it can't tell,
+    // and the pair has to go to GJK.
+    //
+    typedef bool (*TestFn)(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out);
+
+    // normal is unit, from a towards b. pointA - pointB should be normal * depth.
+    void setPenetration(GjkResult* out, Vec3 normal, float32 depth, Vec3 pointA, Vec3 pointB)
+    {
+        out->contactNormal = normal;
+        out->penetrationDepth = depth;
+        out->penetrationVector = normal * depth;
+        out->contactPointA = pointA;
+        out->contactPointB = pointB;
+    }
+
+    // Closest points between segments p1-q1 and p2-q2
+    void closestPointsOnSegments(Vec3 p1, Vec3 q1, Vec3 p2, Vec3 q2, Vec3* closest1, Vec3* closest2)
+    {
+        Vec3 d1 = q1 - p1;
+        Vec3 d2 = q2 - p2;
+        Vec3 r = p1 - p2;
+
+        float32 lengthSquared1 = dot(d1, d1);
+        float32 lengthSquared2 = dot(d2, d2);
+        float32 f = dot(d2, r);
+
+        float32 s = 0;
+        float32 t = 0;
+
+        if (lengthSquared1 <= NARROWPHASE_EPSILON && lengthSquared2 <= NARROWPHASE_EPSILON)
+        {
+            // Both are points
+        }
+        else if (lengthSquared1 <= NARROWPHASE_EPSILON)
+        {
+            t = clamp(f / lengthSquared2, 0, 1);
+        }
+        else
+        {
+            float32 c = dot(d1, r);
+
+            if (lengthSquared2 <= NARROWPHASE_EPSILON)
+            {
+                s = clamp(-c / lengthSquared1, 0, 1);
+            }
+            else
+            {
+                float32 b = dot(d1, d2);
+                float32 denominator = lengthSquared1 * lengthSquared2 - b * b;
+
+                // Parallel segments have a whole range of closest points. Any s works, so start from p1.
+                if (denominator > NARROWPHASE_EPSILON)
+                {
+                    s = clamp((b * f - c * lengthSquared2) / denominator, 0, 1);
+                }
+
+                t = (b * s + f) / lengthSquared2;
+
+                if (t < 0)
+                {
+                    t = 0;
+                    s = clamp(-c / lengthSquared1, 0, 1);
+                }
+                else if (t > 1)
+                {
+                    t = 1;
+                    s = clamp((b - c) / lengthSquared1, 0, 1);
+                }
+            }
+        }
+
+        *closest1 = p1 + d1 * s;
+        *closest2 = p2 + d2 * t;
+    }
+
+    //
+    // Spheres, and the core of anything that's a sphere swept along something. fallbackNormal is used if the centers
+    // are on top of each other.
+    //
+    bool sphereSphereCore(
+        Vec3 centerA, float32 radiusA, Vec3 centerB, float32 radiusB, Vec3 fallbackNormal,
+        bool calculatePenetrationVector, GjkResult* out)
+    {
+        Vec3 delta = centerB - centerA;
+        float32 radii = radiusA + radiusB;
+        float32 distanceSquared = lengthSquared(delta);
+
+        // Only touching counts as not colliding, same as GJK
+        if (distanceSquared >= radii * radii) return true;
+
+        out->collides = true;
+        if (!calculatePenetrationVector) return true;
+
+        float32 distance = sqrtf(distanceSquared);
+        Vec3 normal = (distance > NARROWPHASE_EPSILON) ? delta / distance : fallbackNormal;
+
+        setPenetration(out, normal, radii - distance, centerA + normal * radiusA, centerB - normal * radiusB);
+        return true;
+    }
+
+    bool sphereSphere(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        return sphereSphereCore(a->center, a->radius, b->center, b->radius, Vec3(Axis3D::Y), calculatePenetrationVector, out);
+    }
+
+    bool sphereCapsule(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        Vec3 onSphere;
+        Vec3 onCapsule;
+        closestPointsOnSegments(a->center, a->center, b->segmentA, b->segmentB, &onSphere, &onCapsule);
+
+        return sphereSphereCore(a->center, a->radius, onCapsule, b->radius, Vec3(Axis3D::Y), calculatePenetrationVector, out);
+    }
+
+    bool capsuleCapsule(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        Vec3 onA;
+        Vec3 onB;
+        closestPointsOnSegments(a->segmentA, a->segmentB, b->segmentA, b->segmentB, &onA, &onB);
+
+        // Segments that cross are best pushed apart perpendicular to both
+        Vec3 fallbackNormal = cross(a->segmentB - a->segmentA, b->segmentB - b->segmentA);
+        fallbackNormal = (lengthSquared(fallbackNormal) > NARROWPHASE_EPSILON) ? normalize(fallbackNormal) : Vec3(Axis3D::Y);
+
+        return sphereSphereCore(onA, a->radius, onB, b->radius, fallbackNormal, calculatePenetrationVector, out);
+    }
+
+    bool sphereBox(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        // The sphere's center in the box's space
+        Vec3 relativeCenter = a->center - b->center;
+        float32 local[3];
+        float32 clamped[3];
+        bool inside = true;
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            float32 halfExtent = b->halfExtents.element[i];
+
+            local[i] = dot(relativeCenter, b->axes[i]);
+            clamped[i] = clamp(local[i], -halfExtent, halfExtent);
+
+            if (clamped[i] != local[i]) inside = false;
+        }
+
+        if (!inside)
+        {
+            Vec3 closest = b->center + b->axes[0] * clamped[0] + b->axes[1] * clamped[1] + b->axes[2] * clamped[2];
+            Vec3 delta = closest - a->center;
+            float32 distanceSquared = lengthSquared(delta);
+
+            if (distanceSquared >= a->radius * a->radius) return true;
+
+            out->collides = true;
+            if (!calculatePenetrationVector) return true;
+
+            float32 distance = sqrtf(distanceSquared);
+
+            // The center can be on the surface but still count as outside after rounding
+            if (distance > NARROWPHASE_EPSILON)
+            {
+                Vec3 normal = delta / distance;
+                setPenetration(out, normal, a->radius - distance, a->center + normal * a->radius, closest);
+                return true;
+            }
+        }
+
+        out->collides = true;
+        if (!calculatePenetrationVector) return true;
+
+        // The center is inside, so push it out through the nearest face
+        uint32 nearestAxis = 0;
+        float32 nearestDistance = FLT_MAX;
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            float32 distanceToFace = b->halfExtents.element[i] - fabs(local[i]);
+
+            if (distanceToFace < nearestDistance)
+            {
+                nearestDistance = distanceToFace;
+                nearestAxis = i;
+            }
+        }
+
+        Vec3 faceNormal = b->axes[nearestAxis] * (local[nearestAxis] < 0 ? -1.0f : 1.0f);
+        Vec3 onFace = a->center + faceNormal * nearestDistance;
+
+        setPenetration(out, -faceNormal, a->radius + nearestDistance, a->center - faceNormal * a->radius, onFace);
+        return true;
+    }
+
+    //
+    // Only settles the sphere's center being inside the hull, or the sphere being entirely outside a face's plane.
+    // Between the two the closest feature could be an edge or a vertex, which GJK finds without walking every one.
+    //
+    bool sphereHull(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        if (b->planeCount == 0 || b->planeCount > NARROWPHASE_HULL_MAX_PLANES) return false;
+
+        uint32 maxPlane = 0;
+        float32 maxSeparation = -FLT_MAX;
+
+        for (uint32 i = 0; i < b->planeCount; i++)
+        {
+            float32 separation =
+                b->planeXs[i] * a->center.x +
+                b->planeYs[i] * a->center.y +
+                b->planeZs[i] * a->center.z -
+                b->planeOffsets[i];
+
+            if (separation >= a->radius) return true;
+
+            if (separation > maxSeparation)
+            {
+                maxSeparation = separation;
+                maxPlane = i;
+            }
+        }
+
+        if (maxSeparation > 0) return false;
+
+        out->collides = true;
+        if (!calculatePenetrationVector) return true;
+
+        // The nearest point on the surface of a hull to a point inside it is on the nearest face
+        Vec3 faceNormal = Vec3(b->planeXs[maxPlane], b->planeYs[maxPlane], b->planeZs[maxPlane]);
+        Vec3 onFace = a->center - faceNormal * maxSeparation;
+
+        setPenetration(out, -faceNormal, a->radius - maxSeparation, a->center - faceNormal * a->radius, onFace);
+        return true;
+    }
+
+    float32 boxProjectedRadius(PrimitiveShape* box, Vec3 axis)
+    {
+        return box->halfExtents.x * fabs(dot(box->axes[0], axis)) +
+               box->halfExtents.y * fabs(dot(box->axes[1], axis)) +
+               box->halfExtents.z * fabs(dot(box->axes[2], axis));
+    }
+
+    Vec3 boxSupport(PrimitiveShape* box, Vec3 direction)
+    {
+        Vec3 result = box->center;
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            float32 halfExtent = box->halfExtents.element[i];
+            result += box->axes[i] * (dot(box->axes[i], direction) >= 0 ? halfExtent : -halfExtent);
+        }
+
+        return result;
+    }
+
+    // The edge of box parallel to axes[axis] that's furthest along direction
+    void boxSupportEdge(PrimitiveShape* box, uint32 axis, Vec3 direction, Vec3* start, Vec3* end)
+    {
+        Vec3 middle = box->center;
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            if (i == axis) continue;
+
+            float32 halfExtent = box->halfExtents.element[i];
+            middle += box->axes[i] * (dot(box->axes[i], direction) >= 0 ? halfExtent : -halfExtent);
+        }
+
+        Vec3 halfEdge = box->axes[axis] * box->halfExtents.element[axis];
+        *start = middle - halfEdge;
+        *end = middle + halfEdge;
+    }
+
+    //
+    // Separating axis test over the 15 axes that can separate two boxes: the 3 face normals of each, and the cross
+    // products of each pair of edge directions. The axis they overlap least on is the penetration direction.
+    //
+    bool boxBox(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        Vec3 delta = b->center - a->center;
+
+        float32 bestFaceOverlap = FLT_MAX;
+        Vec3 bestFaceNormal;
+        uint32 bestFace = 0;        // 0-2 are a's axes, 3-5 are b's
+
+        for (uint32 i = 0; i < 6; i++)
+        {
+            Vec3 axis = (i < 3) ? a->axes[i] : b->axes[i - 3];
+            float32 distance = dot(delta, axis);
+            float32 overlap = boxProjectedRadius(a, axis) + boxProjectedRadius(b, axis) - fabs(distance);
+
+            if (overlap <= 0) return true;
+
+            if (overlap < bestFaceOverlap)
+            {
+                bestFaceOverlap = overlap;
+                bestFaceNormal = (distance < 0) ? -axis : axis;
+                bestFace = i;
+            }
+        }
+
+        float32 bestEdgeOverlap = FLT_MAX;
+        Vec3 bestEdgeNormal;
+        uint32 bestEdgeA = 0;
+        uint32 bestEdgeB = 0;
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            for (uint32 j = 0; j < 3; j++)
+            {
+                Vec3 axis = cross(a->axes[i], b->axes[j]);
+                float32 axisLengthSquared = lengthSquared(axis);
+
+                // Parallel edges. The face axes already cover whatever this would have.
+                if (axisLengthSquared <= NARROWPHASE_EPSILON) continue;
+
+                axis /= sqrtf(axisLengthSquared);
+
+                float32 distance = dot(delta, axis);
+                float32 overlap = boxProjectedRadius(a, axis) + boxProjectedRadius(b, axis) - fabs(distance);
+
+                if (overlap <= 0) return true;
+
+                if (overlap < bestEdgeOverlap)
+                {
+                    bestEdgeOverlap = overlap;
+                    bestEdgeNormal = (distance < 0) ? -axis : axis;
+                    bestEdgeA = i;
+                    bestEdgeB = j;
+                }
+            }
+        }
+
+        out->collides = true;
+        if (!calculatePenetrationVector) return true;
+
+        if (bestEdgeOverlap + NARROWPHASE_BOX_EDGE_AXIS_TOLERANCE < bestFaceOverlap)
+        {
+            // Edge against edge: the contact is where the two edges come closest
+            Vec3 normal = bestEdgeNormal;
+
+            Vec3 edgeAStart, edgeAEnd, edgeBStart, edgeBEnd;
+            boxSupportEdge(a, bestEdgeA, normal, &edgeAStart, &edgeAEnd);
+            boxSupportEdge(b, bestEdgeB, -normal, &edgeBStart, &edgeBEnd);
+
+            Vec3 onA, onB;
+            closestPointsOnSegments(edgeAStart, edgeAEnd, edgeBStart, edgeBEnd, &onA, &onB);
+
+            Vec3 middle = (onA + onB) / 2;
+            Vec3 halfPenetration = normal * (bestEdgeOverlap / 2);
+
+            setPenetration(out, normal, bestEdgeOverlap, middle + halfPenetration, middle - halfPenetration);
+            return true;
+        }
+
+        //
+        // Face against something: the contact is the other box's deepest corner, pulled in to lie over the face. If it's
+        // a whole face against a face, buildContactManifold(..) clips them for the rest of the points.
+        //
+        Vec3 normal = bestFaceNormal;
+        bool referenceIsA = bestFace < 3;
+
+        PrimitiveShape* reference = referenceIsA ? a : b;
+        PrimitiveShape* incident = referenceIsA ? b : a;
+        uint32 referenceAxis = referenceIsA ? bestFace : bestFace - 3;
+
+        Vec3 deepest = boxSupport(incident, referenceIsA ? -normal : normal);
+
+        for (uint32 i = 0; i < 3; i++)
+        {
+            if (i == referenceAxis) continue;
+
+            float32 halfExtent = reference->halfExtents.element[i];
+            float32 offset = dot(deepest - reference->center, reference->axes[i]);
+            deepest += reference->axes[i] * (clamp(offset, -halfExtent, halfExtent) - offset);
+        }
+
+        if (referenceIsA) setPenetration(out, normal, bestFaceOverlap, deepest + normal * bestFaceOverlap, deepest);
+        else              setPenetration(out, normal, bestFaceOverlap, deepest, deepest - normal * bestFaceOverlap);
+
+        return true;
+    }
+
+    // Runs test with a and b swapped, then swaps the result back
+    template<TestFn test>
+    bool flipped(PrimitiveShape* a, PrimitiveShape* b, bool calculatePenetrationVector, GjkResult* out)
+    {
+        if (!test(b, a, calculatePenetrationVector, out)) return false;
+
+        if (out->collides && calculatePenetrationVector)
+        {
+            Vec3 contactPointA = out->contactPointB;
+            Vec3 contactPointB = out->contactPointA;
+
+            setPenetration(out, -out->contactNormal, out->penetrationDepth, contactPointA, contactPointB);
+        }
+
+        return true;
+    }
+
+    static_assert((uint32)PrimitiveShapeType::ENUM_VALUE_COUNT == 5, "Update the narrowphase table");
+
+    // Indexed [a's type][b's type]. nullptr goes to GJK.
+    const TestFn tests[5][5] =
+    {
+        //             NONE     SPHERE                   CAPSULE          BOX        HULL
+        /* NONE    */ { nullptr, nullptr,                 nullptr,         nullptr,   nullptr    },
+        /* SPHERE  */ { nullptr, sphereSphere,            sphereCapsule,   sphereBox, sphereHull },
+        /* CAPSULE */ { nullptr, flipped<sphereCapsule>,  capsuleCapsule,  nullptr,   nullptr    },
+        /* BOX     */ { nullptr, flipped<sphereBox>,      nullptr,         boxBox,    nullptr    },
+        /* HULL    */ { nullptr, flipped<sphereHull>,     nullptr,         nullptr,   nullptr    },
+    };
+}
+
+GjkResult narrowphase(ICollider* a, ICollider* b, bool calculatePenetrationVector, GjkCache* cache)
+{
+    using namespace Narrowphase;
+
+    PrimitiveShape shapeA = a->primitiveShape();
+    PrimitiveShape shapeB = b->primitiveShape();
+
+    TestFn test = tests[(uint32)shapeA.type][(uint32)shapeB.type];
+
+    if (test)
+    {
+        GjkResult result;
+        if (test(&shapeA, &shapeB, calculatePenetrationVector, &result)) return result;
+    }
+
+    return gjk(a, b, calculatePenetrationVector, cache);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Gjk.h"
+#include "ICollider.h"
+
+//
+// Narrowphase test between two colliders. Pairs of shapes with a closed form test (spheres, capsules and boxes against
+// each other, and spheres against hulls) skip GJK entirely, which saves a virtual support(..) call, a transform lookup
+// and a quaternion rotation per GJK/EPA iteration. Everything else, or a case a closed form test can't settle, goes to
+// gjk(..).
+//
+// Same arguments and result as gjk(..). cache is only used if it falls back to gjk(..).
+//
+GjkResult narrowphase(ICollider* a, ICollider* b, bool calculatePenetrationVector=true, GjkCache* cache=nullptr);
@@ -0,0 +1,224 @@
+#include "PickingTree.h"
+
+#include "ecs/Ecs.h"
+#include "ecs/components/TransformComponent.h"
+#include "ecs/components/RenderComponent.h"
+#include "ecs/components/ColliderComponent.h"
+#include "ecs/components/ConvexHullColliderComponent.h"
+
+namespace
+{
+    Aabb pickingBounds(Entity e)
+    {
+        Vec3 minPoint = Vec3(FLT_MAX);
+        Vec3 maxPoint = Vec3(-FLT_MAX);
+
+        auto growBounds = [&](Aabb bounds)
+        {
+            minPoint = componentwiseMin(bounds.minPoint(), minPoint);
+            maxPoint = componentwiseMax(bounds.maxPoint(), maxPoint);
+        };
+
+        auto renderComponents = getComponents<RenderComponent>(e);
+        for (uint32 i = 0; i < renderComponents.numComponents; i++)
+        {
+            growBounds(aabbFromRenderComponent(&renderComponents[i]));
+        }
+
+        auto colliders = getComponents<ColliderComponent>(e);
+        for (uint32 i = 0; i < colliders.numComponents; i++)
+        {
+            growBounds(aabbFromCollider(&colliders[i]));
+        }
+
+        auto convexColliders = getComponents<ConvexHullColliderComponent>(e);
+        for (uint32 i = 0; i < convexColliders.numComponents; i++)
+        {
+            growBounds(aabbFromConvexCollider(&convexColliders[i]));
+        }
+
+        return aabbFromMinMax(minPoint, maxPoint);
+    }
+
+    //
+    // Where the ray first hits any part of the entity before maxT, or -1 if it doesn't:
+    //  - The triangles of each render component whose submesh has a triangle BVH, and the bounds of the ones without
+    //  - Each collider's shape, or its bounds if it doesn't have a closed form test (cylinders)
+    //
+    // Triangles are two sided, so they're hit wherever the ray starts. Bounds and collider shapes are only hit where the
+    // ray enters them, like everything else in Ray.h.
+    //
+    float32 rayVsPickingEntry(PickingEntry* entry, Ray ray, float32 maxT)
+    {
+        float32 result = -1;
+        auto closer = [&result, &maxT](float32 t)
+        {
+            if (t >= 0 && t < maxT)
+            {
+                maxT = t;
+                result = t;
+            }
+        };
+
+        auto renderComponents = getComponents<RenderComponent>(entry->entity);
+        if (renderComponents.numComponents > 0)
+        {
+            TransformComponent* xfm = getComponent<TransformComponent>(entry->entity);
+
+            // The affine map into the mesh's space keeps t the same, as long as the direction isn't renormalized after
+            Quaternion toLocal = inverse(xfm->orientation());
+            Vec3 scale = xfm->scale();
+
+            Ray localRay;
+            localRay.position = hadamardDivide(toLocal * (ray.position - xfm->position()), scale);
+            localRay.direction = hadamardDivide(toLocal * ray.direction, scale);
+
+            for (uint32 i = 0; i < renderComponents.numComponents; i++)
+            {
+                Submesh* submesh = renderComponents[i].submesh;
+
+                if (isBuilt(&submesh->triangleBvh))
+                {
+                    TriangleHit hit;
+                    if (rayVsSubmesh(localRay, submesh, maxT, &hit)) closer(hit.t);
+                }
+                else
+                {
+                    closer(rayVsAabb(ray, aabbFromRenderComponent(&renderComponents[i])));
+                }
+            }
+        }
+
+        auto colliders = getComponents<ColliderComponent>(entry->entity);
+        for (uint32 i = 0; i < colliders.numComponents; i++)
+        {
+            PrimitiveShape shape = colliders[i].primitiveShape();
+            closer((shape.type == PrimitiveShapeType::NONE) ? rayVsAabb(ray, aabbFromCollider(&colliders[i])) : rayVsPrimitiveShape(ray, &shape));
+        }
+
+        auto convexColliders = getComponents<ConvexHullColliderComponent>(entry->entity);
+        for (uint32 i = 0; i < convexColliders.numComponents; i++)
+        {
+            PrimitiveShape shape = convexColliders[i].primitiveShape();
+            closer(rayVsPrimitiveShape(ray, &shape));
+        }
+
+        return result;
+    }
+
+    void markPickingIndexDirty(PickingTree* pickingTree, uint32 index)
+    {
+        if (index >= pickingTree->isDirty.size()) pickingTree->isDirty.resize(index + 1, 0);
+
+        if (pickingTree->isDirty[index]) return;
+
+        pickingTree->isDirty[index] = 1;
+        pickingTree->dirtyEntities.push_back(index);
+    }
+
+    void removePickingEntry(PickingTree* pickingTree, uint32 index)
+    {
+        int32 entryIndex = pickingTree->entryIndices[index];
+        removeProxy(&pickingTree->tree, pickingTree->entries[entryIndex].proxy);
+
+        // Swap remove. The proxies hold entity indices, so only the moved entry's index needs fixing.
+        PickingEntry* last = &pickingTree->entries.back();
+        pickingTree->entryIndices[entityIndex(last->entity.id)] = entryIndex;
+        pickingTree->entries[entryIndex] = *last;
+        pickingTree->entries.pop_back();
+
+        pickingTree->entryIndices[index] = -1;
+    }
+
+    // Brings the entry of whatever entity is at index now up to date, adding or removing it as needed
+    void updatePickingEntry(PickingTree* pickingTree, Ecs* ecs, uint32 index)
+    {
+        ArchetypeQuery query;
+        query.all = componentBit(ComponentType::Transform);
+        query.any = componentBit(ComponentType::Render) | componentBit(ComponentType::Collider) | componentBit(ComponentType::ConvexHullCollider);
+
+        EntityLocation* location = (index < ecs->archetypes.locations.size()) ? &ecs->archetypes.locations[index] : nullptr;
+        bool isPickable = location && location->chunk && archetypeMatches(location->chunk->mask, query);
+
+        if (index >= pickingTree->entryIndices.size()) pickingTree->entryIndices.resize(index + 1, -1);
+        int32 entryIndex = pickingTree->entryIndices[index];
+
+        if (!isPickable)
+        {
+            if (entryIndex >= 0) removePickingEntry(pickingTree, index);
+            return;
+        }
+
+        // Might not be the entity the entry was made for, if it was removed and its index recycled
+        Entity e = location->chunk->entities[location->row];
+        Aabb bounds = pickingBounds(e);
+
+        if (entryIndex >= 0)
+        {
+            PickingEntry* entry = &pickingTree->entries[entryIndex];
+            entry->entity = e;
+            moveProxy(&pickingTree->tree, entry->proxy, bounds);
+        }
+        else
+        {
+            PickingEntry entry;
+            entry.entity = e;
+            entry.proxy = insertProxy(&pickingTree->tree, bounds, (void*)(uintptr_t)index);
+
+            pickingTree->entryIndices[index] = pickingTree->entries.size();
+            pickingTree->entries.push_back(entry);
+        }
+    }
+}
+
+void markPickingEntityDirty(PickingTree* pickingTree, Entity e)
+{
+    markPickingIndexDirty(pickingTree, entityIndex(e.id));
+}
+
+void updatePickingTree(PickingTree* pickingTree, Ecs* ecs)
+{
+    takeChangedEntities(&ecs->archetypes, [pickingTree](uint32 index)
+    {
+        markPickingIndexDirty(pickingTree, index);
+    });
+
+    for (uint32 index : pickingTree->dirtyEntities)
+    {
+        pickingTree->isDirty[index] = 0;
+        updatePickingEntry(pickingTree, ecs, index);
+    }
+
+    pickingTree->dirtyEntities.clear();
+}
+
+RaycastResult raycastPickingTree(PickingTree* pickingTree, Ecs* ecs, Ray ray)
+{
+    updatePickingTree(pickingTree, ecs);
+
+    RaycastResult result;
+    result.hit = false;
+    result.t = -1;
+
+    //
+    // The tree holds fat bounds, so each candidate is tested against its actual parts
+    //
+    queryRay(&pickingTree->tree, ray, FLT_MAX, [&](int32 proxy, void* userData)
+    {
+        PickingEntry* entry = &pickingTree->entries[pickingTree->entryIndices[(uintptr_t)userData]];
+
+        float32 entryT = rayVsPickingEntry(entry, ray, result.hit ? result.t : FLT_MAX);
+
+        // queryRay(..) only reports the closest hit's t, so the entity is remembered here
+        if (entryT >= 0)
+        {
+            result.hit = true;
+            result.t = entryT;
+            result.hitEntity = entry->entity;
+        }
+
+        return entryT;
+    });
+
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "Aabb.h"
+#include "AabbTree.h"
+#include "Ray.h"
+#include "ecs/Entity.h"
+
+#include <vector>
+
+struct Ecs;
+
+//
+// Every pickable entity (a transform, plus render components or colliders) by its world bounds, for castRay(..).
+//
+// An entity's bounds are cached, and only recomputed once it's marked dirty. Its transform marks it whenever it's marked
+// dirty itself, and entities that are added or removed or gain or lose components come from the archetype storage's
+// changed entities. Each one is refit, inserted or removed on its own, so the cost of an update is in how many changed.
+//
+// Changing a collider's size or a render component's mesh doesn't mark the transform, so whatever does that (the
+// editor) calls markPickingEntityDirty(..).
+//
+
+struct PickingEntry
+{
+    Entity entity;
+    int32 proxy;    // Bounds are the union of the entity's render component and collider bounds
+};
+
+struct PickingTree
+{
+    DynamicAabbTree tree;
+
+    // Each proxy's user data is its entity's index
+    std::vector<PickingEntry> entries;
+
+    // Indexed by entity index. -1 for entities that aren't in the tree.
+    std::vector<int32> entryIndices;
+
+    // Indices of the entities to bring up to date on the next update, each in here at most once
+    std::vector<uint32> dirtyEntities;
+    std::vector<uint8> isDirty; // Indexed by entity index
+};
+
+void markPickingEntityDirty(PickingTree* pickingTree, Entity e);
+
+// Refits, inserts or removes the entries of the entities that were marked dirty or changed components since last time
+void updatePickingTree(PickingTree* pickingTree, Ecs* ecs);
+
+// Closest entity the ray hits, and where. See castRay(..) for what counts as a hit.
+RaycastResult raycastPickingTree(PickingTree* pickingTree, Ecs* ecs, Ray ray);
@@ -1,10 +1,14 @@
 #include "Ray.h"
 #include "Aabb.h"
+#include "ICollider.h"
+#include "TriangleBvh.h"
 
 #include "ecs/Ecs.h"
 #include "ecs/components/TransformComponent.h"
 #include "ecs/components/ColliderComponent.h"
 
+#include "resource/resources/Mesh.h"
+
 Ray::Ray(Vec3 position, Vec3 direction)
     : position(position)
     , direction(normalize(direction))
@@ -62,79 +66,17 @@ float32 rayVsPlaneTwoSided(Ray ray, Plane plane)
 }
 
 float32 rayVsRect3(Ray ray, Vec3 center, Quaternion orientation, Vec3 halfDim)
-{    
-    Vec3 localX = orientation * Vec3(Axis3D::X);
-    Vec3 localY = orientation * Vec3(Axis3D::Y);
-    Vec3 localZ = orientation * Vec3(Axis3D::Z);
-
-    // Note: uses 2-sided plane tests, so the sign of the normal doesn't matter
-    Plane rightPlane(Vec3(center + localX * halfDim.x),  localX);
-    Plane leftPlane (Vec3(center - localX * halfDim.x), -localX);
-    
-    Plane frontPlane(Vec3(center + localZ * halfDim.z),  localZ);
-    Plane backPlane (Vec3(center - localZ * halfDim.z), -localZ);
-
-    Plane topPlane(Vec3(center + localY * halfDim.y),  localY);
-    Plane botPlane(Vec3(center - localY * halfDim.y), -localY);
-
-    float32 largestNearT = -1;
-    float32 smallestFarT = FLT_MAX;
-
-    struct {
-        bool operator() (Ray ray, Plane p1, Plane p2, float32* nearT, float32* farT)
-        {
-            float32 t1 = rayVsPlaneTwoSided(ray, p1);
-            float32 t2 = rayVsPlaneTwoSided(ray, p2);
-
-            if (t1 >= 0 && t2 >= 0)
-            {
-                // Both intersect
-                *nearT = min(t1, t2);
-                *farT = max(t1, t2);
-            }
-            else if (t1 >= 0 || t2 >= 0)
-            {
-                // Only one intersects
-                *nearT = -1;
-                *farT = max(t1, t2);
-            }
-            else
-            {
-                if (dot(ray.direction, p1.normal) > 0 || dot(ray.direction, p2.normal) > 0)
-                {
-                    // Non parallel and non-intersecting.
-                    // Returning false indicates that the entire rayVsRect3 test fails
-                    return false;
-                }
-                
-                *nearT = -1;
-                *farT = -1;
-            }
-
-            return true;
-        }
-    } getNearAndFarT;
+{
+    // In the box's space it's an AABB centered on the origin. Rotating keeps the direction unit length, so t is the same.
+    Quaternion toLocal = inverse(orientation);
+    Vec3 localPosition = toLocal * (ray.position - center);
+    Vec3 localDirection = toLocal * ray.direction;
 
     float32 nearT, farT;
+    raySlabs(localPosition, Vec3(1.0f / localDirection.x, 1.0f / localDirection.y, 1.0f / localDirection.z), -halfDim, halfDim, &nearT, &farT);
 
-    uint32 debug_numHits = 0;
-
-    // @Slow: so many if's... can probably cut down on this
-    if (!getNearAndFarT(ray, rightPlane, leftPlane, &nearT, &farT)) return -1;
-    if (nearT >= 0) largestNearT = max(nearT, largestNearT);
-    if (farT >= 0)  smallestFarT = min(farT, smallestFarT);
-
-    if (!getNearAndFarT(ray, topPlane, botPlane, &nearT, &farT)) return -1;
-    if (nearT >= 0) largestNearT = max(nearT, largestNearT);
-    if (farT >= 0)  smallestFarT = min(farT, smallestFarT);
-
-    if (!getNearAndFarT(ray, frontPlane, backPlane, &nearT, &farT)) return -1;
-    if (nearT >= 0) largestNearT = max(nearT, largestNearT);
-    if (farT >= 0)  smallestFarT = min(farT, smallestFarT);
-
-    if (largestNearT <= smallestFarT) return largestNearT;
-    
-    return -1;
+    if (nearT < 0 || nearT > farT) return -1;
+    return nearT;
 }
 
 float32 rayVsCollider(Ray ray, ColliderComponent* collider)
@@ -189,8 +131,210 @@ float32 rayVsCollider(Ray ray, ColliderComponent* collider)
 
 float32 rayVsAabb(Ray ray, Aabb aabb)
 {
-    // @Slow: this uses the general rayVsRect3 test. It could be substantially sped up
-    //        since we KNOW we have an AABB, and not any arbitrary rect3
-    float32 result = rayVsRect3(ray, aabb.center, Quaternion(), aabb.halfDim);
+    float32 nearT, farT;
+    raySlabs(ray.position, inverseDirection(ray), aabb.minPoint(), aabb.maxPoint(), &nearT, &farT);
+
+    if (nearT < 0 || nearT > farT) return -1;
+    return nearT;
+}
+
+float32 rayVsSphere(Ray ray, Vec3 center, float32 radius)
+{
+    Vec3 m = ray.position - center;
+    float32 c = dot(m, m) - radius * radius;
+    if (c <= 0) return -1; // Starts inside
+
+    float32 a = dot(ray.direction, ray.direction);
+    float32 b = dot(m, ray.direction);
+    float32 discriminant = b * b - a * c;
+    if (b >= 0 || discriminant < 0) return -1;
+
+    return (-b - sqrt(discriminant)) / a;
+}
+
+float32 rayVsCapsule(Ray ray, Vec3 segmentA, Vec3 segmentB, float32 radius)
+{
+    Vec3 axis = segmentB - segmentA;
+    float32 axisLengthSquared = dot(axis, axis);
+
+    Vec3 m = ray.position - segmentA;
+
+    float32 along = (axisLengthSquared > 0) ? fmax(0, fmin(1, dot(m, axis) / axisLengthSquared)) : 0;
+    if (lengthSquared(m - axis * along) <= radius * radius) return -1; // Starts inside
+
+    float32 result = -1;
+    auto closer = [&result](float32 t)
+    {
+        if (t >= 0 && (result < 0 || t < result)) result = t;
+    };
+
+    closer(rayVsSphere(ray, segmentA, radius));
+    closer(rayVsSphere(ray, segmentB, radius));
+
+    //
+    // The side. With the axis projected out it's a circle, and the ray has to hit it between the two ends.
+    //
+    if (axisLengthSquared > 0)
+    {
+        Vec3 perpendicularDirection = ray.direction - axis * (dot(ray.direction, axis) / axisLengthSquared);
+        Vec3 perpendicularM = m - axis * (dot(m, axis) / axisLengthSquared);
+
+        float32 a = dot(perpendicularDirection, perpendicularDirection);
+        float32 b = dot(perpendicularM, perpendicularDirection);
+        float32 c = dot(perpendicularM, perpendicularM) - radius * radius;
+        float32 discriminant = b * b - a * c;
+
+        if (a > 0 && discriminant >= 0)
+        {
+            float32 t = (-b - sqrt(discriminant)) / a;
+            float32 hitAlong = dot(m + ray.direction * t, axis);
+
+            if (hitAlong >= 0 && hitAlong <= axisLengthSquared) closer(t);
+        }
+    }
+
+    return result;
+}
+
+float32 rayVsPrimitiveShape(Ray ray, PrimitiveShape* shape)
+{
+    switch (shape->type)
+    {
+        case PrimitiveShapeType::SPHERE:
+        {
+            return rayVsSphere(ray, shape->center, shape->radius);
+        }
+
+        case PrimitiveShapeType::CAPSULE:
+        {
+            return rayVsCapsule(ray, shape->segmentA, shape->segmentB, shape->radius);
+        }
+
+        case PrimitiveShapeType::BOX:
+        {
+            // In the box's space it's an AABB centered on the origin. The axes are unit length, so t is the same.
+            Vec3 relative = ray.position - shape->center;
+
+            Vec3 localPosition;
+            Vec3 localDirection;
+            for (uint32 i = 0; i < 3; i++)
+            {
+                localPosition.element[i] = dot(relative, shape->axes[i]);
+                localDirection.element[i] = dot(ray.direction, shape->axes[i]);
+            }
+
+            float32 nearT, farT;
+            raySlabs(localPosition, Vec3(1.0f / localDirection.x, 1.0f / localDirection.y, 1.0f / localDirection.z), -shape->halfExtents, shape->halfExtents, &nearT, &farT);
+
+            if (nearT < 0 || nearT > farT) return -1;
+            return nearT;
+        }
+
+        case PrimitiveShapeType::HULL:
+        {
+            //
+            // Clip the ray's line against every face plane. It's inside the hull between the last plane it enters and
+            // the first one it leaves.
+            //
+            if (shape->planeCount == 0) return -1;
+
+            float32 nearT = -FLT_MAX;
+            float32 farT = FLT_MAX;
+
+            for (uint32 i = 0; i < shape->planeCount; i++)
+            {
+                Vec3 normal = Vec3(shape->planeXs[i], shape->planeYs[i], shape->planeZs[i]);
+
+                float32 distance = dot(normal, ray.position) - shape->planeOffsets[i]; // Positive outside
+                float32 approach = dot(normal, ray.direction);
+
+                if (approach == 0)
+                {
+                    // Parallel to the plane, so it's either always outside it or never
+                    if (distance > 0) return -1;
+                    continue;
+                }
+
+                float32 t = -distance / approach;
+                if (approach < 0) nearT = fmax(nearT, t);
+                else              farT = fmin(farT, t);
+
+                if (nearT > farT) return -1;
+            }
+
+            if (nearT < 0) return -1;
+            return nearT;
+        }
+
+        default:
+        {
+            return -1;
+        }
+    }
+}
+
+float32 rayVsTriangle(Ray ray, Vec3 a, Vec3 b, Vec3 c, float32* u, float32* v)
+{
+    // Moller-Trumbore
+    Vec3 edge1 = b - a;
+    Vec3 edge2 = c - a;
+
+    Vec3 p = cross(ray.direction, edge2);
+    float32 det = dot(edge1, p);
+    if (fabs(det) <= RAY_VS_TRIANGLE_EPSILON) return -1;
+
+    float32 inverseDet = 1.0f / det;
+
+    Vec3 s = ray.position - a;
+    *u = dot(s, p) * inverseDet;
+    if (*u < 0 || *u > 1) return -1;
+
+    Vec3 q = cross(s, edge1);
+    *v = dot(ray.direction, q) * inverseDet;
+    if (*v < 0 || *u + *v > 1) return -1;
+
+    float32 t = dot(edge2, q) * inverseDet;
+    if (t < 0) return -1;
+
+    return t;
+}
+
+bool rayVsSubmesh(Ray ray, Submesh* submesh, float32 maxT, TriangleHit* hit)
+{
+    if (isBuilt(&submesh->triangleBvh))
+    {
+        return rayVsTriangleBvh(&submesh->triangleBvh, ray, maxT, hit);
+    }
+
+    // @Slow: Only meshes that are raycast against a lot need a BVH, this covers the rest
+    float32 nearT, farT;
+    raySlabs(ray.position, inverseDirection(ray), submesh->bounds.minPoint(), submesh->bounds.maxPoint(), &nearT, &farT);
+    if (nearT > farT || farT < 0 || nearT >= maxT) return false;
+
+    bool result = false;
+    uint32 triangleCount = (uint32)submesh->indices.size() / 3;
+
+    for (uint32 triangle = 0; triangle < triangleCount; triangle++)
+    {
+        float32 u, v;
+        float32 t = rayVsTriangle(
+            ray,
+            submesh->vertices[submesh->indices[3 * triangle + 0]].position,
+            submesh->vertices[submesh->indices[3 * triangle + 1]].position,
+            submesh->vertices[submesh->indices[3 * triangle + 2]].position,
+            &u, &v);
+
+        if (t >= 0 && t < maxT)
+        {
+            maxT = t;
+
+            hit->t = t;
+            hit->triangle = triangle;
+            hit->u = u;
+            hit->v = v;
+            result = true;
+        }
+    }
+
     return result;
 }
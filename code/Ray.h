@@ -1,10 +1,15 @@
 #pragma once
 
 #include "als/als_math.h"
+#include "als/als_simd.h"
 #include "ecs/Entity.h"
 
+#include <float.h>
+
 struct Aabb;
 struct ColliderComponent;
+struct PrimitiveShape;
+struct Submesh;
 
 struct RaycastResult
 {
@@ -24,11 +29,172 @@ struct Ray
 
 float32 rayVsPlaneOneSided(Ray ray, Plane plane);
 float32 rayVsPlaneTwoSided(Ray ray, Plane plane);
-float32 rayVsRect3(Ray ray, Vec3 center, Quaternion orientation, Vec3 halfDim);
 float32 rayVsCollider(Ray ray, ColliderComponent* collider);
+
+// Oriented box. Returns the t the ray enters it at, or -1 if it misses or starts inside.
+float32 rayVsRect3(Ray ray, Vec3 center, Quaternion orientation, Vec3 halfDim);
+
+// Returns the t the ray enters the box at, or -1 if it misses or starts inside
 float32 rayVsAabb(Ray ray, Aabb aabb);
 
+// Same as rayVsAabb(..), for spheres, capsules and boxes at any orientation, and hulls
+float32 rayVsSphere(Ray ray, Vec3 center, float32 radius);
+float32 rayVsCapsule(Ray ray, Vec3 segmentA, Vec3 segmentB, float32 radius);
+
+// Shapes without a closed form test (type NONE) always miss, so callers test their bounds instead
+float32 rayVsPrimitiveShape(Ray ray, PrimitiveShape* shape);
+
+//
+// Rays closer than this to the triangle's plane count as missing it. It's compared against a determinant that scales with
+// the area of the triangle, so it's only there to keep from dividing by (almost) 0.
+//
+#define RAY_VS_TRIANGLE_EPSILON 1e-12f
+
+// Two sided. Returns the t the ray hits the triangle at, or -1 if it misses. u and v are the barycentric weights of b and c.
+float32 rayVsTriangle(Ray ray, Vec3 a, Vec3 b, Vec3 c, float32* u, float32* v);
+
+//
+// Triangles
+//
+// These work in the mesh's space, so a ray from world space has to be brought into it first. The direction doesn't have
+// to be unit length (a scaled mesh won't keep it that way), t is always in multiples of it.
+//
+
+struct TriangleHit
+{
+    float32 t;
+    uint32 triangle; // Its indices start at submesh->indices[3 * triangle]
+
+    // Barycentric weights of the triangle's second and third vertex
+    float32 u;
+    float32 v;
+};
+
+// Returns true if the ray hits one of the submesh's triangles before maxT, and the closest one in hit. Uses the
+// submesh's triangle BVH if it has one built, otherwise tests every triangle.
+bool rayVsSubmesh(Ray ray, Submesh* submesh, float32 maxT, TriangleHit* hit);
+
 inline Vec3 pointOnRay(Ray ray, float32 t)
 {
     return ray.position + t * ray.direction;
 }
+
+//
+// Slab tests
+//
+// These take 1 / ray.direction per axis instead of the direction, so a ray tested against a lot of boxes only divides
+// once. Division by 0 gives +/- infinity, which they handle.
+//
+
+inline Vec3 inverseDirection(Ray ray)
+{
+    return Vec3(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+}
+
+//
+// Writes the t the ray's line enters and leaves the box at. The line hits the box if nearT <= farT. nearT is negative
+// if the ray starts inside, and both are if the box is behind it.
+//
+inline void raySlabs(Vec3 rayPosition, Vec3 inverseDirection, Vec3 minPoint, Vec3 maxPoint, float32* nearT, float32* farT)
+{
+    float32 tx1 = (minPoint.x - rayPosition.x) * inverseDirection.x;
+    float32 tx2 = (maxPoint.x - rayPosition.x) * inverseDirection.x;
+    float32 ty1 = (minPoint.y - rayPosition.y) * inverseDirection.y;
+    float32 ty2 = (maxPoint.y - rayPosition.y) * inverseDirection.y;
+    float32 tz1 = (minPoint.z - rayPosition.z) * inverseDirection.z;
+    float32 tz2 = (maxPoint.z - rayPosition.z) * inverseDirection.z;
+
+    // fmin/fmax drop the NaNs that come from 0 * infinity when the ray lies in one of the slab planes
+    *nearT = fmax(fmax(fmin(tx1, tx2), fmin(ty1, ty2)), fmin(tz1, tz2));
+    *farT = fmin(fmin(fmax(tx1, tx2), fmax(ty1, ty2)), fmax(tz1, tz2));
+}
+
+//
+// Up to 4 boxes, one array per coordinate, for slab testing them all at once with rayVsAabb4(..). The tree walks fill
+// one lane per child, so a node's children are tested together.
+//
+struct Aabb4
+{
+    float32 minXs[4];
+    float32 minYs[4];
+    float32 minZs[4];
+    float32 maxXs[4];
+    float32 maxYs[4];
+    float32 maxZs[4];
+};
+
+inline void setAabb4Lane(Aabb4* boxes, uint32 lane, Vec3 minPoint, Vec3 maxPoint)
+{
+    assert(lane < 4);
+
+    boxes->minXs[lane] = minPoint.x;
+    boxes->minYs[lane] = minPoint.y;
+    boxes->minZs[lane] = minPoint.z;
+    boxes->maxXs[lane] = maxPoint.x;
+    boxes->maxYs[lane] = maxPoint.y;
+    boxes->maxZs[lane] = maxPoint.z;
+}
+
+//
+// One ray against the first laneCount boxes. Returns a mask with bit i set if the ray enters box i before maxT (or
+// starts inside it), and writes the t it enters each box at to nearTs, negative for boxes it starts inside. nearTs of
+// boxes it misses are meaningless.
+//
+// _mm_min_ps/_mm_max_ps return their second operand if either one is NaN, so accumulating into a second operand that
+// starts out as +/- FLT_MAX drops the NaNs from 0 * infinity, like fmin/fmax do in raySlabs(..).
+//
+inline uint32 rayVsAabb4(Vec3 rayPosition, Vec3 inverseDirection, float32 maxT, Aabb4* boxes, uint32 laneCount, float32* nearTs)
+{
+    assert(laneCount <= 4);
+
+    uint32 result = 0;
+
+#if ALS_SSE
+    __m128 px = _mm_set1_ps(rayPosition.x);
+    __m128 py = _mm_set1_ps(rayPosition.y);
+    __m128 pz = _mm_set1_ps(rayPosition.z);
+    __m128 ix = _mm_set1_ps(inverseDirection.x);
+    __m128 iy = _mm_set1_ps(inverseDirection.y);
+    __m128 iz = _mm_set1_ps(inverseDirection.z);
+
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->minXs), px), ix);
+    __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->maxXs), px), ix);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->minYs), py), iy);
+    __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->maxYs), py), iy);
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->minZs), pz), iz);
+    __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(boxes->maxZs), pz), iz);
+
+    __m128 nearT = _mm_set1_ps(-FLT_MAX);
+    nearT = _mm_max_ps(_mm_min_ps(tx1, tx2), nearT);
+    nearT = _mm_max_ps(_mm_min_ps(ty1, ty2), nearT);
+    nearT = _mm_max_ps(_mm_min_ps(tz1, tz2), nearT);
+
+    __m128 farT = _mm_set1_ps(FLT_MAX);
+    farT = _mm_min_ps(_mm_max_ps(tx1, tx2), farT);
+    farT = _mm_min_ps(_mm_max_ps(ty1, ty2), farT);
+    farT = _mm_min_ps(_mm_max_ps(tz1, tz2), farT);
+
+    _mm_storeu_ps(nearTs, nearT);
+
+    __m128 hit = _mm_and_ps(
+        _mm_cmple_ps(nearT, farT),
+        _mm_and_ps(_mm_cmpge_ps(farT, _mm_setzero_ps()), _mm_cmple_ps(nearT, _mm_set1_ps(maxT))));
+
+    result = _mm_movemask_ps(hit);
+#else
+    for (uint32 lane = 0; lane < laneCount; lane++)
+    {
+        float32 farT;
+        raySlabs(
+            rayPosition, inverseDirection,
+            Vec3(boxes->minXs[lane], boxes->minYs[lane], boxes->minZs[lane]),
+            Vec3(boxes->maxXs[lane], boxes->maxYs[lane], boxes->maxZs[lane]),
+            &nearTs[lane], &farT);
+
+        if (nearTs[lane] <= farT && farT >= 0 && nearTs[lane] <= maxT) result |= 1 << lane;
+    }
+#endif
+
+    // Unused lanes hold whatever was left in them
+    return result & ((1 << laneCount) - 1);
+}
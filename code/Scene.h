@@ -3,6 +3,7 @@
 #include "ecs/Ecs.h"
 #include "ecs/Entity.h"
 #include "als/als_fixed_string.h"
+#include "PickingTree.h"
 
 struct Game;
 struct Cubemap;
@@ -16,9 +17,19 @@ struct Scene
     Game* game;
     string32 name;
 
+    // For castRay(..). Brought up to date by each cast.
+    PickingTree pickingTree;
+
     Scene();
 };
 
+//
+// Closest entity the ray hits. Each entity is hit at the closest of:
+//  - The triangles of its render components whose submeshes have triangle BVHs. These are two sided and hit wherever
+//    the ray starts, so a ray from inside a mesh hits its far side.
+//  - The bounds of its other render components, and the shapes of its colliders (bounds for shapes without a closed
+//    form test). These are only hit where the ray enters them, so a ray that starts inside one doesn't hit it.
+//
 RaycastResult castRay(Scene* ecs, Ray ray);
 void renderScene(Renderer* renderer, Scene* scene, CameraComponent* camera, ITransform* cameraXfm, uint32 recursionLevel = 0, ITransform* destPortalXfm = nullptr);
 void addCubemap(Scene* scene, Cubemap* cubemap);
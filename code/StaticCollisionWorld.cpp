@@ -0,0 +1,403 @@
+#include "StaticCollisionWorld.h"
+
+#include "ecs/Ecs.h"
+#include "ecs/components/ColliderComponent.h"
+#include "ecs/components/ConvexHullColliderComponent.h"
+#include "ecs/components/TransformComponent.h"
+#include "ecs/systems/CollisionSystem.h"
+
+#include <algorithm>
+#include <float.h>
+
+#define STATIC_BVH_BIN_COUNT 12
+#define STATIC_BVH_MAX_LEAF_SIZE 4
+
+// Deeper than this just becomes a leaf, which keeps the query stacks bounded
+#define STATIC_BVH_MAX_DEPTH (STATIC_BVH_QUERY_STACK_SIZE - 2)
+
+Vec3 StaticCollider::center()
+{
+    return this->worldCenter;
+}
+
+ColliderKey StaticCollider::colliderKey()
+{
+    return this->key;
+}
+
+Vec3 StaticCollider::support(Vec3 direction, HullSupportWarmStart* warmStart)
+{
+    if (this->isHull)
+    {
+        uint32 index = hullSupportIndex(
+            this->xs.data(), this->ys.data(), this->zs.data(), this->xs.size(),
+            this->adjacencyOffsets, this->adjacency, warmStart, direction);
+
+        return Vec3(this->xs[index], this->ys[index], this->zs[index]);
+    }
+
+    // Same as ColliderComponent::support(..), with the transform already looked up
+    direction.normalizeInPlace();
+
+    Quaternion toIdentity = relativeRotation(this->orientation, Quaternion());
+    Vec3 result = scaledColliderShapeSupport(&this->shape, toIdentity * direction);
+
+    return this->worldCenter + this->orientation * result;
+}
+
+uint32 StaticCollider::supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart)
+{
+    if (this->isHull)
+    {
+        return hullSupportFeature(
+            this->xs.data(), this->ys.data(), this->zs.data(), this->xs.size(),
+            this->adjacencyOffsets, this->adjacency, warmStart, direction, tolerance, out, maxCount);
+    }
+
+    direction.normalizeInPlace();
+
+    Quaternion toIdentity = relativeRotation(this->orientation, Quaternion());
+    uint32 count = scaledColliderShapeFeature(&this->shape, toIdentity * direction, tolerance, out, maxCount);
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        out[i] = this->worldCenter + this->orientation * out[i];
+    }
+
+    return count;
+}
+
+PrimitiveShape StaticCollider::primitiveShape()
+{
+    if (this->isHull)
+    {
+        PrimitiveShape result;
+        result.type = PrimitiveShapeType::HULL;
+        result.center = this->worldCenter;
+        result.planeXs = this->planeXs.data();
+        result.planeYs = this->planeYs.data();
+        result.planeZs = this->planeZs.data();
+        result.planeOffsets = this->planeOffsets.data();
+        result.planeCount = this->planeOffsets.size();
+
+        return result;
+    }
+
+    return scaledColliderShapePrimitive(&this->shape, this->worldCenter, this->orientation);
+}
+
+namespace
+{
+    struct BuildItem
+    {
+        Vec3 minPoint;
+        Vec3 maxPoint;
+        Vec3 centroid;
+        uint32 collider;
+    };
+
+    struct Bin
+    {
+        Vec3 minPoint = Vec3(FLT_MAX);
+        Vec3 maxPoint = Vec3(-FLT_MAX);
+        uint32 count = 0;
+    };
+
+    float32 surfaceArea(Vec3 minPoint, Vec3 maxPoint)
+    {
+        Vec3 d = maxPoint - minPoint;
+        return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    void fitNode(StaticBvhNode* node, BuildItem* items)
+    {
+        node->minPoint = Vec3(FLT_MAX);
+        node->maxPoint = Vec3(-FLT_MAX);
+
+        for (uint32 i = node->leftOrFirst; i < node->leftOrFirst + node->count; i++)
+        {
+            node->minPoint = componentwiseMin(node->minPoint, items[i].minPoint);
+            node->maxPoint = componentwiseMax(node->maxPoint, items[i].maxPoint);
+        }
+    }
+
+    //
+    // Binned SAH: bucket the items along each axis by centroid, and split between the buckets where
+    // (area left * count left + area right * count right) is lowest. Stays a leaf if that isn't cheaper than testing
+    // everything in it.
+    //
+    void subdivide(std::vector<StaticBvhNode>* nodes, BuildItem* items, uint32 nodeIndex, uint32 depth)
+    {
+        StaticBvhNode node = (*nodes)[nodeIndex];
+        if (node.count <= STATIC_BVH_MAX_LEAF_SIZE || depth >= STATIC_BVH_MAX_DEPTH) return;
+
+        Vec3 centroidMin = Vec3(FLT_MAX);
+        Vec3 centroidMax = Vec3(-FLT_MAX);
+        for (uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+        {
+            centroidMin = componentwiseMin(centroidMin, items[i].centroid);
+            centroidMax = componentwiseMax(centroidMax, items[i].centroid);
+        }
+
+        float32 bestCost = FLT_MAX;
+        uint32 bestAxis = 0;
+        uint32 bestSplit = 0;
+
+        for (uint32 axis = 0; axis < 3; axis++)
+        {
+            float32 extent = centroidMax.element[axis] - centroidMin.element[axis];
+            if (extent <= 0) continue;
+
+            float32 binScale = STATIC_BVH_BIN_COUNT / extent;
+
+            Bin bins[STATIC_BVH_BIN_COUNT];
+            for (uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+            {
+                uint32 binIndex = (uint32)((items[i].centroid.element[axis] - centroidMin.element[axis]) * binScale);
+                if (binIndex >= STATIC_BVH_BIN_COUNT) binIndex = STATIC_BVH_BIN_COUNT - 1;
+
+                Bin* bin = &bins[binIndex];
+                bin->minPoint = componentwiseMin(bin->minPoint, items[i].minPoint);
+                bin->maxPoint = componentwiseMax(bin->maxPoint, items[i].maxPoint);
+                bin->count++;
+            }
+
+            // Cost of everything left of each split, sweeping left to right, then add the right side sweeping back
+            float32 leftCosts[STATIC_BVH_BIN_COUNT - 1];
+            {
+                Vec3 minPoint = Vec3(FLT_MAX);
+                Vec3 maxPoint = Vec3(-FLT_MAX);
+                uint32 count = 0;
+
+                for (uint32 split = 0; split < STATIC_BVH_BIN_COUNT - 1; split++)
+                {
+                    minPoint = componentwiseMin(minPoint, bins[split].minPoint);
+                    maxPoint = componentwiseMax(maxPoint, bins[split].maxPoint);
+                    count += bins[split].count;
+
+                    leftCosts[split] = count > 0 ? count * surfaceArea(minPoint, maxPoint) : 0;
+                }
+            }
+
+            {
+                Vec3 minPoint = Vec3(FLT_MAX);
+                Vec3 maxPoint = Vec3(-FLT_MAX);
+                uint32 count = 0;
+
+                for (uint32 split = STATIC_BVH_BIN_COUNT - 1; split > 0; split--)
+                {
+                    minPoint = componentwiseMin(minPoint, bins[split].minPoint);
+                    maxPoint = componentwiseMax(maxPoint, bins[split].maxPoint);
+                    count += bins[split].count;
+
+                    float32 cost = leftCosts[split - 1] + (count > 0 ? count * surfaceArea(minPoint, maxPoint) : 0);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = split;
+                    }
+                }
+            }
+        }
+
+        float32 leafCost = node.count * surfaceArea(node.minPoint, node.maxPoint);
+        if (bestCost >= leafCost) return;
+
+        //
+        // Partition the items around the split
+        //
+        float32 axisMin = centroidMin.element[bestAxis];
+        float32 binScale = STATIC_BVH_BIN_COUNT / (centroidMax.element[bestAxis] - axisMin);
+
+        BuildItem* first = items + node.leftOrFirst;
+        BuildItem* middle = std::partition(first, first + node.count, [=](const BuildItem& item)
+        {
+            uint32 binIndex = (uint32)((item.centroid.element[bestAxis] - axisMin) * binScale);
+            if (binIndex >= STATIC_BVH_BIN_COUNT) binIndex = STATIC_BVH_BIN_COUNT - 1;
+
+            return binIndex < bestSplit;
+        });
+
+        uint32 leftCount = middle - first;
+        if (leftCount == 0 || leftCount == node.count) return;
+
+        StaticBvhNode left;
+        left.leftOrFirst = node.leftOrFirst;
+        left.count = leftCount;
+        fitNode(&left, items);
+
+        StaticBvhNode right;
+        right.leftOrFirst = node.leftOrFirst + leftCount;
+        right.count = node.count - leftCount;
+        fitNode(&right, items);
+
+        uint32 leftIndex = nodes->size();
+        nodes->push_back(left);
+        nodes->push_back(right);
+
+        (*nodes)[nodeIndex].leftOrFirst = leftIndex;
+        (*nodes)[nodeIndex].count = 0;
+
+        subdivide(nodes, items, leftIndex, depth + 1);
+        subdivide(nodes, items, leftIndex + 1, depth + 1);
+    }
+
+    void buildStaticBvh(StaticCollisionWorld* world)
+    {
+        world->nodes.clear();
+        if (world->colliders.empty()) return;
+
+        std::vector<BuildItem> items(world->colliders.size());
+        for (uint32 i = 0; i < world->colliders.size(); i++)
+        {
+            StaticCollider* collider = &world->colliders[i];
+
+            items[i].minPoint = collider->minPoint;
+            items[i].maxPoint = collider->maxPoint;
+            items[i].centroid = (collider->minPoint + collider->maxPoint) / 2;
+            items[i].collider = i;
+        }
+
+        StaticBvhNode root;
+        root.leftOrFirst = 0;
+        root.count = items.size();
+        fitNode(&root, items.data());
+
+        world->nodes.reserve(2 * items.size());
+        world->nodes.push_back(root);
+
+        subdivide(&world->nodes, items.data(), 0, 0);
+
+        // Put the colliders in leaf order
+        std::vector<StaticCollider> ordered;
+        ordered.reserve(items.size());
+
+        for (BuildItem& item : items)
+        {
+            ordered.push_back(std::move(world->colliders[item.collider]));
+        }
+
+        world->colliders.swap(ordered);
+    }
+
+    void setBounds(StaticCollider* baked, Aabb bounds)
+    {
+        baked->minPoint = bounds.minPoint();
+        baked->maxPoint = bounds.maxPoint();
+    }
+}
+
+void bakeStaticCollisionWorld(Ecs* ecs)
+{
+    StaticCollisionWorld* world = &ecs->staticCollisionWorld;
+    world->colliders.clear();
+
+    ArchetypeQuery colliderQuery;
+    colliderQuery.all = componentBit(ComponentType::Collider);
+
+    forEachArchetypeChunk(ecs, colliderQuery, [&](ArchetypeChunk* chunk)
+    {
+        for (uint32 row = 0; row < chunk->count; row++)
+        {
+            Entity e = chunk->entities[row];
+
+            EntityDetails* details = chunkComponent<EntityDetails>(chunk, row);
+            bool isStatic = details && (details->flags & EntityFlag_Static);
+
+            TransformComponent* xfm = chunkComponent<TransformComponent>(chunk, row);
+
+            for (uint32 i = 0; i < chunkComponentCount<ColliderComponent>(chunk, row); i++)
+            {
+                ColliderComponent* collider = chunkComponent<ColliderComponent>(chunk, row, i);
+                collider->isBaked = isStatic;
+
+                if (!isStatic) continue;
+
+                removeColliderProxy(ecs, collider);
+
+                StaticCollider baked;
+                baked.isTrigger = collider->isTrigger;
+                baked.entity = e;
+                baked.key = collider->colliderKey();
+                baked.isHull = false;
+                baked.shape = scaledColliderShape(collider);
+                baked.orientation = xfm->orientation();
+                baked.worldCenter = collider->center();
+                setBounds(&baked, aabbFromCollider(collider));
+
+                world->colliders.push_back(std::move(baked));
+            }
+        }
+    });
+
+    ArchetypeQuery hullQuery;
+    hullQuery.all = componentBit(ComponentType::ConvexHullCollider);
+
+    forEachArchetypeChunk(ecs, hullQuery, [&](ArchetypeChunk* chunk)
+    {
+        for (uint32 row = 0; row < chunk->count; row++)
+        {
+            Entity e = chunk->entities[row];
+
+            EntityDetails* details = chunkComponent<EntityDetails>(chunk, row);
+            bool isStatic = details && (details->flags & EntityFlag_Static);
+
+            for (uint32 i = 0; i < chunkComponentCount<ConvexHullColliderComponent>(chunk, row); i++)
+            {
+                ConvexHullColliderComponent* collider = chunkComponent<ConvexHullColliderComponent>(chunk, row, i);
+                collider->isBaked = isStatic && !collider->positions.empty();
+
+                if (!collider->isBaked) continue;
+
+                removeColliderProxy(ecs, collider);
+
+                StaticCollider baked;
+                baked.isTrigger = collider->isTrigger;
+                baked.entity = e;
+                baked.key = collider->colliderKey();
+                baked.isHull = true;
+
+                // The component already keeps its positions in world space
+                updateWorldPositions(collider);
+
+                baked.xs = collider->_worldXs;
+                baked.ys = collider->_worldYs;
+                baked.zs = collider->_worldZs;
+                baked.adjacencyOffsets = collider->adjacencyOffsets;
+                baked.adjacency = collider->adjacency;
+                baked.planeXs = collider->_worldPlaneXs;
+                baked.planeYs = collider->_worldPlaneYs;
+                baked.planeZs = collider->_worldPlaneZs;
+                baked.planeOffsets = collider->_worldPlaneOffsets;
+                baked.worldCenter = collider->_worldCenter;
+
+                Vec3 minPoint = Vec3(FLT_MAX);
+                Vec3 maxPoint = Vec3(-FLT_MAX);
+
+                for (uint32 j = 0; j < baked.xs.size(); j++)
+                {
+                    Vec3 worldPosition = Vec3(baked.xs[j], baked.ys[j], baked.zs[j]);
+
+                    minPoint = componentwiseMin(minPoint, worldPosition);
+                    maxPoint = componentwiseMax(maxPoint, worldPosition);
+                }
+
+                setBounds(&baked, aabbFromMinMax(minPoint, maxPoint));
+
+                world->colliders.push_back(std::move(baked));
+            }
+        }
+    });
+
+    buildStaticBvh(world);
+
+    world->isBaked = true;
+    world->needsRebake = false;
+}
+
+void markStaticCollisionWorldDirty(Ecs* ecs)
+{
+    StaticCollisionWorld* world = &ecs->staticCollisionWorld;
+    if (world->isBaked) world->needsRebake = true;
+}
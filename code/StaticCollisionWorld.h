@@ -0,0 +1,131 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "Aabb.h"
+#include "ConvexHull.h"
+#include "ICollider.h"
+#include "ecs/Entity.h"
+#include "ecs/components/ColliderComponent.h"
+
+#include <assert.h>
+#include <vector>
+
+struct Ecs;
+
+//
+// Colliders on static entities, baked into world space when the level is loaded. Everything a query or GJK needs is
+// copied in, so they never go back to the ECS for their transforms. The BVH over them is built once with the surface
+// area heuristic and never refit. The dynamic broadphase (see updateBroadphase(..)) only holds everything else.
+//
+// Static things only move or change in the editor. It marks the world dirty when it touches a static entity, and the
+// next updateBroadphase(..) rebakes it.
+//
+
+#define STATIC_BVH_QUERY_STACK_SIZE 64
+
+struct StaticCollider : public ICollider
+{
+    Entity entity;
+    ColliderKey key;    // The component it was baked from's, so cached pairs carry over when it's baked or rebaked
+
+    Vec3 minPoint;
+    Vec3 maxPoint;
+
+    bool isHull;
+
+    // Primitives (ColliderComponent)
+    ScaledColliderShape shape;
+    Quaternion orientation;
+    Vec3 worldCenter;
+
+    // Hulls (ConvexHullColliderComponent), in world space, laid out for maxDotIndex(..)
+    std::vector<float32> xs;
+    std::vector<float32> ys;
+    std::vector<float32> zs;
+    std::vector<uint32> adjacencyOffsets;
+    std::vector<uint32> adjacency;
+    std::vector<float32> planeXs;
+    std::vector<float32> planeYs;
+    std::vector<float32> planeZs;
+    std::vector<float32> planeOffsets;
+
+    Vec3 center() override;
+    ColliderKey colliderKey() override;
+    Vec3 support(Vec3 direction, HullSupportWarmStart* warmStart) override;
+    uint32 supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart) override;
+    PrimitiveShape primitiveShape() override;
+};
+
+struct StaticBvhNode
+{
+    Vec3 minPoint;
+    Vec3 maxPoint;
+
+    uint32 leftOrFirst; // Interior nodes: the left child, the right one is right after it. Leaves: the first collider.
+    uint32 count;       // Number of colliders in a leaf. 0 for interior nodes.
+};
+
+struct StaticCollisionWorld
+{
+    std::vector<StaticCollider> colliders;  // Ordered so every leaf's colliders are contiguous
+    std::vector<StaticBvhNode> nodes;       // nodes[0] is the root
+
+    bool isBaked = false;
+    bool needsRebake = false;
+};
+
+// Bakes every collider on an entity flagged EntityFlag_Static, and takes them out of the dynamic broadphase
+void bakeStaticCollisionWorld(Ecs* ecs);
+
+// Does nothing if the ECS was never baked
+void markStaticCollisionWorldDirty(Ecs* ecs);
+
+inline bool staticBvhNodeOverlaps(StaticBvhNode* node, Vec3 minPoint, Vec3 maxPoint)
+{
+    return node->minPoint.x <= maxPoint.x && node->maxPoint.x >= minPoint.x &&
+           node->minPoint.y <= maxPoint.y && node->maxPoint.y >= minPoint.y &&
+           node->minPoint.z <= maxPoint.z && node->maxPoint.z >= minPoint.z;
+}
+
+// Calls fn(StaticCollider*) for every static collider whose bounds overlap bounds
+template<class FN>
+void queryStaticOverlap(StaticCollisionWorld* world, Aabb bounds, FN fn)
+{
+    if (world->nodes.empty()) return;
+
+    Vec3 minPoint = bounds.minPoint();
+    Vec3 maxPoint = bounds.maxPoint();
+
+    uint32 stack[STATIC_BVH_QUERY_STACK_SIZE];
+    uint32 stackCount = 0;
+    stack[stackCount++] = 0;
+
+    while (stackCount > 0)
+    {
+        StaticBvhNode* node = &world->nodes[stack[--stackCount]];
+
+        if (!staticBvhNodeOverlaps(node, minPoint, maxPoint)) continue;
+
+        if (node->count > 0)
+        {
+            for (uint32 i = node->leftOrFirst; i < node->leftOrFirst + node->count; i++)
+            {
+                StaticCollider* collider = &world->colliders[i];
+
+                if (collider->minPoint.x <= maxPoint.x && collider->maxPoint.x >= minPoint.x &&
+                    collider->minPoint.y <= maxPoint.y && collider->maxPoint.y >= minPoint.y &&
+                    collider->minPoint.z <= maxPoint.z && collider->maxPoint.z >= minPoint.z)
+                {
+                    fn(collider);
+                }
+            }
+        }
+        else
+        {
+            assert(stackCount + 2 <= STATIC_BVH_QUERY_STACK_SIZE);
+            stack[stackCount++] = node->leftOrFirst;
+            stack[stackCount++] = node->leftOrFirst + 1;
+        }
+    }
+}
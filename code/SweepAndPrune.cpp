@@ -0,0 +1,273 @@
+#include "SweepAndPrune.h"
+
+#include <float.h>
+
+namespace
+{
+    inline int32 endpointProxy(SapEndpoint endpoint) { return endpoint.data >> 1; }
+    inline bool endpointIsMax(SapEndpoint endpoint) { return endpoint.data & 1; }
+
+    inline void setEndpointIndex(SweepAndPrune* sap, uint32 axis, SapEndpoint endpoint, uint32 index)
+    {
+        SapProxy* proxy = &sap->proxies[endpointProxy(endpoint)];
+
+        if (endpointIsMax(endpoint)) proxy->maxEndpoints[axis] = index;
+        else                         proxy->minEndpoints[axis] = index;
+    }
+
+    bool proxiesOverlap(SapProxy* a, SapProxy* b)
+    {
+        return a->minPoint.x <= b->maxPoint.x && a->maxPoint.x >= b->minPoint.x &&
+               a->minPoint.y <= b->maxPoint.y && a->maxPoint.y >= b->minPoint.y &&
+               a->minPoint.z <= b->maxPoint.z && a->maxPoint.z >= b->minPoint.z;
+    }
+
+    // Swap removes other from the proxy's overlaps. Returns false if it wasn't there.
+    bool removeOverlap(SapProxy* proxy, int32 other)
+    {
+        std::vector<int32>& overlaps = proxy->overlaps;
+
+        for (uint32 i = 0; i < overlaps.size(); i++)
+        {
+            if (overlaps[i] != other) continue;
+
+            overlaps[i] = overlaps.back();
+            overlaps.pop_back();
+            return true;
+        }
+
+        return false;
+    }
+
+    // The endpoints just started overlapping on one axis. They might overlap on the others too.
+    void addPairIfOverlapping(SweepAndPrune* sap, int32 proxyA, int32 proxyB)
+    {
+        SapProxy* a = &sap->proxies[proxyA];
+        SapProxy* b = &sap->proxies[proxyB];
+
+        if (!proxiesOverlap(a, b)) return;
+
+        // They may already have been overlapping, if they only ever stopped on this axis while apart on another one
+        for (int32 other : a->overlaps)
+        {
+            if (other == proxyB) return;
+        }
+
+        a->overlaps.push_back(proxyB);
+        b->overlaps.push_back(proxyA);
+    }
+
+    void removePair(SweepAndPrune* sap, int32 proxyA, int32 proxyB)
+    {
+        if (removeOverlap(&sap->proxies[proxyA], proxyB))
+        {
+            bool removed = removeOverlap(&sap->proxies[proxyB], proxyA);
+            assert(removed);
+        }
+    }
+
+    //
+    // Insertion sort of one endpoint. The proxy's bounds are already updated, so when the endpoint passes another
+    // proxy's endpoint the pair can be tested with their final bounds.
+    //
+    void sortEndpointDown(SweepAndPrune* sap, uint32 axis, uint32 index)
+    {
+        std::vector<SapEndpoint>& endpoints = sap->endpoints[axis];
+        SapEndpoint moving = endpoints[index];
+
+        while (index > 0 && endpoints[index - 1].value > moving.value)
+        {
+            SapEndpoint passed = endpoints[index - 1];
+
+            if (endpointIsMax(moving) != endpointIsMax(passed) && endpointProxy(moving) != endpointProxy(passed))
+            {
+                // A min moving below a max means the two intervals now overlap on this axis. A max moving below a min
+                // means they no longer do.
+                if (endpointIsMax(passed)) addPairIfOverlapping(sap, endpointProxy(moving), endpointProxy(passed));
+                else                       removePair(sap, endpointProxy(moving), endpointProxy(passed));
+            }
+
+            endpoints[index] = passed;
+            setEndpointIndex(sap, axis, passed, index);
+            index--;
+        }
+
+        endpoints[index] = moving;
+        setEndpointIndex(sap, axis, moving, index);
+    }
+
+    void sortEndpointUp(SweepAndPrune* sap, uint32 axis, uint32 index)
+    {
+        std::vector<SapEndpoint>& endpoints = sap->endpoints[axis];
+        SapEndpoint moving = endpoints[index];
+
+        while (index + 1 < endpoints.size() && endpoints[index + 1].value < moving.value)
+        {
+            SapEndpoint passed = endpoints[index + 1];
+
+            if (endpointIsMax(moving) != endpointIsMax(passed) && endpointProxy(moving) != endpointProxy(passed))
+            {
+                // Mirror of sortEndpointDown(..)
+                if (endpointIsMax(moving)) addPairIfOverlapping(sap, endpointProxy(moving), endpointProxy(passed));
+                else                       removePair(sap, endpointProxy(moving), endpointProxy(passed));
+            }
+
+            endpoints[index] = passed;
+            setEndpointIndex(sap, axis, passed, index);
+            index++;
+        }
+
+        endpoints[index] = moving;
+        setEndpointIndex(sap, axis, moving, index);
+    }
+
+    void setBounds(SweepAndPrune* sap, int32 proxyIndex, Vec3 minPoint, Vec3 maxPoint)
+    {
+        SapProxy* proxy = &sap->proxies[proxyIndex];
+
+        Vec3 oldMin = proxy->minPoint;
+        Vec3 oldMax = proxy->maxPoint;
+
+        proxy->minPoint = minPoint;
+        proxy->maxPoint = maxPoint;
+
+        for (uint32 axis = 0; axis < 3; axis++)
+        {
+            float32 deltaMin = minPoint.element[axis] - oldMin.element[axis];
+            float32 deltaMax = maxPoint.element[axis] - oldMax.element[axis];
+
+            sap->endpoints[axis][proxy->minEndpoints[axis]].value = minPoint.element[axis];
+            sap->endpoints[axis][proxy->maxEndpoints[axis]].value = maxPoint.element[axis];
+
+            // Growing before shrinking, so that neither endpoint gets stuck behind the proxy's other endpoint while it
+            // is still out of place
+            if (deltaMin < 0) sortEndpointDown(sap, axis, proxy->minEndpoints[axis]);
+            if (deltaMax > 0) sortEndpointUp(sap, axis, proxy->maxEndpoints[axis]);
+            if (deltaMin > 0) sortEndpointUp(sap, axis, proxy->minEndpoints[axis]);
+            if (deltaMax < 0) sortEndpointDown(sap, axis, proxy->maxEndpoints[axis]);
+        }
+    }
+}
+
+int32 addSapProxy(SweepAndPrune* sap, Aabb bounds, void* userData)
+{
+    int32 index;
+
+    if (sap->freeList < 0)
+    {
+        sap->proxies.push_back(SapProxy());
+        index = sap->proxies.size() - 1;
+    }
+    else
+    {
+        index = sap->freeList;
+        sap->freeList = sap->proxies[index].nextFree;
+    }
+
+    SapProxy* proxy = &sap->proxies[index];
+    proxy->userData = userData;
+    proxy->inUse = true;
+    proxy->nextFree = -1;
+
+    //
+    // Start the proxy off as a point past the end of every axis, then move it into place. The sort finds everything it
+    // overlaps along the way.
+    //
+    proxy->minPoint = Vec3(FLT_MAX);
+    proxy->maxPoint = Vec3(FLT_MAX);
+
+    for (uint32 axis = 0; axis < 3; axis++)
+    {
+        std::vector<SapEndpoint>& endpoints = sap->endpoints[axis];
+
+        SapEndpoint minEndpoint;
+        minEndpoint.value = FLT_MAX;
+        minEndpoint.data = (uint32)index << 1;
+
+        SapEndpoint maxEndpoint;
+        maxEndpoint.value = FLT_MAX;
+        maxEndpoint.data = ((uint32)index << 1) | 1;
+
+        proxy->minEndpoints[axis] = endpoints.size();
+        endpoints.push_back(minEndpoint);
+
+        proxy->maxEndpoints[axis] = endpoints.size();
+        endpoints.push_back(maxEndpoint);
+    }
+
+    setBounds(sap, index, bounds.minPoint(), bounds.maxPoint());
+
+    return index;
+}
+
+void removeSapProxy(SweepAndPrune* sap, int32 index)
+{
+    assert(index >= 0 && index < (int32)sap->proxies.size());
+    assert(sap->proxies[index].inUse);
+
+    // Mirror of addSapProxy(..). Moving it past the end of every axis removes all of its pairs.
+    setBounds(sap, index, Vec3(FLT_MAX), Vec3(FLT_MAX));
+
+    SapProxy* proxy = &sap->proxies[index];
+
+    for (uint32 axis = 0; axis < 3; axis++)
+    {
+        std::vector<SapEndpoint>& endpoints = sap->endpoints[axis];
+
+        //
+        // Its endpoints are at the end now, unless another proxy also sits at FLT_MAX. Swapping the last endpoint into
+        // their slot only reorders equal values, so the axis stays sorted.
+        //
+        for (uint32 i = 0; i < 2; i++)
+        {
+            // Re-read, since removing the max can move the min
+            uint32 slot = i == 0 ? proxy->maxEndpoints[axis] : proxy->minEndpoints[axis];
+            uint32 last = endpoints.size() - 1;
+
+            if (slot != last)
+            {
+                assert(endpoints[slot].value == FLT_MAX && endpoints[last].value == FLT_MAX);
+
+                SapEndpoint moved = endpoints[last];
+                endpoints[slot] = moved;
+                setEndpointIndex(sap, axis, moved, slot);
+            }
+
+            endpoints.pop_back();
+        }
+    }
+
+    // Anything left over was overlapping at FLT_MAX
+    for (int32 other : proxy->overlaps)
+    {
+        bool removed = removeOverlap(&sap->proxies[other], index);
+        assert(removed);
+    }
+
+    proxy->overlaps.clear();
+
+    proxy->inUse = false;
+    proxy->userData = nullptr;
+    proxy->nextFree = sap->freeList;
+    sap->freeList = index;
+}
+
+void moveSapProxy(SweepAndPrune* sap, int32 proxy, Aabb bounds)
+{
+    assert(proxy >= 0 && proxy < (int32)sap->proxies.size());
+    assert(sap->proxies[proxy].inUse);
+
+    setBounds(sap, proxy, bounds.minPoint(), bounds.maxPoint());
+}
+
+void clearSweepAndPrune(SweepAndPrune* sap)
+{
+    sap->proxies.clear();
+    sap->freeList = -1;
+
+    for (uint32 axis = 0; axis < 3; axis++)
+    {
+        sap->endpoints[axis].clear();
+    }
+
+}
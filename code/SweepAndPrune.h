@@ -0,0 +1,84 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "Aabb.h"
+
+#include <vector>
+
+//
+// Sort and sweep broadphase. Each proxy's AABB is projected onto the x, y and z axes, and each axis keeps the min and
+// max endpoints of every proxy sorted. Moving a proxy re-sorts its endpoints with insertion sort, which is close to free
+// when things only move a little each frame. Whenever an endpoint passes another proxy's endpoint the two proxies may
+// have started or stopped overlapping, which is the only time the pair set needs to be touched.
+//
+// Overlapping pairs persist across frames. Each proxy keeps the list of proxies it overlaps, so finding a proxy's pairs
+// or removing it only touches its own. Static colliders are baked into the StaticCollisionWorld instead of getting
+// proxies, so the lists only ever hold things that can move, and stay short.
+//
+
+struct SapEndpoint
+{
+    float32 value;
+    uint32 data; // Proxy index << 1, low bit set for max endpoints
+};
+
+struct SapProxy
+{
+    Vec3 minPoint;
+    Vec3 maxPoint;
+
+    void* userData;
+
+    uint32 minEndpoints[3]; // Index of this proxy's endpoints on each axis
+    uint32 maxEndpoints[3];
+
+    std::vector<int32> overlaps; // Proxies this one overlaps, in no particular order
+
+    int32 nextFree;         // -1 if in use (or the last free proxy)
+    bool inUse;
+};
+
+struct SweepAndPrune
+{
+    std::vector<SapProxy> proxies;
+    int32 freeList = -1;
+
+    std::vector<SapEndpoint> endpoints[3];
+};
+
+int32 addSapProxy(SweepAndPrune* sap, Aabb bounds, void* userData);
+void removeSapProxy(SweepAndPrune* sap, int32 proxy);
+void moveSapProxy(SweepAndPrune* sap, int32 proxy, Aabb bounds);
+
+void clearSweepAndPrune(SweepAndPrune* sap);
+
+inline void* sapProxyUserData(SweepAndPrune* sap, int32 proxy)
+{
+    assert(proxy >= 0 && proxy < (int32)sap->proxies.size());
+    assert(sap->proxies[proxy].inUse);
+
+    return sap->proxies[proxy].userData;
+}
+
+// For when whatever userData points at moves
+inline void setSapProxyUserData(SweepAndPrune* sap, int32 proxy, void* userData)
+{
+    assert(proxy >= 0 && proxy < (int32)sap->proxies.size());
+    assert(sap->proxies[proxy].inUse);
+
+    sap->proxies[proxy].userData = userData;
+}
+
+// Calls fn(int32 other) for every proxy that overlaps proxy, in no particular order
+template<class FN>
+void forEachSapOverlap(SweepAndPrune* sap, int32 proxy, FN fn)
+{
+    assert(proxy >= 0 && proxy < (int32)sap->proxies.size());
+    assert(sap->proxies[proxy].inUse);
+
+    for (int32 other : sap->proxies[proxy].overlaps)
+    {
+        fn(other);
+    }
+}
@@ -106,8 +106,8 @@ ITransform::matrix()
 {
     if (worldMatrixDirty)
     {
-        recalculateWorld();
-        
+        // Note: scale(), orientation() and position() recalculate the world values if (and only if) they are dirty.
+        //       Once they're clean, this only touches this transform, which lets updateWorldMatrices(..) run it in parallel.
         this->toWorld.identityInPlace(); // reset to identity
         
         this->toWorld.scaleInPlace(this->scale());
@@ -223,8 +223,7 @@ ITransform::setScale(float32 x, float32 y, float32 z)
 void
 ITransform::markSelfAndChildrenDirty()
 {
-    worldDirty = true;
-    worldMatrixDirty = true;
+    markSelfDirty();
     
     auto children = this->getChildren();
     for (auto t : children)
@@ -236,8 +235,12 @@ ITransform::markSelfAndChildrenDirty()
 void
 ITransform::recalculateWorld()
 {
-    ITransform* p = this->getParent();
+    recalculateWorld(this->getParent());
+}
 
+void
+ITransform::recalculateWorld(ITransform* p)
+{
     if (p)
     {
         multiplyTransforms(
@@ -51,10 +51,27 @@ struct ITransform
     void setScale(float32 x, float32 y, float32 z);
 
     void recalculateWorld();
-    
-    void markSelfAndChildrenDirty();
+
+    // Same as recalculateWorld(), but with the parent already looked up. The parent's world values must be up to date,
+    // so this only writes to this transform.
+    void recalculateWorld(ITransform* parent);
+
+    bool isWorldDirty() { return worldDirty; }
+
+    // Changes every time the world values are marked dirty. Caches of anything derived from them can hold onto this and
+    // compare it, instead of needing to be told.
+    uint32 worldVersion() { return _worldVersion; }
+
+    virtual void markSelfAndChildrenDirty();
     
 protected:
+    void markSelfDirty()
+    {
+        worldDirty = true;
+        worldMatrixDirty = true;
+        _worldVersion++;
+    }
+
     //
     // Authoratative
     //
@@ -72,6 +89,8 @@ protected:
 
     bool worldMatrixDirty = true;
     Mat4 toWorld;
+
+    uint32 _worldVersion = 0;
 };
 
 struct Transform : public ITransform
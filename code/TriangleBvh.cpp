@@ -0,0 +1,339 @@
+#include "TriangleBvh.h"
+
+#include "resource/MeshVertex.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace
+{
+    struct BuildTriangle
+    {
+        Vec3 minPoint;
+        Vec3 maxPoint;
+        Vec3 centroid;
+        uint32 triangle;
+    };
+
+    void setPacketLane(TrianglePacket* packet, uint32 lane, uint32 triangle, Vec3 v0, Vec3 v1, Vec3 v2)
+    {
+        Vec3 edge1 = v1 - v0;
+        Vec3 edge2 = v2 - v0;
+
+        packet->v0Xs[lane] = v0.x;
+        packet->v0Ys[lane] = v0.y;
+        packet->v0Zs[lane] = v0.z;
+        packet->edge1Xs[lane] = edge1.x;
+        packet->edge1Ys[lane] = edge1.y;
+        packet->edge1Zs[lane] = edge1.z;
+        packet->edge2Xs[lane] = edge2.x;
+        packet->edge2Ys[lane] = edge2.y;
+        packet->edge2Zs[lane] = edge2.z;
+        packet->triangles[lane] = triangle;
+    }
+
+    // Returns the index of the node
+    uint32 buildNode(
+        TriangleBvh* bvh,
+        const std::vector<MeshVertex>& vertices,
+        const std::vector<uint32>& indices,
+        BuildTriangle* triangles,
+        uint32 count)
+    {
+        assert(count > 0);
+
+        uint32 nodeIndex = (uint32)bvh->nodes.size();
+        bvh->nodes.emplace_back();
+
+        Vec3 minPoint = Vec3(FLT_MAX);
+        Vec3 maxPoint = Vec3(-FLT_MAX);
+        Vec3 centroidMin = Vec3(FLT_MAX);
+        Vec3 centroidMax = Vec3(-FLT_MAX);
+
+        for (uint32 i = 0; i < count; i++)
+        {
+            minPoint = componentwiseMin(triangles[i].minPoint, minPoint);
+            maxPoint = componentwiseMax(triangles[i].maxPoint, maxPoint);
+            centroidMin = componentwiseMin(triangles[i].centroid, centroidMin);
+            centroidMax = componentwiseMax(triangles[i].centroid, centroidMax);
+        }
+
+        // Recursing grows the vector, so the node is only written through the index once its children are done
+        TriangleBvhNode node;
+        node.minPoint = minPoint;
+        node.maxPoint = maxPoint;
+
+        if (count <= TRIANGLE_BVH_LEAF_SIZE)
+        {
+            TrianglePacket packet;
+            memset(&packet, 0, sizeof(packet));
+
+            for (uint32 i = 0; i < count; i++)
+            {
+                uint32 triangle = triangles[i].triangle;
+                setPacketLane(
+                    &packet, i, triangle,
+                    vertices[indices[3 * triangle + 0]].position,
+                    vertices[indices[3 * triangle + 1]].position,
+                    vertices[indices[3 * triangle + 2]].position);
+            }
+
+            node.offset = (uint32)bvh->packets.size();
+            node.triangleCount = count;
+            bvh->packets.push_back(packet);
+
+            bvh->nodes[nodeIndex] = node;
+            return nodeIndex;
+        }
+
+        //
+        // Split at the median centroid along the axis the centroids are most spread out on. That keeps the tree balanced
+        // no matter how the triangles are laid out. The first half is rounded up to a whole number of leaves so the
+        // packets come out full.
+        //
+        Vec3 centroidExtent = centroidMax - centroidMin;
+        uint32 axis = 0;
+        if (centroidExtent.y > centroidExtent.element[axis]) axis = 1;
+        if (centroidExtent.z > centroidExtent.element[axis]) axis = 2;
+
+        uint32 firstCount = ((count / 2 + TRIANGLE_BVH_LEAF_SIZE - 1) / TRIANGLE_BVH_LEAF_SIZE) * TRIANGLE_BVH_LEAF_SIZE;
+        assert(firstCount > 0 && firstCount < count);
+
+        std::nth_element(triangles, triangles + firstCount, triangles + count, [axis](const BuildTriangle& a, const BuildTriangle& b)
+        {
+            return a.centroid.element[axis] < b.centroid.element[axis];
+        });
+
+        uint32 firstChild = buildNode(bvh, vertices, indices, triangles, firstCount);
+        assert(firstChild == nodeIndex + 1);
+
+        node.offset = buildNode(bvh, vertices, indices, triangles + firstCount, count - firstCount);
+        node.triangleCount = 0;
+
+        bvh->nodes[nodeIndex] = node;
+        return nodeIndex;
+    }
+
+    // Slab test. Returns the t the ray enters the node at, or -1 if it misses or only enters after maxT.
+    inline float32 rayVsTriangleBvhNode(Vec3 rayPosition, Vec3 inverseDirection, float32 maxT, TriangleBvhNode* node)
+    {
+        float32 nearT, farT;
+        raySlabs(rayPosition, inverseDirection, node->minPoint, node->maxPoint, &nearT, &farT);
+
+        nearT = fmax(nearT, 0.0f);
+        farT = fmin(farT, maxT);
+
+        if (nearT > farT) return -1;
+        return nearT;
+    }
+
+    //
+    // Moller-Trumbore against every lane of the packet. Returns true if one is hit before maxT, and the closest one in
+    // hit.
+    //
+    bool rayVsTrianglePacket(Ray ray, TrianglePacket* packet, float32 maxT, TriangleHit* hit)
+    {
+        float32 ts[TRIANGLE_BVH_LEAF_SIZE];
+        float32 us[TRIANGLE_BVH_LEAF_SIZE];
+        float32 vs[TRIANGLE_BVH_LEAF_SIZE];
+        uint32 hitMask = 0;
+
+#if ALS_SSE
+        static_assert(TRIANGLE_BVH_LEAF_SIZE == 4, "The SSE path tests one packet per register");
+
+        __m128 dx = _mm_set1_ps(ray.direction.x);
+        __m128 dy = _mm_set1_ps(ray.direction.y);
+        __m128 dz = _mm_set1_ps(ray.direction.z);
+
+        __m128 e1x = _mm_load_ps(packet->edge1Xs);
+        __m128 e1y = _mm_load_ps(packet->edge1Ys);
+        __m128 e1z = _mm_load_ps(packet->edge1Zs);
+        __m128 e2x = _mm_load_ps(packet->edge2Xs);
+        __m128 e2y = _mm_load_ps(packet->edge2Ys);
+        __m128 e2z = _mm_load_ps(packet->edge2Zs);
+
+        // p = direction x edge2
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // s = ray position - v0
+        __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.position.x), _mm_load_ps(packet->v0Xs));
+        __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.position.y), _mm_load_ps(packet->v0Ys));
+        __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.position.z), _mm_load_ps(packet->v0Zs));
+
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+        // q = s x edge1
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+        // The zeroed lanes have a determinant of 0, so the first compare drops them along with the NaNs they make
+        __m128 zero = _mm_setzero_ps();
+        __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        __m128 hits = _mm_cmpgt_ps(absDet, _mm_set1_ps(RAY_VS_TRIANGLE_EPSILON));
+        hits = _mm_and_ps(hits, _mm_cmpge_ps(u, zero));
+        hits = _mm_and_ps(hits, _mm_cmpge_ps(v, zero));
+        hits = _mm_and_ps(hits, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+        hits = _mm_and_ps(hits, _mm_cmpge_ps(t, zero));
+        hits = _mm_and_ps(hits, _mm_cmplt_ps(t, _mm_set1_ps(maxT)));
+
+        hitMask = _mm_movemask_ps(hits);
+        if (hitMask == 0) return false;
+
+        _mm_storeu_ps(ts, t);
+        _mm_storeu_ps(us, u);
+        _mm_storeu_ps(vs, v);
+#else
+        for (uint32 lane = 0; lane < TRIANGLE_BVH_LEAF_SIZE; lane++)
+        {
+            Vec3 v0 = Vec3(packet->v0Xs[lane], packet->v0Ys[lane], packet->v0Zs[lane]);
+            Vec3 edge1 = Vec3(packet->edge1Xs[lane], packet->edge1Ys[lane], packet->edge1Zs[lane]);
+            Vec3 edge2 = Vec3(packet->edge2Xs[lane], packet->edge2Ys[lane], packet->edge2Zs[lane]);
+
+            ts[lane] = rayVsTriangle(ray, v0, v0 + edge1, v0 + edge2, &us[lane], &vs[lane]);
+            if (ts[lane] >= 0 && ts[lane] < maxT) hitMask |= 1 << lane;
+        }
+
+        if (hitMask == 0) return false;
+#endif
+
+        uint32 closestLane = TRIANGLE_BVH_LEAF_SIZE;
+        for (uint32 lane = 0; lane < TRIANGLE_BVH_LEAF_SIZE; lane++)
+        {
+            if (!(hitMask & (1 << lane))) continue;
+            if (closestLane == TRIANGLE_BVH_LEAF_SIZE || ts[lane] < ts[closestLane]) closestLane = lane;
+        }
+
+        hit->t = ts[closestLane];
+        hit->triangle = packet->triangles[closestLane];
+        hit->u = us[closestLane];
+        hit->v = vs[closestLane];
+
+        return true;
+    }
+}
+
+void buildTriangleBvh(TriangleBvh* bvh, const std::vector<MeshVertex>& vertices, const std::vector<uint32>& indices)
+{
+    assert(indices.size() % 3 == 0);
+
+    clearTriangleBvh(bvh);
+
+    uint32 triangleCount = (uint32)indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    std::vector<BuildTriangle> triangles(triangleCount);
+    for (uint32 i = 0; i < triangleCount; i++)
+    {
+        Vec3 v0 = vertices[indices[3 * i + 0]].position;
+        Vec3 v1 = vertices[indices[3 * i + 1]].position;
+        Vec3 v2 = vertices[indices[3 * i + 2]].position;
+
+        BuildTriangle* triangle = &triangles[i];
+        triangle->minPoint = componentwiseMin(componentwiseMin(v0, v1), v2);
+        triangle->maxPoint = componentwiseMax(componentwiseMax(v0, v1), v2);
+        triangle->centroid = (v0 + v1 + v2) / 3.0f;
+        triangle->triangle = i;
+    }
+
+    // Leaves come out (nearly) full, and a binary tree has one less inner node than it has leaves
+    uint32 leafCount = (triangleCount + TRIANGLE_BVH_LEAF_SIZE - 1) / TRIANGLE_BVH_LEAF_SIZE;
+    bvh->packets.reserve(leafCount);
+    bvh->nodes.reserve(2 * leafCount);
+
+    buildNode(bvh, vertices, indices, triangles.data(), triangleCount);
+}
+
+void clearTriangleBvh(TriangleBvh* bvh)
+{
+    bvh->nodes.clear();
+    bvh->packets.clear();
+}
+
+bool rayVsTriangleBvh(TriangleBvh* bvh, Ray ray, float32 maxT, TriangleHit* hit)
+{
+    if (!isBuilt(bvh)) return false;
+
+    Vec3 rayInverseDirection = inverseDirection(ray);
+    float32 closestT = maxT;
+    bool result = false;
+
+    float32 rootT = rayVsTriangleBvhNode(ray.position, rayInverseDirection, closestT, &bvh->nodes[0]);
+    if (rootT < 0) return false;
+
+    // Each node is pushed with the t the ray enters it at, so ones that end up behind a closer hit are skipped
+    uint32 stack[TRIANGLE_BVH_QUERY_STACK_SIZE];
+    float32 stackTs[TRIANGLE_BVH_QUERY_STACK_SIZE];
+    uint32 stackCount = 0;
+
+    stack[stackCount] = 0;
+    stackTs[stackCount] = rootT;
+    stackCount++;
+
+    while (stackCount > 0)
+    {
+        stackCount--;
+        if (stackTs[stackCount] >= closestT) continue;
+
+        uint32 index = stack[stackCount];
+        TriangleBvhNode* node = &bvh->nodes[index];
+
+        if (node->isLeaf())
+        {
+            if (rayVsTrianglePacket(ray, &bvh->packets[node->offset], closestT, hit))
+            {
+                closestT = hit->t;
+                result = true;
+            }
+
+            continue;
+        }
+
+        uint32 firstChild = index + 1;
+        uint32 secondChild = node->offset;
+
+        // Both children in one slab test
+        Aabb4 children;
+        setAabb4Lane(&children, 0, bvh->nodes[firstChild].minPoint, bvh->nodes[firstChild].maxPoint);
+        setAabb4Lane(&children, 1, bvh->nodes[secondChild].minPoint, bvh->nodes[secondChild].maxPoint);
+
+        float32 nearTs[4];
+        uint32 hitMask = rayVsAabb4(ray.position, rayInverseDirection, closestT, &children, 2, nearTs);
+
+        float32 firstT = (hitMask & 1) ? fmax(nearTs[0], 0.0f) : -1;
+        float32 secondT = (hitMask & 2) ? fmax(nearTs[1], 0.0f) : -1;
+
+        // The nearer child is pushed last so it's visited first, and its hits can cull the other one
+        if (firstT >= 0 && secondT >= 0 && firstT < secondT)
+        {
+            std::swap(firstChild, secondChild);
+            std::swap(firstT, secondT);
+        }
+
+        assert(stackCount + 2 <= TRIANGLE_BVH_QUERY_STACK_SIZE);
+
+        if (firstT >= 0)
+        {
+            stack[stackCount] = firstChild;
+            stackTs[stackCount] = firstT;
+            stackCount++;
+        }
+
+        if (secondT >= 0)
+        {
+            stack[stackCount] = secondChild;
+            stackTs[stackCount] = secondT;
+            stackCount++;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "als/als_simd.h"
+#include "Ray.h"
+
+#include <vector>
+
+struct MeshVertex;
+
+//
+// Static bounding volume hierarchy over a submesh's triangles, for raycasts against the actual geometry.
+//
+// Built once from the vertices and indices and never updated, so anything that moves the vertices has to rebuild it.
+// The nodes are flattened depth first: an inner node's first child comes right after it and it stores the index of the
+// second, so walking down the near side of the tree reads the nodes in order. Each node is 32 bytes and aligned to 32,
+// so two of them share a cache line and never straddle one.
+//
+// Each leaf holds up to TRIANGLE_BVH_LEAF_SIZE triangles in one TrianglePacket, which is tested against the ray all at
+// once.
+//
+
+#define TRIANGLE_BVH_LEAF_SIZE 4
+
+// Nodes are split at the median, so a tree this deep holds far more triangles than any mesh will
+#define TRIANGLE_BVH_QUERY_STACK_SIZE 64
+
+struct alignas(32) TriangleBvhNode
+{
+    Vec3 minPoint;
+    uint32 offset; // Inner nodes: index of the second child. Leaves: index of the packet.
+    Vec3 maxPoint;
+    uint32 triangleCount; // 0 for inner nodes
+
+    inline bool isLeaf() { return triangleCount > 0; }
+};
+
+static_assert(sizeof(TriangleBvhNode) == 32, "TriangleBvhNode should fill exactly half a cache line");
+
+//
+// The triangles of a leaf, one array per coordinate, stored as the first vertex and the edges from it to the other two
+// like Moller-Trumbore wants them. Lanes past the leaf's triangleCount are zeroed, which makes them degenerate
+// triangles that nothing hits.
+//
+struct alignas(16) TrianglePacket
+{
+    float32 v0Xs[TRIANGLE_BVH_LEAF_SIZE];
+    float32 v0Ys[TRIANGLE_BVH_LEAF_SIZE];
+    float32 v0Zs[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge1Xs[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge1Ys[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge1Zs[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge2Xs[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge2Ys[TRIANGLE_BVH_LEAF_SIZE];
+    float32 edge2Zs[TRIANGLE_BVH_LEAF_SIZE];
+
+    uint32 triangles[TRIANGLE_BVH_LEAF_SIZE];
+};
+
+struct TriangleBvh
+{
+    std::vector<TriangleBvhNode, AlignedAllocator<TriangleBvhNode>> nodes;
+    std::vector<TrianglePacket, AlignedAllocator<TrianglePacket>> packets;
+};
+
+void buildTriangleBvh(TriangleBvh* bvh, const std::vector<MeshVertex>& vertices, const std::vector<uint32>& indices);
+void clearTriangleBvh(TriangleBvh* bvh);
+
+inline bool isBuilt(TriangleBvh* bvh)
+{
+    return !bvh->nodes.empty();
+}
+
+// Same as rayVsSubmesh(..), for the triangles the BVH was built from
+bool rayVsTriangleBvh(TriangleBvh* bvh, Ray ray, float32 maxT, TriangleHit* hit);
@@ -10,6 +10,9 @@
 // Demo: Iterators, (Overloading x Polymorphism) - Jon Blow
 // https://www.youtube.com/watch?v=COQKyOCAxOQ&index=24&list=PLmV5I2fxaiCKfxMBrNsU1kgKJXD3PkyxO
 //
+// Occupancy is stored as a 64-bit mask per 64 slots, so finding the next occupied (or empty) slot is a ctz
+// instead of a linear scan. A Fenwick tree over the per-bucket counts makes indexed access (at) O(log buckets).
+//
 
 #define FOR_BUCKET_ARRAY(bucketArray) \
     for ( auto it = (bucketArray)._initIterator(); (it = (bucketArray).iterate(it)).flag != _BucketArrayIteratorFlag::POST_ITERATE ; )
@@ -32,11 +35,16 @@ struct BucketLocator
 template<typename T, uint32 BUCKET_SIZE = 16>
 struct BucketArray
 {
+    static constexpr uint32 OCCUPANCY_WORD_COUNT = (BUCKET_SIZE + 63) / 64;
+
+    // Mask of the bits in the last occupancy word that correspond to real slots
+    static constexpr uint64 LAST_OCCUPANCY_WORD_MASK = (BUCKET_SIZE % 64 == 0) ? ~0ULL : ((1ULL << (BUCKET_SIZE % 64)) - 1);
+
     struct Bucket
     {
         uint32 index = 0;
         uint32 count = 0;
-        bool occupied[BUCKET_SIZE] = { 0 };
+        uint64 occupied[OCCUPANCY_WORD_COUNT] = { 0 };
         T data[BUCKET_SIZE];
     };
 
@@ -56,6 +64,34 @@ struct BucketArray
     uint32 count = 0;
 
 private:
+    // 1-based Fenwick tree of the bucket counts. prefixCounts[i] holds the sum of the counts of buckets
+    // (i - lowbit(i), i]
+    std::vector<uint32> prefixCounts = std::vector<uint32>(1, 0);
+
+    static uint32 lowestSetBit(uint32 value)
+    {
+        return value & (0 - value);
+    }
+
+    void updatePrefixCounts(uint32 bucketIndex, int32 delta)
+    {
+        for (uint32 i = bucketIndex + 1; i < this->prefixCounts.size(); i += lowestSetBit(i))
+        {
+            this->prefixCounts[i] += delta;
+        }
+    }
+
+    uint32 prefixCountBefore(uint32 bucketIndex)
+    {
+        uint32 result = 0;
+        for (uint32 i = bucketIndex; i > 0; i -= lowestSetBit(i))
+        {
+            result += this->prefixCounts[i];
+        }
+
+        return result;
+    }
+
     Bucket* addBucket()
     {
         // We should only internally add a bucket when there are no unfull buckets
@@ -67,9 +103,58 @@ private:
         this->buckets.push_back(bucket);
         this->unfullBuckets.push_back(bucket);
 
+        // The new node covers (n - lowbit(n), n], all of which are existing buckets except the new (empty) one
+        uint32 node = this->buckets.size();
+        this->prefixCounts.push_back(prefixCountBefore(node - 1) - prefixCountBefore(node - lowestSetBit(node)));
+
         return bucket;
     }
 
+    // Returns the first occupied slot in the bucket at or after slotIndex, or -1 if there is none
+    int32 firstOccupiedSlotFrom(Bucket* bucket, uint32 slotIndex)
+    {
+        if (bucket->count == 0 || slotIndex >= BUCKET_SIZE) return -1;
+
+        uint32 word = slotIndex / 64;
+        uint64 bits = bucket->occupied[word] & (~0ULL << (slotIndex % 64));
+
+        while (true)
+        {
+            if (bits != 0) return word * 64 + countTrailingZeros64(bits);
+
+            word++;
+            if (word == OCCUPANCY_WORD_COUNT) return -1;
+
+            bits = bucket->occupied[word];
+        }
+    }
+
+    // Returns the slot of the n-th (0-based) occupied slot in the bucket
+    uint32 nthOccupiedSlot(Bucket* bucket, uint32 n)
+    {
+        assert(n < bucket->count);
+
+        for (uint32 word = 0; word < OCCUPANCY_WORD_COUNT; word++)
+        {
+            uint64 bits = bucket->occupied[word];
+            uint32 bitsSet = popcount64(bits);
+
+            if (n < bitsSet)
+            {
+                for (uint32 i = 0; i < n; i++)
+                {
+                    bits &= bits - 1; // clear lowest set bit
+                }
+
+                return word * 64 + countTrailingZeros64(bits);
+            }
+
+            n -= bitsSet;
+        }
+
+        assert(false);
+        return 0;
+    }
 
 public:
     BucketLocator occupyEmptySlot()
@@ -81,23 +166,33 @@ public:
 
         Bucket* bucket = this->unfullBuckets[0];
         result.bucketIndex = bucket->index;
+        result.slotIndex = -1;
 
-        for (uint32 i = 0; i < BUCKET_SIZE; i++)
+        for (uint32 word = 0; word < OCCUPANCY_WORD_COUNT; word++)
         {
-            if (!bucket->occupied[i])
-            {
-                bucket->occupied[i] = true;
-                bucket->count++;
-                this->count++;
-                result.slotIndex = i;
+            uint64 empty = ~bucket->occupied[word];
+            if (word == OCCUPANCY_WORD_COUNT - 1) empty &= LAST_OCCUPANCY_WORD_MASK;
 
+            if (empty != 0)
+            {
+                uint32 bit = countTrailingZeros64(empty);
+                bucket->occupied[word] |= (1ULL << bit);
+                result.slotIndex = word * 64 + bit;
                 break;
             }
         }
 
+        assert(result.slotIndex >= 0);
+
+        bucket->count++;
+        this->count++;
+        updatePrefixCounts(bucket->index, 1);
+
         if (bucket->count == BUCKET_SIZE)
         {
-            this->unfullBuckets.erase(std::find(this->unfullBuckets.begin(), this->unfullBuckets.end(), bucket));
+            // Unordered remove. Order of the unfull buckets doesn't matter
+            this->unfullBuckets[0] = this->unfullBuckets.back();
+            this->unfullBuckets.pop_back();
         }
 
         return result;
@@ -143,9 +238,10 @@ public:
         if (this->isOccupied(locator))
         {
             Bucket* bucket = this->buckets[locator.bucketIndex];
-            bucket->occupied[locator.slotIndex] = false;
+            bucket->occupied[locator.slotIndex / 64] &= ~(1ULL << (locator.slotIndex % 64));
             bucket->count--;
             this->count--;
+            updatePrefixCounts(bucket->index, -1);
 
             if (bucket->count == BUCKET_SIZE - 1)
             {
@@ -162,9 +258,11 @@ public:
 
     bool isOccupied(BucketLocator locator)
     {
-        if (locator.bucketIndex < 0 || locator.slotIndex < 0 || this->buckets.empty()) return false;
+        if (locator.bucketIndex < 0 || locator.slotIndex < 0) return false;
+        if ((uint32)locator.bucketIndex >= this->buckets.size() || (uint32)locator.slotIndex >= BUCKET_SIZE) return false;
         
-        return this->buckets[locator.bucketIndex]->occupied[locator.slotIndex];
+        uint64 word = this->buckets[locator.bucketIndex]->occupied[locator.slotIndex / 64];
+        return (word & (1ULL << (locator.slotIndex % 64))) != 0;
     }
 
     bool isEmpty()
@@ -183,48 +281,26 @@ public:
 
     bool hasNext(BucketLocator locator)
     {
-        int32 bucketIndex = locator.bucketIndex;
-        int32 slotIndex = locator.slotIndex;
-
-        if (bucketIndex * BUCKET_SIZE + slotIndex < this->count - 1) return true;
-
-        while(bucketIndex < this->buckets.size())
-        {
-            slotIndex++;
-
-            if (slotIndex == BUCKET_SIZE)
-            {
-                slotIndex = 0;
-                bucketIndex++;
-            }
-
-            if (this->buckets[bucketIndex]->occupied[slotIndex]) return true;
-        }
-
-        return false;
+        return this->next(locator).bucketIndex != -1;
     }
 
     BucketLocator next(BucketLocator locator)
     {
+        if (locator.bucketIndex < 0) return BucketLocator(-1, -1);
+
         uint32 bucketIndex = locator.bucketIndex;
-        uint32 slotIndex = locator.slotIndex;
+        uint32 slotIndex = locator.slotIndex + 1;
 
         while(bucketIndex < this->buckets.size())
         {
-            slotIndex++;
-
-            if (slotIndex == BUCKET_SIZE)
+            int32 slot = firstOccupiedSlotFrom(this->buckets[bucketIndex], slotIndex);
+            if (slot >= 0)
             {
-                slotIndex = 0;
-                bucketIndex++;
-
-                if (bucketIndex == this->buckets.size()) break;
+                return BucketLocator(bucketIndex, slot);
             }
 
-            if (this->buckets[bucketIndex]->occupied[slotIndex])
-            {
-                return BucketLocator(bucketIndex, slotIndex);
-            }
+            bucketIndex++;
+            slotIndex = 0;
         }
 
         return BucketLocator(-1, -1);
@@ -279,21 +355,30 @@ public:
     {
         if (index >= this->count) return nullptr;
 
-        BucketIterator it = _initIterator();
+        //
+        // Descend the Fenwick tree to find the bucket that contains the index-th item
+        //
+        uint32 bucketNode = 0;
+        uint32 remaining = index;
 
-        for (uint32 i = 0; i <= index; i++)
-        {
-            it = iterate(it);
+        uint32 step = 1;
+        while (step * 2 < this->prefixCounts.size()) step *= 2;
 
-            if (it.flag == _BucketArrayIteratorFlag::POST_ITERATE)
+        for ( ; step > 0; step /= 2)
+        {
+            uint32 candidate = bucketNode + step;
+            if (candidate < this->prefixCounts.size() && this->prefixCounts[candidate] <= remaining)
             {
-                // This should get caught at the initial check this function makes
-                assert(false);
-                return nullptr;
+                bucketNode = candidate;
+                remaining -= this->prefixCounts[candidate];
             }
         }
 
-        return it.ptr;
+        // bucketNode is the number of buckets entirely before the one we want, which is also its 0-based index
+        Bucket* bucket = this->buckets[bucketNode];
+        uint32 slot = nthOccupiedSlot(bucket, remaining);
+
+        return &bucket->data[slot];
     }
 
     ~BucketArray()
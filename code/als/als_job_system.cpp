@@ -0,0 +1,169 @@
+#include "als_job_system.h"
+#include "assert.h"
+
+// Index into JobSystem::workers for the current thread, or -1 if the thread isn't part of a job system
+static thread_local int32 currentWorkerIndex = -1;
+
+static bool popOrSteal(JobSystem* jobs, Job* outJob)
+{
+    int32 workerCount = jobs->workers.size();
+    int32 selfIndex = currentWorkerIndex;
+    assert(selfIndex >= 0 && selfIndex < workerCount);
+
+    // Own jobs, newest first. They are most likely to still be in cache
+    {
+        JobWorker* self = jobs->workers[selfIndex];
+        std::lock_guard<std::mutex> lock(self->mutex);
+
+        if (!self->jobs.empty())
+        {
+            *outJob = std::move(self->jobs.back());
+            self->jobs.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest job from someone else. These tend to be the biggest chunks of remaining work.
+    for (int32 i = 1; i < workerCount; i++)
+    {
+        JobWorker* victim = jobs->workers[(selfIndex + i) % workerCount];
+        std::lock_guard<std::mutex> lock(victim->mutex);
+
+        if (!victim->jobs.empty())
+        {
+            *outJob = std::move(victim->jobs.front());
+            victim->jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void runJob(JobSystem* jobs, Job* job)
+{
+    jobs->queuedJobCount--;
+
+    job->function();
+
+    if (job->counter)
+    {
+        job->counter->value--;
+    }
+}
+
+static void workerLoop(JobSystem* jobs, int32 workerIndex)
+{
+    currentWorkerIndex = workerIndex;
+
+    while (!jobs->isShuttingDown)
+    {
+        if (tryRunJob(jobs)) continue;
+
+        std::unique_lock<std::mutex> lock(jobs->sleepMutex);
+        jobs->sleepCondition.wait(lock, [jobs]() { return jobs->isShuttingDown || jobs->queuedJobCount > 0; });
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    shutdownJobSystem(this);
+}
+
+void initJobSystem(JobSystem* jobs, uint32 workerThreadCount)
+{
+    assert(jobs->workers.empty());
+    assert(currentWorkerIndex == -1); // One job system per thread
+
+    // Worker 0 is the calling thread
+    for (uint32 i = 0; i < workerThreadCount + 1; i++)
+    {
+        jobs->workers.push_back(new JobWorker());
+    }
+
+    currentWorkerIndex = 0;
+
+    for (uint32 i = 0; i < workerThreadCount; i++)
+    {
+        jobs->threads.emplace_back(workerLoop, jobs, i + 1);
+    }
+}
+
+void shutdownJobSystem(JobSystem* jobs)
+{
+    if (jobs->workers.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(jobs->sleepMutex);
+        jobs->isShuttingDown = true;
+    }
+
+    jobs->sleepCondition.notify_all();
+
+    for (std::thread& thread : jobs->threads)
+    {
+        thread.join();
+    }
+
+    for (JobWorker* worker : jobs->workers)
+    {
+        assert(worker->jobs.empty());
+        delete worker;
+    }
+
+    jobs->threads.clear();
+    jobs->workers.clear();
+    currentWorkerIndex = -1;
+}
+
+uint32 jobWorkerCount(JobSystem* jobs)
+{
+    return jobs->workers.size();
+}
+
+void submitJob(JobSystem* jobs, std::function<void()> function, JobCounter* counter)
+{
+    int32 selfIndex = currentWorkerIndex;
+    assert(selfIndex >= 0 && selfIndex < (int32)jobs->workers.size());
+
+    if (counter) counter->value++;
+
+    Job job;
+    job.function = std::move(function);
+    job.counter = counter;
+
+    {
+        JobWorker* self = jobs->workers[selfIndex];
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->jobs.push_back(std::move(job));
+    }
+
+    {
+        // Taking the lock makes sure a worker that just checked queuedJobCount is actually waiting before we notify
+        std::lock_guard<std::mutex> lock(jobs->sleepMutex);
+        jobs->queuedJobCount++;
+    }
+
+    jobs->sleepCondition.notify_one();
+}
+
+bool tryRunJob(JobSystem* jobs)
+{
+    Job job;
+    if (!popOrSteal(jobs, &job)) return false;
+
+    runJob(jobs, &job);
+    return true;
+}
+
+void waitForCounter(JobSystem* jobs, JobCounter* counter)
+{
+    while (counter->value > 0)
+    {
+        if (!tryRunJob(jobs))
+        {
+            // The remaining jobs are running on other workers
+            std::this_thread::yield();
+        }
+    }
+}
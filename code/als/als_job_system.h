@@ -0,0 +1,97 @@
+#pragma once
+
+#include "als_types.h"
+
+#include <assert.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Fixed-size work-stealing job system. Every worker (the main thread is worker 0) owns a deque of jobs. A worker
+// pushes and pops its own jobs at the back, and steals from the front of the other workers' deques when it runs out.
+//
+// Jobs signal completion through a JobCounter. Waiting on a counter runs other jobs instead of blocking, so jobs
+// can submit and wait on their own sub-jobs (e.g., a system that does a parallelFor) without deadlocking.
+//
+
+struct JobCounter
+{
+    std::atomic<int32> value { 0 };
+};
+
+struct Job
+{
+    std::function<void()> function;
+    JobCounter* counter = nullptr;
+};
+
+struct JobWorker
+{
+    std::mutex mutex;
+    std::deque<Job> jobs;
+};
+
+struct JobSystem
+{
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem();
+
+    std::vector<JobWorker*> workers; // 0 is the thread that called initJobSystem(..)
+    std::vector<std::thread> threads;
+
+    std::atomic<int32> queuedJobCount { 0 };
+    std::atomic<bool> isShuttingDown { false };
+
+    // Idle workers sleep here until a job is submitted
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+};
+
+void initJobSystem(JobSystem* jobs, uint32 workerThreadCount);
+void shutdownJobSystem(JobSystem* jobs);
+
+uint32 jobWorkerCount(JobSystem* jobs);
+
+// Must be called from the thread that initialized the job system or from inside a job
+void submitJob(JobSystem* jobs, std::function<void()> function, JobCounter* counter);
+
+// Runs one queued job (own deque first, then steals). Returns false if there was nothing to run.
+bool tryRunJob(JobSystem* jobs);
+
+// Helps run jobs until the counter reaches 0
+void waitForCounter(JobSystem* jobs, JobCounter* counter);
+
+//
+// Calls fn(begin, end) over [0, count) in batches of batchSize, and waits for all of them. The calling thread
+// runs the first batch itself.
+//
+template<class FN>
+void parallelFor(JobSystem* jobs, uint32 count, uint32 batchSize, FN fn)
+{
+    if (count == 0) return;
+    assert(batchSize > 0);
+
+    if (count <= batchSize || jobWorkerCount(jobs) <= 1)
+    {
+        fn(0, count);
+        return;
+    }
+
+    JobCounter counter;
+
+    for (uint32 begin = batchSize; begin < count; begin += batchSize)
+    {
+        uint32 end = (count - begin > batchSize) ? begin + batchSize : count;
+        submitJob(jobs, [&fn, begin, end]() { fn(begin, end); }, &counter);
+    }
+
+    fn(0, batchSize);
+    waitForCounter(jobs, &counter);
+}
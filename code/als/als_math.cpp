@@ -1,4 +1,5 @@
 #include "als_math.h"
+#include "als_simd.h"
 #include <cmath>
 
 Vec2::Vec2() { this->x = 0; this->y = 0; }
@@ -1466,3 +1467,166 @@ float32 determinant(Mat4 m)
 
     return result;
 }
+
+void composeTrsMatrices(const Vec3* positions, const Quaternion* orientations, const Vec3* scales, uint32 count, Mat4* const* out)
+{
+    uint32 i = 0;
+
+#if ALS_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 lastRow = _mm_setr_ps(0, 0, 0, 1);
+
+    for ( ; i + 4 <= count; i += 4)
+    {
+        // Lane k is transform i + k
+        __m128 qx = _mm_loadu_ps(orientations[i + 0].element);
+        __m128 qy = _mm_loadu_ps(orientations[i + 1].element);
+        __m128 qz = _mm_loadu_ps(orientations[i + 2].element);
+        __m128 qw = _mm_loadu_ps(orientations[i + 3].element);
+        _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+        __m128 sx = _mm_setr_ps(scales[i].x, scales[i + 1].x, scales[i + 2].x, scales[i + 3].x);
+        __m128 sy = _mm_setr_ps(scales[i].y, scales[i + 1].y, scales[i + 2].y, scales[i + 3].y);
+        __m128 sz = _mm_setr_ps(scales[i].z, scales[i + 1].z, scales[i + 2].z, scales[i + 3].z);
+
+        __m128 tx = _mm_setr_ps(positions[i].x, positions[i + 1].x, positions[i + 2].x, positions[i + 3].x);
+        __m128 ty = _mm_setr_ps(positions[i].y, positions[i + 1].y, positions[i + 2].y, positions[i + 3].y);
+        __m128 tz = _mm_setr_ps(positions[i].z, positions[i + 1].z, positions[i + 2].z, positions[i + 3].z);
+
+        __m128 xx = _mm_mul_ps(qx, qx);
+        __m128 yy = _mm_mul_ps(qy, qy);
+        __m128 zz = _mm_mul_ps(qz, qz);
+        __m128 xy = _mm_mul_ps(qx, qy);
+        __m128 xz = _mm_mul_ps(qx, qz);
+        __m128 yz = _mm_mul_ps(qy, qz);
+        __m128 xw = _mm_mul_ps(qx, qw);
+        __m128 yw = _mm_mul_ps(qy, qw);
+        __m128 zw = _mm_mul_ps(qz, qw);
+
+        // Rotation (see rotationMatrix3) with each column scaled, and the translation in the last column
+        __m128 m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        __m128 m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, zw)), sy);
+        __m128 m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, yw)), sz);
+
+        __m128 m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, zw)), sx);
+        __m128 m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        __m128 m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, xw)), sz);
+
+        __m128 m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, yw)), sx);
+        __m128 m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, xw)), sy);
+        __m128 m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+        // Transpose back so each register is one row of one matrix
+        _MM_TRANSPOSE4_PS(m00, m01, m02, tx);
+        _MM_TRANSPOSE4_PS(m10, m11, m12, ty);
+        _MM_TRANSPOSE4_PS(m20, m21, m22, tz);
+
+        _mm_storeu_ps(out[i + 0]->_e[0], m00);
+        _mm_storeu_ps(out[i + 1]->_e[0], m01);
+        _mm_storeu_ps(out[i + 2]->_e[0], m02);
+        _mm_storeu_ps(out[i + 3]->_e[0], tx);
+
+        _mm_storeu_ps(out[i + 0]->_e[1], m10);
+        _mm_storeu_ps(out[i + 1]->_e[1], m11);
+        _mm_storeu_ps(out[i + 2]->_e[1], m12);
+        _mm_storeu_ps(out[i + 3]->_e[1], ty);
+
+        _mm_storeu_ps(out[i + 0]->_e[2], m20);
+        _mm_storeu_ps(out[i + 1]->_e[2], m21);
+        _mm_storeu_ps(out[i + 2]->_e[2], m22);
+        _mm_storeu_ps(out[i + 3]->_e[2], tz);
+
+        _mm_storeu_ps(out[i + 0]->_e[3], lastRow);
+        _mm_storeu_ps(out[i + 1]->_e[3], lastRow);
+        _mm_storeu_ps(out[i + 2]->_e[3], lastRow);
+        _mm_storeu_ps(out[i + 3]->_e[3], lastRow);
+    }
+#endif
+
+    for ( ; i < count; i++)
+    {
+        Mat3 r = rotationMatrix3(orientations[i]);
+        Vec3 s = scales[i];
+        Vec3 t = positions[i];
+        Mat4& m = *out[i];
+
+        m[0][0] = r[0][0] * s.x;   m[0][1] = r[0][1] * s.y;   m[0][2] = r[0][2] * s.z;   m[0][3] = t.x;
+        m[1][0] = r[1][0] * s.x;   m[1][1] = r[1][1] * s.y;   m[1][2] = r[1][2] * s.z;   m[1][3] = t.y;
+        m[2][0] = r[2][0] * s.x;   m[2][1] = r[2][1] * s.y;   m[2][2] = r[2][2] * s.z;   m[2][3] = t.z;
+        m[3][0] = 0;               m[3][1] = 0;               m[3][2] = 0;               m[3][3] = 1;
+    }
+}
+
+uint32 maxDotIndex(const float32* xs, const float32* ys, const float32* zs, uint32 count, Vec3 direction)
+{
+    assert(count > 0);
+
+    uint32 i = 0;
+    uint32 result = 0;
+    float32 biggestDot = xs[0] * direction.x + ys[0] * direction.y + zs[0] * direction.z;
+
+#if ALS_SSE
+    if (count >= 4)
+    {
+        const __m128 dx = _mm_set1_ps(direction.x);
+        const __m128 dy = _mm_set1_ps(direction.y);
+        const __m128 dz = _mm_set1_ps(direction.z);
+        const __m128 four = _mm_set1_ps(4.0f);
+
+        // Indices are kept as floats so they can be blended with the same masks. Exact up to 2^24 points.
+        __m128 indices = _mm_setr_ps(0, 1, 2, 3);
+        __m128 bestIndices = indices;
+        __m128 bestDots = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(xs), dx), _mm_mul_ps(_mm_loadu_ps(ys), dy)),
+            _mm_mul_ps(_mm_loadu_ps(zs), dz)
+        );
+
+        for (i = 4; i + 4 <= count; i += 4)
+        {
+            indices = _mm_add_ps(indices, four);
+
+            __m128 dots = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(xs + i), dx), _mm_mul_ps(_mm_loadu_ps(ys + i), dy)),
+                _mm_mul_ps(_mm_loadu_ps(zs + i), dz)
+            );
+
+            // Strictly greater, so each lane keeps the first of any ties it sees
+            __m128 greater = _mm_cmpgt_ps(dots, bestDots);
+            bestDots = _mm_or_ps(_mm_and_ps(greater, dots), _mm_andnot_ps(greater, bestDots));
+            bestIndices = _mm_or_ps(_mm_and_ps(greater, indices), _mm_andnot_ps(greater, bestIndices));
+        }
+
+        float32 laneDots[4];
+        float32 laneIndices[4];
+        _mm_storeu_ps(laneDots, bestDots);
+        _mm_storeu_ps(laneIndices, bestIndices);
+
+        result = (uint32)laneIndices[0];
+        biggestDot = laneDots[0];
+
+        for (uint32 lane = 1; lane < 4; lane++)
+        {
+            uint32 laneIndex = (uint32)laneIndices[lane];
+
+            if (laneDots[lane] > biggestDot || (laneDots[lane] == biggestDot && laneIndex < result))
+            {
+                result = laneIndex;
+                biggestDot = laneDots[lane];
+            }
+        }
+    }
+#endif
+
+    for ( ; i < count; i++)
+    {
+        float32 dotp = xs[i] * direction.x + ys[i] * direction.y + zs[i] * direction.z;
+        if (dotp > biggestDot)
+        {
+            result = i;
+            biggestDot = dotp;
+        }
+    }
+
+    return result;
+}
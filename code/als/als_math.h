@@ -289,6 +289,19 @@ Mat3 inverse(Mat3 m);
 float32 determinant(Mat4 m);
 Mat4 inverse(Mat4 m);
 
+//
+// Builds out[i] = translation(positions[i]) * rotation(orientations[i]) * scale(scales[i]), which is the same matrix as
+// identityInPlace().scaleInPlace(..).rotateInPlace(..).translateInPlace(..), 4 at a time with SSE.
+// The inputs are packed, the outputs can be anywhere.
+//
+void composeTrsMatrices(const Vec3* positions, const Quaternion* orientations, const Vec3* scales, uint32 count, Mat4* const* out);
+
+//
+// Index of the point with the biggest dot product with direction, out of count points stored as separate x, y and z
+// arrays. Ties go to the lowest index. 4 at a time with SSE. count must be at least 1.
+//
+uint32 maxDotIndex(const float32* xs, const float32* ys, const float32* zs, uint32 count, Vec3 direction);
+
 // Vec2
 inline float32 dot(Vec2 vectorA, Vec2 vectorB)
 {
@@ -973,6 +986,29 @@ inline Vec3 barycentricCoordinate(Vec2 a, Vec2 b, Vec2 c, Vec2 point)
     return result;
 }
 
+inline Vec3 barycentricCoordinate(Vec3 a, Vec3 b, Vec3 c, Vec3 point)
+{
+    // Same as the Vec2 version. point is projected onto the triangle's plane.
+    Vec3 v0 = b - a;
+    Vec3 v1 = c - a;
+    Vec3 v2 = point - a;
+    
+    float32 d00 = dot(v0, v0);
+    float32 d01 = dot(v0, v1);
+    float32 d11 = dot(v1, v1);
+    float32 d20 = dot(v2, v0);
+    float32 d21 = dot(v2, v1);
+    float32 denom = d00 * d11 - d01 * d01;
+
+    Vec3 result;
+
+    result.y = (d11 * d20 - d01 * d21) / denom;
+    result.z = (d00 * d21 - d01 * d20) / denom;
+    result.x = 1.0f - result.y - result.z;
+
+    return result;
+}
+
 inline Vec3 triangleNormal(Triangle& triangle)
 {
     Vec3 ab = triangle.b - triangle.a;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+//
+// SSE is baseline on every x86/x64 target we build for. ALS_SSE is 0 anywhere else, and code that uses the intrinsics
+// keeps a scalar path for that case.
+//
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define ALS_SSE 1
+#include <xmmintrin.h>
+#else
+#define ALS_SSE 0
+#endif
+
+//
+// std::allocator only respects alignas(..) above 16 bytes from C++17 on, so containers of types aligned for wider loads
+// (or to cache lines) allocate with this instead.
+//
+template<class T, size_t ALIGNMENT = alignof(T)>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template<class U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, ALIGNMENT> other;
+    };
+
+    AlignedAllocator() = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+    T* allocate(size_t count)
+    {
+#if defined(_MSC_VER)
+        void* result = _aligned_malloc(count * sizeof(T), ALIGNMENT);
+#else
+        void* result = nullptr;
+        if (posix_memalign(&result, ALIGNMENT < sizeof(void*) ? sizeof(void*) : ALIGNMENT, count * sizeof(T)) != 0) result = nullptr;
+#endif
+        assert(result != nullptr);
+        return (T*)result;
+    }
+
+    void deallocate(T* memory, size_t)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        free(memory);
+#endif
+    }
+};
+
+template<class T, class U, size_t ALIGNMENT>
+bool operator == (const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&) { return true; }
+
+template<class T, class U, size_t ALIGNMENT>
+bool operator != (const AlignedAllocator<T, ALIGNMENT>&, const AlignedAllocator<U, ALIGNMENT>&) { return false; }
@@ -1,7 +1,42 @@
 #pragma once
 
+#include <assert.h>
+#include "als_types.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #define ARRAY_LEN(x) (sizeof((x)) / sizeof((x)[0]))
 
+//
+// Bit twiddling. Only 32-bit intrinsics are used on MSVC so that these also work in the x86 build.
+//
+inline uint32 popcount64(uint64 value)
+{
+#if defined(_MSC_VER)
+    return __popcnt((uint32)value) + __popcnt((uint32)(value >> 32));
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+// Note: value must be non-zero
+inline uint32 countTrailingZeros64(uint64 value)
+{
+    assert(value != 0);
+
+#if defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, (uint32)value)) return index;
+
+    _BitScanForward(&index, (uint32)(value >> 32));
+    return index + 32;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
 template<typename T>
 T min(T t1, T t2)
 {
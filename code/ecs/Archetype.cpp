@@ -0,0 +1,658 @@
+#include "Archetype.h"
+#include "Ecs.h"
+
+#include "als/als_util.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+
+//
+// Component type info
+//
+
+namespace
+{
+    template<class T>
+    ComponentTypeInfo makeComponentTypeInfo()
+    {
+        // Column values come straight from operator new
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Component type is over-aligned");
+
+        ComponentTypeInfo result;
+        result.size = sizeof(T);
+        result.multipleAllowedPerEntity = T::multipleAllowedPerEntity;
+
+        result.construct = [](void* at, Entity e)
+        {
+            T* constructed = new (at) T();
+            constructed->entity = e;
+        };
+
+        result.destroy = [](void* at)
+        {
+            ((T*)at)->~T();
+        };
+
+        result.relocate = [](void* to, void* from)
+        {
+            T* moved = new (to) T(std::move(*(T*)from));
+            ((T*)from)->~T();
+            moved->onMoveComponent();
+        };
+
+        result.component = [](void* at) -> IComponent*
+        {
+            return (T*)at;
+        };
+
+        return result;
+    }
+
+    struct ComponentTypeInfoTable
+    {
+        ComponentTypeInfo infos[(uint32)ComponentType::ENUM_VALUE_COUNT];
+
+        template<typename... Ts>
+        ComponentTypeInfoTable(EcsTypeList<Ts...>)
+        {
+            int expand[] = { 0, (this->infos[(uint32)ecsComponentType<Ts>()] = makeComponentTypeInfo<Ts>(), 0)... };
+            (void)expand;
+        }
+    };
+}
+
+const ComponentTypeInfo* componentTypeInfo(ComponentType type)
+{
+    static ComponentTypeInfoTable table = ComponentTypeInfoTable(EcsComponentTypes());
+
+    assert((uint32)type < (uint32)ComponentType::ENUM_VALUE_COUNT);
+    return &table.infos[(uint32)type];
+}
+
+//
+// Chunks
+//
+
+ArchetypeColumn::~ArchetypeColumn()
+{
+    // The values themselves are destroyed by whoever removes their rows
+    ::operator delete(this->values);
+}
+
+ArchetypeColumn* chunkColumn(ArchetypeChunk* chunk, ComponentType type)
+{
+    ComponentMask bit = componentBit(type);
+    if ((chunk->mask & bit) == 0) return nullptr;
+
+    // Columns are sorted by type, so the column index is the number of lower types present
+    uint32 columnIndex = popcount64(chunk->mask & (bit - 1));
+    return &chunk->columns[columnIndex];
+}
+
+namespace
+{
+    uint32 usedValueCount(ArchetypeChunk* chunk, ArchetypeColumn* column)
+    {
+        return column->info->multipleAllowedPerEntity ? column->rowStart[chunk->count] : chunk->count;
+    }
+
+    uint32 rowValueCount(ArchetypeColumn* column, uint32 row)
+    {
+        if (!column->info->multipleAllowedPerEntity) return 1;
+        return column->rowStart[row + 1] - column->rowStart[row];
+    }
+
+    uint32 rowFirstValue(ArchetypeColumn* column, uint32 row)
+    {
+        return column->info->multipleAllowedPerEntity ? column->rowStart[row] : row;
+    }
+
+    // Moves count values from one place in a column to another. The ranges can overlap, but any slot the destination
+    // covers outside of the source range must be empty.
+    void relocateValues(ArchetypeColumn* column, uint32 to, uint32 from, uint32 count)
+    {
+        if (to == from) return;
+
+        if (to < from)
+        {
+            for (uint32 i = 0; i < count; i++)
+            {
+                column->info->relocate(column->valueAt(to + i), column->valueAt(from + i));
+            }
+        }
+        else
+        {
+            for (uint32 i = count; i > 0; i--)
+            {
+                column->info->relocate(column->valueAt(to + i - 1), column->valueAt(from + i - 1));
+            }
+        }
+    }
+
+    // Multiple components only. Single component columns always have room for a full chunk.
+    void reserveColumn(ArchetypeChunk* chunk, ArchetypeColumn* column, uint32 capacity)
+    {
+        if (capacity <= column->capacity) return;
+
+        uint32 newCapacity = max(capacity, max(column->capacity * 2, (uint32)ARCHETYPE_CHUNK_CAPACITY));
+        uint8* newValues = (uint8*)::operator new(newCapacity * column->info->size);
+
+        uint32 used = usedValueCount(chunk, column);
+        for (uint32 i = 0; i < used; i++)
+        {
+            column->info->relocate(newValues + i * column->info->size, column->valueAt(i));
+        }
+
+        ::operator delete(column->values);
+        column->values = newValues;
+        column->capacity = newCapacity;
+    }
+
+    // Multiple components only. Default constructs count values at the end of the row's range.
+    void* insertValues(ArchetypeChunk* chunk, ArchetypeColumn* column, uint32 row, uint32 count)
+    {
+        assert(column->info->multipleAllowedPerEntity);
+        assert(row < chunk->count);
+
+        uint32 used = usedValueCount(chunk, column);
+        reserveColumn(chunk, column, used + count);
+
+        // Make room by moving the rows after it up
+        uint32 insertAt = column->rowStart[row + 1];
+        relocateValues(column, insertAt + count, insertAt, used - insertAt);
+
+        for (uint32 i = 0; i < count; i++)
+        {
+            column->info->construct(column->valueAt(insertAt + i), chunk->entities[row]);
+        }
+
+        for (uint32 r = row + 1; r <= chunk->count; r++)
+        {
+            column->rowStart[r] += count;
+        }
+
+        return column->valueAt(insertAt);
+    }
+
+    // Multiple components only. Destroys the index-th value of the row and moves everything after it down.
+    void eraseValue(ArchetypeChunk* chunk, ArchetypeColumn* column, uint32 row, uint32 index)
+    {
+        assert(column->info->multipleAllowedPerEntity);
+        assert(index < rowValueCount(column, row));
+
+        uint32 used = usedValueCount(chunk, column);
+        uint32 at = column->rowStart[row] + index;
+
+        column->info->destroy(column->valueAt(at));
+        relocateValues(column, at, at + 1, used - at - 1);
+
+        for (uint32 r = row + 1; r <= chunk->count; r++)
+        {
+            column->rowStart[r]--;
+        }
+    }
+
+    void destroyRowValues(ArchetypeColumn* column, uint32 row)
+    {
+        uint32 first = rowFirstValue(column, row);
+        uint32 count = rowValueCount(column, row);
+
+        for (uint32 i = 0; i < count; i++)
+        {
+            column->info->destroy(column->valueAt(first + i));
+        }
+    }
+
+    ArchetypeChunk* makeChunk(ComponentMask mask)
+    {
+        ArchetypeChunk* result = new ArchetypeChunk();
+        result->mask = mask;
+        result->columnCount = popcount64(mask);
+        result->columns = new ArchetypeColumn[result->columnCount];
+
+        uint32 columnIndex = 0;
+        for (uint32 type = 0; type < (uint32)ComponentType::ENUM_VALUE_COUNT; type++)
+        {
+            if ((mask & componentBit((ComponentType)type)) == 0) continue;
+
+            ArchetypeColumn* column = &result->columns[columnIndex];
+            column->type = (ComponentType)type;
+            column->info = componentTypeInfo((ComponentType)type);
+
+            if (column->info->multipleAllowedPerEntity)
+            {
+                // Allocated on first use, lots of archetypes never get more than a few of these
+                column->rowStart.reserve(ARCHETYPE_CHUNK_CAPACITY + 1);
+                column->rowStart.push_back(0);
+            }
+            else
+            {
+                column->capacity = ARCHETYPE_CHUNK_CAPACITY;
+                column->values = (uint8*)::operator new(ARCHETYPE_CHUNK_CAPACITY * column->info->size);
+            }
+
+            columnIndex++;
+        }
+
+        return result;
+    }
+
+    void deleteChunk(ArchetypeChunk* chunk)
+    {
+        delete[] chunk->columns;
+        delete chunk;
+    }
+
+    Archetype* findOrMakeArchetype(ArchetypeStorage* storage, ComponentMask mask)
+    {
+        auto found = storage->archetypeByMask.find(mask);
+        if (found != storage->archetypeByMask.end()) return found->second;
+
+        Archetype* result = new Archetype();
+        result->mask = mask;
+        storage->archetypes.push_back(result);
+        storage->archetypeByMask[mask] = result;
+
+        return result;
+    }
+
+    ArchetypeChunk* chunkWithSpace(Archetype* archetype)
+    {
+        // @Slow: Linear in the number of chunks, which is the number of entities / ARCHETYPE_CHUNK_CAPACITY at worst
+        for (ArchetypeChunk* chunk : archetype->chunks)
+        {
+            if (chunk->count < ARCHETYPE_CHUNK_CAPACITY) return chunk;
+        }
+
+        archetype->chunks.push_back(makeChunk(archetype->mask));
+        return archetype->chunks.back();
+    }
+
+    // Adds an empty row. The caller fills in the single component values, multiple components start out with none.
+    uint32 appendRow(ArchetypeStorage* storage, ArchetypeChunk* chunk, Entity e)
+    {
+        assert(chunk->count < ARCHETYPE_CHUNK_CAPACITY);
+
+        uint32 row = chunk->count;
+        chunk->entities[row] = e;
+        chunk->count++;
+
+        for (uint32 i = 0; i < chunk->columnCount; i++)
+        {
+            ArchetypeColumn* column = &chunk->columns[i];
+            if (column->info->multipleAllowedPerEntity) column->rowStart.push_back(column->rowStart.back());
+        }
+
+        uint32 index = entityIndex(e.id);
+        if (index >= storage->locations.size()) storage->locations.resize(index + 1);
+
+        EntityLocation* location = &storage->locations[index];
+        location->id = e.id;
+        location->chunk = chunk;
+        location->row = row;
+
+        return row;
+    }
+
+    void markEntityChanged(ArchetypeStorage* storage, uint32 entityId)
+    {
+        EntityLocation* location = &storage->locations[entityIndex(entityId)];
+        if (location->isInChangedEntities) return;
+
+        location->isInChangedEntities = true;
+        storage->changedEntities.push_back(entityIndex(entityId));
+    }
+
+    //
+    // Unordered remove of a row whose values have all been destroyed or moved out already. The chunk's last row moves
+    // into the hole.
+    //
+    void removeRow(ArchetypeStorage* storage, ArchetypeChunk* chunk, uint32 row)
+    {
+        uint32 last = chunk->count - 1;
+
+        for (uint32 i = 0; i < chunk->columnCount; i++)
+        {
+            ArchetypeColumn* column = &chunk->columns[i];
+
+            if (!column->info->multipleAllowedPerEntity)
+            {
+                if (row != last) column->info->relocate(column->valueAt(row), column->valueAt(last));
+                continue;
+            }
+
+            //
+            // The removed row leaves a gap of holeCount empty slots. The last row's values go at the start of it, and
+            // the rows in between move up or down by the difference.
+            //
+            uint32 holeStart = column->rowStart[row];
+            uint32 holeCount = rowValueCount(column, row);
+            uint32 used = column->rowStart[last + 1];
+
+            if (row != last)
+            {
+                uint32 lastStart = column->rowStart[last];
+                uint32 lastCount = rowValueCount(column, last);
+
+                // Park the last row's values while the ones in between move. There are never more than
+                // MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY of them.
+                uint8* parked = (uint8*)::operator new(lastCount * column->info->size);
+                for (uint32 j = 0; j < lastCount; j++)
+                {
+                    column->info->relocate(parked + j * column->info->size, column->valueAt(lastStart + j));
+                }
+
+                uint32 betweenStart = column->rowStart[row + 1];
+                relocateValues(column, holeStart + lastCount, betweenStart, lastStart - betweenStart);
+
+                for (uint32 j = 0; j < lastCount; j++)
+                {
+                    column->info->relocate(column->valueAt(holeStart + j), parked + j * column->info->size);
+                }
+
+                ::operator delete(parked);
+
+                for (uint32 r = row + 1; r < last; r++)
+                {
+                    column->rowStart[r] = column->rowStart[r] + lastCount - holeCount;
+                }
+            }
+
+            column->rowStart.pop_back();
+            column->rowStart[last] = used - holeCount;
+        }
+
+        if (row != last)
+        {
+            chunk->entities[row] = chunk->entities[last];
+            storage->locations[entityIndex(chunk->entities[row].id)].row = row;
+        }
+
+        chunk->count--;
+    }
+
+    //
+    // Moves the entity's row to the archetype for newMask. Values of types that aren't in newMask are destroyed. Single
+    // components that are new to it are left empty for the caller to construct, multiple components start with none.
+    //
+    void changeArchetype(ArchetypeStorage* storage, Entity e, ComponentMask newMask)
+    {
+        EntityLocation* location = entityLocation(storage, e.id);
+        assert(location != nullptr);
+
+        ArchetypeChunk* from = location->chunk;
+        uint32 fromRow = location->row;
+
+        ArchetypeChunk* to = chunkWithSpace(findOrMakeArchetype(storage, newMask));
+        assert(to != from);
+
+        uint32 toRow = appendRow(storage, to, e);
+
+        for (uint32 i = 0; i < from->columnCount; i++)
+        {
+            ArchetypeColumn* fromColumn = &from->columns[i];
+            ArchetypeColumn* toColumn = chunkColumn(to, fromColumn->type);
+
+            if (toColumn == nullptr)
+            {
+                destroyRowValues(fromColumn, fromRow);
+                continue;
+            }
+
+            uint32 first = rowFirstValue(fromColumn, fromRow);
+
+            if (fromColumn->info->multipleAllowedPerEntity)
+            {
+                // The new row is the last one in its chunk, so its values go at the very end
+                uint32 count = rowValueCount(fromColumn, fromRow);
+                uint32 toFirst = toColumn->rowStart[toRow];
+                reserveColumn(to, toColumn, toFirst + count);
+
+                for (uint32 j = 0; j < count; j++)
+                {
+                    fromColumn->info->relocate(toColumn->valueAt(toFirst + j), fromColumn->valueAt(first + j));
+                }
+
+                toColumn->rowStart[toRow + 1] += count;
+            }
+            else
+            {
+                fromColumn->info->relocate(toColumn->valueAt(toRow), fromColumn->valueAt(first));
+            }
+        }
+
+        // appendRow(..) may have grown the location array
+        removeRow(storage, from, fromRow);
+
+        location = &storage->locations[entityIndex(e.id)];
+        location->chunk = to;
+        location->row = toRow;
+    }
+}
+
+ArchetypeStorage::~ArchetypeStorage()
+{
+    for (Archetype* archetype : this->archetypes)
+    {
+        for (ArchetypeChunk* chunk : archetype->chunks)
+        {
+            for (uint32 i = 0; i < chunk->columnCount; i++)
+            {
+                ArchetypeColumn* column = &chunk->columns[i];
+
+                uint32 used = usedValueCount(chunk, column);
+                for (uint32 j = 0; j < used; j++)
+                {
+                    column->info->destroy(column->valueAt(j));
+                }
+            }
+
+            deleteChunk(chunk);
+        }
+
+        delete archetype;
+    }
+}
+
+void addArchetypeEntity(ArchetypeStorage* storage, Entity e, ComponentMask mask)
+{
+    assert(entityLocation(storage, e.id) == nullptr);
+
+    ArchetypeChunk* chunk = chunkWithSpace(findOrMakeArchetype(storage, mask));
+    uint32 row = appendRow(storage, chunk, e);
+
+    for (uint32 i = 0; i < chunk->columnCount; i++)
+    {
+        ArchetypeColumn* column = &chunk->columns[i];
+
+        if (column->info->multipleAllowedPerEntity)
+        {
+            insertValues(chunk, column, row, 1);
+        }
+        else
+        {
+            column->info->construct(column->valueAt(row), e);
+        }
+    }
+
+    markEntityChanged(storage, e.id);
+}
+
+void* addArchetypeComponents(ArchetypeStorage* storage, Entity e, ComponentType type, uint32 count)
+{
+    EntityLocation* location = entityLocation(storage, e.id);
+    assert(location != nullptr); // Entities are made with makeEntity(..), which gives them their mandatory components
+
+    void* result;
+    ComponentMask bit = componentBit(type);
+    ComponentMask mask = location->chunk->mask;
+
+    if (mask & bit)
+    {
+        // Already has some, so its archetype doesn't change
+        ArchetypeColumn* column = chunkColumn(location->chunk, type);
+        assert(column->info->multipleAllowedPerEntity);
+
+        result = insertValues(location->chunk, column, location->row, count);
+    }
+    else
+    {
+        changeArchetype(storage, e, mask | bit);
+
+        location = entityLocation(storage, e.id);
+        ArchetypeColumn* column = chunkColumn(location->chunk, type);
+
+        if (column->info->multipleAllowedPerEntity)
+        {
+            result = insertValues(location->chunk, column, location->row, count);
+        }
+        else
+        {
+            assert(count == 1);
+
+            result = column->valueAt(location->row);
+            column->info->construct(result, e);
+        }
+    }
+
+    markEntityChanged(storage, e.id);
+    return result;
+}
+
+void removeArchetypeComponent(ArchetypeStorage* storage, Entity e, ComponentType type, uint32 index)
+{
+    EntityLocation* location = entityLocation(storage, e.id);
+    assert(location != nullptr);
+
+    ArchetypeColumn* column = chunkColumn(location->chunk, type);
+    assert(column != nullptr);
+
+    if (rowValueCount(column, location->row) > 1)
+    {
+        eraseValue(location->chunk, column, location->row, index);
+    }
+    else
+    {
+        assert(index == 0);
+
+        // Last one of its type, so it leaves the archetype
+        changeArchetype(storage, e, location->chunk->mask & ~componentBit(type));
+    }
+
+    markEntityChanged(storage, e.id);
+}
+
+void onRemoveArchetypeEntity(ArchetypeStorage* storage, uint32 entityId)
+{
+    EntityLocation* location = entityLocation(storage, entityId);
+    assert(location != nullptr);
+
+    ArchetypeChunk* chunk = location->chunk;
+
+    for (uint32 i = 0; i < chunk->columnCount; i++)
+    {
+        ArchetypeColumn* column = &chunk->columns[i];
+        uint32 first = rowFirstValue(column, location->row);
+
+        for (uint32 j = 0; j < rowValueCount(column, location->row); j++)
+        {
+            column->info->component(column->valueAt(first + j))->onRemoveComponent();
+        }
+    }
+}
+
+void removeArchetypeEntities(ArchetypeStorage* storage, const uint32* entityIds, uint32 count)
+{
+    std::vector<EntityLocation> dying;
+    dying.reserve(count);
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        EntityLocation* location = entityLocation(storage, entityIds[i]);
+        assert(location != nullptr);
+
+        dying.push_back(*location);
+
+        location->id = 0;
+        location->chunk = nullptr;
+        markEntityChanged(storage, entityIds[i]);
+    }
+
+    std::sort(dying.begin(), dying.end(), [](const EntityLocation& a, const EntityLocation& b)
+    {
+        return (a.chunk != b.chunk) ? std::less<ArchetypeChunk*>()(a.chunk, b.chunk) : a.row < b.row;
+    });
+
+    uint32 i = 0;
+    while (i < dying.size())
+    {
+        ArchetypeChunk* chunk = dying[i].chunk;
+
+        bool isDead[ARCHETYPE_CHUNK_CAPACITY] = {};
+        for ( ; i < dying.size() && dying[i].chunk == chunk; i++)
+        {
+            isDead[dying[i].row] = true;
+
+            for (uint32 c = 0; c < chunk->columnCount; c++)
+            {
+                destroyRowValues(&chunk->columns[c], dying[i].row);
+            }
+        }
+
+        //
+        // Slide the survivors down over the holes, keeping their order. Every slot a value lands in is either a
+        // destroyed one or one that an earlier survivor already moved out of.
+        //
+        for (uint32 c = 0; c < chunk->columnCount; c++)
+        {
+            ArchetypeColumn* column = &chunk->columns[c];
+
+            if (!column->info->multipleAllowedPerEntity)
+            {
+                uint32 to = 0;
+                for (uint32 row = 0; row < chunk->count; row++)
+                {
+                    if (isDead[row]) continue;
+                    relocateValues(column, to, row, 1);
+                    to++;
+                }
+
+                continue;
+            }
+
+            uint32 to = 0;
+            uint32 toRow = 0;
+            for (uint32 row = 0; row < chunk->count; row++)
+            {
+                if (isDead[row]) continue;
+
+                uint32 first = column->rowStart[row];
+                uint32 valueCount = rowValueCount(column, row);
+
+                relocateValues(column, to, first, valueCount);
+
+                column->rowStart[toRow] = to;
+                to += valueCount;
+                toRow++;
+            }
+
+            column->rowStart[toRow] = to;
+            column->rowStart.resize(toRow + 1);
+        }
+
+        uint32 toRow = 0;
+        for (uint32 row = 0; row < chunk->count; row++)
+        {
+            if (isDead[row]) continue;
+
+            chunk->entities[toRow] = chunk->entities[row];
+            storage->locations[entityIndex(chunk->entities[toRow].id)].row = toRow;
+            toRow++;
+        }
+
+        chunk->count = toRow;
+    }
+}
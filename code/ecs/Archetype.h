@@ -0,0 +1,211 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "Entity.h"
+
+#include <vector>
+#include <unordered_map>
+
+struct Ecs;
+struct IComponent;
+
+//
+// Archetype storage groups the entities of an ECS by the exact set of component types they have, and owns their
+// components. Each archetype stores its entities in fixed-size chunks, with one column per component type that holds
+// the component values themselves, in row order. Systems that need several components of the same entity (e.g.,
+// render component + transform) walk the chunks linearly instead of doing a lookup per component.
+//
+// Adding or removing a component moves just that entity's row to the chunk of its new archetype, and the last row of
+// its old chunk moves into the hole. Nothing else is touched.
+//
+// Note: Components move whenever their entity's archetype changes, or another entity's row moves into the hole left by
+//       one that did. A component pointer is only good until the next add/remove of a component on ANY entity in that
+//       ECS. Hold on to the Entity instead. Anything that has to hold pointers anyway (the transform hierarchy,
+//       broadphase proxies, the entity directory) fixes them up in the component's onMoveComponent().
+//
+
+// Note: Keep in sync with the EcsComponentTypes list in Ecs.h
+enum class ComponentType : uint32
+{
+    EntityDetails,
+    Transform,
+    Camera,
+    DirectionalLight,
+    Terrain,
+    PointLight,
+    Render,
+    Portal,
+    Collider,
+    ConvexHullCollider,
+    Agent,
+    Walk,
+
+    ENUM_VALUE_COUNT
+};
+
+typedef uint32 ComponentMask;
+
+static_assert((uint32)ComponentType::ENUM_VALUE_COUNT <= sizeof(ComponentMask) * 8, "ComponentMask too small");
+
+inline ComponentMask componentBit(ComponentType type)
+{
+    return 1u << (uint32)type;
+}
+
+#define ARCHETYPE_CHUNK_CAPACITY 128
+
+//
+// What the storage needs to know to move values of a component type around without knowing the type
+//
+struct ComponentTypeInfo
+{
+    uint32 size;
+    bool multipleAllowedPerEntity;
+
+    void (*construct)(void* at, Entity e);  // Default constructs one value owned by e
+    void (*destroy)(void* at);
+    // Move constructs a value at to out of the one at from, destroys that one and calls onMoveComponent() on the new one
+    void (*relocate)(void* to, void* from);
+    IComponent* (*component)(void* at);     // The value as an IComponent, since that isn't always the first base
+};
+
+const ComponentTypeInfo* componentTypeInfo(ComponentType type);
+
+struct ArchetypeColumn
+{
+    ArchetypeColumn() = default;
+    ArchetypeColumn(const ArchetypeColumn&) = delete;
+    ArchetypeColumn& operator=(const ArchetypeColumn&) = delete;
+    ~ArchetypeColumn();
+
+    ComponentType type;
+    const ComponentTypeInfo* info;
+
+    // Single components have exactly one value per row, row i is value i.
+    // Multiple components are packed in row order, and row i owns [rowStart[i], rowStart[i + 1])
+    uint8* values = nullptr;
+    uint32 capacity = 0; // In values
+    std::vector<uint32> rowStart;
+
+    inline void* valueAt(uint32 index) { return this->values + index * this->info->size; }
+};
+
+struct ArchetypeChunk
+{
+    ComponentMask mask;
+    uint32 count = 0;
+    Entity entities[ARCHETYPE_CHUNK_CAPACITY];
+
+    // Sorted by ComponentType, one for each bit set in the mask. Allocated once, along with the chunk.
+    ArchetypeColumn* columns = nullptr;
+    uint32 columnCount = 0;
+};
+
+struct Archetype
+{
+    ComponentMask mask;
+
+    // Chunks are kept when they empty out, and reused by whatever joins the archetype next
+    std::vector<ArchetypeChunk*> chunks;
+};
+
+// Where an entity's components live. Only valid until the next add/remove on that ECS, like component pointers.
+struct EntityLocation
+{
+    uint32 id = 0; // Full id (index + generation), so a stale id whose index was recycled doesn't find the new entity
+    ArchetypeChunk* chunk = nullptr;
+    uint32 row = 0;
+
+    bool isInChangedEntities = false; // Kept when the index is recycled, like its place in changedEntities
+};
+
+struct ArchetypeStorage
+{
+    ArchetypeStorage() = default;
+    ArchetypeStorage(const ArchetypeStorage&) = delete;
+    ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+    ~ArchetypeStorage();
+
+    std::vector<Archetype*> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> archetypeByMask;
+
+    // Indexed by entity index
+    std::vector<EntityLocation> locations;
+
+    //
+    // Indices of the entities that were added or removed, or gained or lost components, since the last
+    // takeChangedEntities(..). For caches of which entities have which components. Each index is in here at most once,
+    // so it doesn't grow if nothing takes them.
+    //
+    std::vector<uint32> changedEntities;
+};
+
+struct ArchetypeQuery
+{
+    ComponentMask all = 0;   // Archetype must have all of these...
+    ComponentMask any = 0;   // ... and at least one of these (ignored if 0) ...
+    ComponentMask none = 0;  // ... and none of these
+};
+
+inline bool archetypeMatches(ComponentMask mask, ArchetypeQuery query)
+{
+    if ((mask & query.all) != query.all) return false;
+    if (query.any != 0 && (mask & query.any) == 0) return false;
+    if ((mask & query.none) != 0) return false;
+    return true;
+}
+
+// Returns nullptr if the chunk's archetype doesn't have the component type
+ArchetypeColumn* chunkColumn(ArchetypeChunk* chunk, ComponentType type);
+
+// Returns nullptr if the entity isn't in this storage
+inline EntityLocation* entityLocation(ArchetypeStorage* storage, uint32 entityId)
+{
+    uint32 index = entityIndex(entityId);
+    if (index >= storage->locations.size()) return nullptr;
+
+    EntityLocation* result = &storage->locations[index];
+    if (result->id != entityId || result->chunk == nullptr) return nullptr;
+
+    return result;
+}
+
+//
+// Structural changes. Everything added is default constructed. Removing doesn't call onRemoveComponent(), the caller
+// does that first.
+//
+
+// Adds a new entity with one component of each type in the mask
+void addArchetypeEntity(ArchetypeStorage* storage, Entity e, ComponentMask mask);
+
+// Adds count components of the given type to the entity, after any it already has. Returns the first of them.
+void* addArchetypeComponents(ArchetypeStorage* storage, Entity e, ComponentType type, uint32 count);
+
+// Removes the index-th component of the given type from the entity. The ones after it move down.
+void removeArchetypeComponent(ArchetypeStorage* storage, Entity e, ComponentType type, uint32 index);
+
+// Calls onRemoveComponent() on every component of the entity, for callers of removeArchetypeEntities(..)
+void onRemoveArchetypeEntity(ArchetypeStorage* storage, uint32 entityId);
+
+//
+// Destroys all of the entities' components. They're grouped by chunk, and each chunk is compacted once after all of its
+// rows are gone, instead of filling each hole as it's made (which shifts every row after it in columns of multiple
+// components).
+//
+void removeArchetypeEntities(ArchetypeStorage* storage, const uint32* entityIds, uint32 count);
+
+//
+// Calls fn(uint32 entityIndex) for each entity in changedEntities and clears it. locations[entityIndex] is whatever is
+// at that index now, which might be nothing, or a different entity than the one that changed if the index was recycled.
+//
+template<class FN>
+void takeChangedEntities(ArchetypeStorage* storage, FN fn)
+{
+    for (uint32 index : storage->changedEntities)
+    {
+        storage->locations[index].isInChangedEntities = false;
+        fn(index);
+    }
+
+    storage->changedEntities.clear();
+}
@@ -1,27 +1,20 @@
 #pragma once
 
 #include "Entity.h"
-#include "als/als_bucket_array.h"
 
-template <class T, uint32 BUCKET_SIZE>
+// All of an entity's components of one type. They sit next to each other in the entity's archetype chunk.
+// Note: Like any component pointer, only valid until the next add/remove. See Archetype.h
+template <class T>
 struct ComponentGroup
 {
-    ComponentGroup()
-    {
-        entity.id = 0;
-        numComponents = 0;
-        bucketArray = nullptr;
-    }
-
     T& operator [] (uint32 index)
     {
-        return *(bucketArray->addressOf(this->components[index]));
+        return this->components[index];
     }
 
     PotentiallyStaleEntity entity;
 
-    BucketArray<T, BUCKET_SIZE>* bucketArray;
-    BucketLocator components[MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY];
+    T* components = nullptr;
     uint32 numComponents = 0;
 };
 
@@ -12,6 +12,9 @@
 
 #include "Game.h"
 #include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
 
 #include "imgui/imgui.h"
 
@@ -30,71 +33,128 @@
 #include "components/AgentComponent.h"
 #include "components/WalkComponent.h"
 
-// ID 0 is a null entity
-uint32 Ecs::nextEntityId = 1;
+//
+// Entity id allocation and directory
+//
 
-Entity makeEntity(Ecs* ecs, string16 friendlyName, EntityFlags flags)
+// Freed indices aren't reused until there are at least this many of them. Otherwise, an index that gets deleted and
+// re-created every frame would burn through its 8 bits of generation almost immediately.
+#define MINIMUM_FREE_ENTITY_INDICES 1024
+
+// The directory is allocated a page at a time and pages never move, so lookups from other threads don't race with
+// allocations growing it
+#define ENTITY_DIRECTORY_PAGE_SIZE 4096
+#define ENTITY_DIRECTORY_PAGE_COUNT ((ENTITY_INDEX_MASK + 1) / ENTITY_DIRECTORY_PAGE_SIZE)
+
+namespace
 {
-    Entity result;
-    result.id = Ecs::nextEntityId;
-    result.ecs = ecs;
+    std::atomic<EntityDirectoryEntry*> entityDirectoryPages[ENTITY_DIRECTORY_PAGE_COUNT];
 
-    ecs->entities.push_back(result);
+    // Index 0 is reserved so that id 0 is always the null entity
+    uint32 nextUnusedEntityIndex = 1;
+    std::deque<uint32> freeEntityIndices;
 
-    EntityDetails* details = addComponent<EntityDetails>(result);
-    assert(details != nullptr);
-    
-    details->entity.id = result.id;
-    details->entity.ecs = result.ecs;
-    details->flags = flags;
-    details->parent.id = 0;
-    details->friendlyName = friendlyName;
+    // Command buffers reserve ids from whatever thread they are recorded on
+    std::mutex entityIdMutex;
 
-    TransformComponent* xfm = addComponent<TransformComponent>(result);
-    assert(xfm != nullptr);
-    
-    xfm->entity.id = result.id;
-    xfm->entity.ecs = result.ecs;
-    
-    Ecs::nextEntityId++;
-    return result;
+    EntityDirectoryEntry* directoryEntry(uint32 index)
+    {
+        EntityDirectoryEntry* page = entityDirectoryPages[index / ENTITY_DIRECTORY_PAGE_SIZE].load(std::memory_order_acquire);
+        if (page == nullptr) return nullptr;
+
+        return &page[index % ENTITY_DIRECTORY_PAGE_SIZE];
+    }
 }
 
-bool markEntityForDeletion(Entity e)
+uint32 allocateEntityId()
 {
-    EntityDetails* details = getComponent<EntityDetails>(e);
-    if (details == nullptr)
+    std::lock_guard<std::mutex> lock(entityIdMutex);
+
+    uint32 index;
+
+    if (freeEntityIndices.size() > MINIMUM_FREE_ENTITY_INDICES)
     {
-        assert(false);
-        return false;
+        index = freeEntityIndices.front();
+        freeEntityIndices.pop_front();
     }
+    else
+    {
+        index = nextUnusedEntityIndex;
+        nextUnusedEntityIndex++;
 
-    details->flags |= EntityFlag_MarkedForDeletion;
-
-    Game* game = getGame(e);
-    PotentiallyStaleEntity toDelete = PotentiallyStaleEntity(e);
-    game->entitiesMarkedForDeletion.push_back(toDelete);
+        assert(index <= ENTITY_INDEX_MASK);
 
-    for (PotentiallyStaleEntity child : *getChildren(e))
-    {
-        bool childDelete = markEntityForDeletion(getEntity(game, &child));
-        assert(childDelete);
+        uint32 pageIndex = index / ENTITY_DIRECTORY_PAGE_SIZE;
+        if (entityDirectoryPages[pageIndex].load(std::memory_order_relaxed) == nullptr)
+        {
+            entityDirectoryPages[pageIndex].store(new EntityDirectoryEntry[ENTITY_DIRECTORY_PAGE_SIZE], std::memory_order_release);
+        }
     }
-    
-    return true;
+
+    return makeEntityId(index, directoryEntry(index)->generation);
+}
+
+void releaseEntityId(uint32 id)
+{
+    std::lock_guard<std::mutex> lock(entityIdMutex);
+
+    uint32 index = entityIndex(id);
+    assert(index != 0 && index < nextUnusedEntityIndex);
+
+    EntityDirectoryEntry* entry = directoryEntry(index);
+    assert(entry->generation == entityGeneration(id));
+
+    entry->generation++;
+    entry->ecs = nullptr;
+    entry->details = nullptr;
+
+    freeEntityIndices.push_back(index);
+}
+
+void setEntityOwner(uint32 id, Ecs* ecs, EntityDetails* details)
+{
+    EntityDirectoryEntry* entry = directoryEntry(entityIndex(id));
+    assert(entry && entry->generation == entityGeneration(id));
+
+    entry->ecs = ecs;
+    entry->details = details;
+}
+
+const EntityDirectoryEntry* lookupEntity(uint32 id)
+{
+    uint32 index = entityIndex(id);
+    if (index == 0) return nullptr;
+
+    EntityDirectoryEntry* entry = directoryEntry(index);
+    if (entry == nullptr || entry->ecs == nullptr || entry->generation != entityGeneration(id)) return nullptr;
+
+    return entry;
+}
+
+Entity makeEntity(Ecs* ecs, string16 friendlyName, EntityFlags flags)
+{
+    return makeEntityWithId(ecs, allocateEntityId(), friendlyName, flags);
 }
 
-Ecs::Ecs()
+Entity makeEntityWithId(Ecs* ecs, uint32 id, string16 friendlyName, EntityFlags flags)
 {
-    componentListByType[typeid(EntityDetails)] = &entityDetails;
-    componentListByType[typeid(TransformComponent)] = &transforms;
-    componentListByType[typeid(CameraComponent)] = &cameras;
-    componentListByType[typeid(DirectionalLightComponent)] = &directionalLights;
-    componentListByType[typeid(PointLightComponent)] = &pointLights;
-    componentListByType[typeid(RenderComponent)] = &renderComponents;
-    componentListByType[typeid(PortalComponent)] = &portals;
-    componentListByType[typeid(ColliderComponent)] = &colliders;
-    componentListByType[typeid(ConvexHullColliderComponent)] = &convexHullColliders;
-    componentListByType[typeid(AgentComponent)] = &agentComponents;
-    componentListByType[typeid(WalkComponent)] = &walkComponents;
+    Entity result;
+    result.id = id;
+    result.ecs = ecs;
+
+    ecs->entities.push_back(result);
+
+    // Both mandatory components in one go, rather than moving the entity to a new archetype for the second one
+    markTransformHierarchyDirty(ecs);
+    addArchetypeEntity(&ecs->archetypes, result, componentBit(ComponentType::EntityDetails) | componentBit(ComponentType::Transform));
+
+    EntityDetails* details = getComponent<EntityDetails>(result);
+    assert(details != nullptr);
+
+    details->flags = flags;
+    details->friendlyName = friendlyName;
+
+    setEntityOwner(result.id, ecs, details);
+    
+    return result;
 }
@@ -1,12 +1,17 @@
 #pragma once
 
-#include "als/als_bucket_array.h"
 #include "Entity.h"
 #include "ecs/components/EntityDetails.h"
 #include "Ray.h"
 #include "ComponentGroup.h"
+#include "Archetype.h"
+#include "TransformHierarchy.h"
+#include "AabbTree.h"
+#include "SweepAndPrune.h"
+#include "StaticCollisionWorld.h"
+#include "Gjk.h"
+#include "ContactManifold.h"
 
-#include <typeindex>
 #include <unordered_map>
 #include <vector>
 
@@ -27,143 +32,192 @@ struct ITransform;
 struct Scene;
 struct Game;
 
+enum class Broadphase : uint8
+{
+    AabbTree,       // General purpose
+    SweepAndPrune   // Mostly static levels with a few things moving around
+};
+
 struct Ecs
 {
-    template<class T, uint32 BUCKET_SIZE>
-    struct ComponentList
-    {
-        BucketArray<T, BUCKET_SIZE> components;
-        std::unordered_map<uint32, ComponentGroup<T, BUCKET_SIZE>> lookup;
+    Scene* scene = nullptr; // nullptr for ECSs that aren't a scene's (the editor's pseudo ECS)
+    Game* game = nullptr;
+
+    std::vector<Entity> entities;
+
+    // Every component of every entity, grouped by component set. See Archetype.h
+    ArchetypeStorage archetypes;
+
+    // Parent/child relationships flattened for transform propagation. Rebuilt after any reparenting or transform add/remove.
+    TransformHierarchy transformHierarchy;
+
+    // Broadphase for colliders and convex hull colliders. Only the one selected by broadphase is used. Kept in sync by
+    // updateBroadphase(..), change it with setBroadphase(..).
+    Broadphase broadphase = Broadphase::AabbTree;
+    DynamicAabbTree colliderTree;
+    SweepAndPrune colliderSap;
+
+    // Colliders of static entities, once the level has been baked. Rebaked by updateBroadphase(..) when marked dirty.
+    StaticCollisionWorld staticCollisionWorld;
+
+    // Where each pair's last GJK test ended. Aged once a frame by updateBroadphase(..).
+    GjkPairCache gjkCache;
 
-        uint32 count() { return components.count; }
+    // Contact manifolds of the pairs that collided recently. Aged once a frame by updateBroadphase(..).
+    ContactManifoldCache contactManifolds;
+};
 
-        T& operator [] (uint32 index)
+//
+// Component registry
+//
+// Maps each component type to its ComponentType at compile time. Using a component type that isn't registered here is
+// a compile error.
+//
+template<typename T>
+struct EcsRegistry
+{
+    static_assert(sizeof(T) == 0, "Component type is not registered with the ECS. Add an ECS_REGISTER_COMPONENT for it.");
+};
+
+#define ECS_REGISTER_COMPONENT(TYPE, COMPONENT_TYPE) \
+    template<> \
+    struct EcsRegistry<TYPE> \
+    { \
+        static constexpr ComponentType componentType = COMPONENT_TYPE; \
+    }
+
+ECS_REGISTER_COMPONENT(EntityDetails,               ComponentType::EntityDetails);
+ECS_REGISTER_COMPONENT(TransformComponent,          ComponentType::Transform);
+ECS_REGISTER_COMPONENT(CameraComponent,             ComponentType::Camera);
+ECS_REGISTER_COMPONENT(DirectionalLightComponent,   ComponentType::DirectionalLight);
+ECS_REGISTER_COMPONENT(TerrainComponent,            ComponentType::Terrain);
+ECS_REGISTER_COMPONENT(PointLightComponent,         ComponentType::PointLight);
+ECS_REGISTER_COMPONENT(RenderComponent,             ComponentType::Render);
+ECS_REGISTER_COMPONENT(PortalComponent,             ComponentType::Portal);
+ECS_REGISTER_COMPONENT(ColliderComponent,           ComponentType::Collider);
+ECS_REGISTER_COMPONENT(ConvexHullColliderComponent, ComponentType::ConvexHullCollider);
+ECS_REGISTER_COMPONENT(AgentComponent,              ComponentType::Agent);
+ECS_REGISTER_COMPONENT(WalkComponent,               ComponentType::Walk);
+
+#undef ECS_REGISTER_COMPONENT
+
+// Every registered component type, in ComponentType order
+template<typename... Ts> struct EcsTypeList {};
+
+typedef EcsTypeList<
+    EntityDetails,
+    TransformComponent,
+    CameraComponent,
+    DirectionalLightComponent,
+    TerrainComponent,
+    PointLightComponent,
+    RenderComponent,
+    PortalComponent,
+    ColliderComponent,
+    ConvexHullColliderComponent,
+    AgentComponent,
+    WalkComponent> EcsComponentTypes;
+
+template<typename T>
+constexpr ComponentType ecsComponentType()
+{
+    return EcsRegistry<T>::componentType;
+}
+
+//
+// Archetype iteration
+//
+
+// Calls fn(ArchetypeChunk*) for each non-empty chunk whose archetype matches the query
+template<class FN>
+void forEachArchetypeChunk(Ecs* ecs, ArchetypeQuery query, FN fn)
+{
+    for (Archetype* archetype : ecs->archetypes.archetypes)
+    {
+        if (!archetypeMatches(archetype->mask, query)) continue;
+
+        for (ArchetypeChunk* chunk : archetype->chunks)
         {
-            return *(components.at(index));
+            if (chunk->count > 0) fn(chunk);
         }
-    };
-
-    Ecs();
-    
-    static uint32 nextEntityId;
-
-    static constexpr uint32 ENTITY_DETAILS_BUCKET_SIZE = 512;
-    static constexpr uint32 TRANSFORM_BUCKET_SIZE = 512;
-    static constexpr uint32 CAMERA_BUCKET_SIZE = 4;
-    static constexpr uint32 DIRECTIONAL_LIGHT_BUCKET_SIZE = 16;
-    static constexpr uint32 TERRAIN_BUCKET_SIZE = 8;
-    static constexpr uint32 POINT_LIGHT_BUCKET_SIZE = 32;
-    static constexpr uint32 RENDER_COMPONENT_BUCKET_SIZE = 512;
-    static constexpr uint32 PORTAL_BUCKET_SIZE = 16;
-    static constexpr uint32 CONVEX_HULL_COLLIDER_BUCKET_SIZE = 512;
-    static constexpr uint32 COLLIDER_BUCKET_SIZE = 512;
-    static constexpr uint32 AGENT_BUCKET_SIZE = 512;
-    static constexpr uint32 WALK_COMPONENT_BUCKET_SIZE = 8;
-
-    // Compile-time lookup for a specific component's bucket size
-    template<typename T> static constexpr uint32 ecsBucketSize() { return T::UNIMPLEMENTED_FUNCTION; } // only the specialized templates should be called
-    template<> static constexpr uint32 ecsBucketSize<EntityDetails>()      { return Ecs::ENTITY_DETAILS_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<TransformComponent>() { return Ecs::TRANSFORM_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<CameraComponent>()    { return Ecs::CAMERA_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<DirectionalLightComponent>() { return Ecs::DIRECTIONAL_LIGHT_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<TerrainComponent>()   { return Ecs::TERRAIN_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<PointLightComponent>() { return Ecs::POINT_LIGHT_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<RenderComponent>()    { return Ecs::RENDER_COMPONENT_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<PortalComponent>()    { return Ecs::PORTAL_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<ConvexHullColliderComponent>() { return Ecs::CONVEX_HULL_COLLIDER_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<ColliderComponent>()  { return Ecs::COLLIDER_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<AgentComponent>()     { return Ecs::AGENT_BUCKET_SIZE; }
-    template<> static constexpr uint32 ecsBucketSize<WalkComponent>()      { return Ecs::WALK_COMPONENT_BUCKET_SIZE; }
-
-    Scene* scene;
-    Game* game;
+    }
+}
 
-    std::vector<Entity> entities;
-    ComponentList<EntityDetails,               ENTITY_DETAILS_BUCKET_SIZE>         entityDetails;
-    ComponentList<TransformComponent,          TRANSFORM_BUCKET_SIZE>              transforms;
-    ComponentList<CameraComponent,             CAMERA_BUCKET_SIZE>                 cameras;
-    ComponentList<DirectionalLightComponent,   DIRECTIONAL_LIGHT_BUCKET_SIZE>      directionalLights;
-    ComponentList<TerrainComponent,            TERRAIN_BUCKET_SIZE>                terrains;
-    ComponentList<PointLightComponent,         POINT_LIGHT_BUCKET_SIZE>            pointLights;
-    ComponentList<RenderComponent,             RENDER_COMPONENT_BUCKET_SIZE>       renderComponents;
-    ComponentList<PortalComponent,             PORTAL_BUCKET_SIZE>                 portals;
-    ComponentList<ColliderComponent,           COLLIDER_BUCKET_SIZE>               colliders;
-    ComponentList<ConvexHullColliderComponent, CONVEX_HULL_COLLIDER_BUCKET_SIZE>   convexHullColliders;
-    ComponentList<AgentComponent,              AGENT_BUCKET_SIZE>                  agentComponents;
-    ComponentList<WalkComponent,               WALK_COMPONENT_BUCKET_SIZE>         walkComponents;
-
-    std::unordered_map<std::type_index, void*> componentListByType;
-};
+template<class T>
+bool chunkHas(ArchetypeChunk* chunk)
+{
+    return (chunk->mask & componentBit(ecsComponentType<T>())) != 0;
+}
 
 template<class T>
-T* addComponent(Entity e)
+uint32 chunkComponentCount(ArchetypeChunk* chunk, uint32 row)
 {
-    if (e.id == 0) return nullptr;
+    ArchetypeColumn* column = chunkColumn(chunk, ecsComponentType<T>());
+    if (column == nullptr) return 0;
+    if (!T::multipleAllowedPerEntity) return 1;
+
+    return column->rowStart[row + 1] - column->rowStart[row];
+}
+
+// Returns the index-th component of type T owned by the entity in the given row, or nullptr if the chunk
+// doesn't have that component type
+template<class T>
+T* chunkComponent(ArchetypeChunk* chunk, uint32 row, uint32 index=0)
+{
+    ArchetypeColumn* column = chunkColumn(chunk, ecsComponentType<T>());
+    if (column == nullptr) return nullptr;
 
-    auto constexpr bucketSize = Ecs::ecsBucketSize<T>();
+    T* values = (T*)column->values;
 
-    void* componentListPtr = e.ecs->componentListByType[typeid(T)];
-    auto componentList = (Ecs::ComponentList<T, bucketSize>*)(componentListPtr);
-    
-    BucketLocator location = componentList->components.occupyEmptySlot();
-    T* result = componentList->components.addressOf(location);
-    result->entity = e;
+    if (T::multipleAllowedPerEntity)
+    {
+        assert(index < column->rowStart[row + 1] - column->rowStart[row]);
+        return &values[column->rowStart[row] + index];
+    }
 
-    //
-    // Creates new component group entry if one doesn't exist. Otherwise, modifies the existing one
-    //
-    ComponentGroup<T, bucketSize>* cg = &(componentList->lookup[e.id]);
-    cg->entity = e;
-    cg->bucketArray = &componentList->components;
+    assert(index == 0);
+    return &values[row];
+}
 
-    assert(cg->numComponents == 0 || T::multipleAllowedPerEntity);
+//
+// Components
+//
+// Note: Adding or removing a component can move the components of any entity in the ECS. See Archetype.h
+//
+
+template<class T>
+ComponentGroup<T> getComponents(Entity e);
+
+template<class T>
+T* addComponent(Entity e)
+{
+    if (e.id == 0) return nullptr;
 
-    cg->components[cg->numComponents] = location;
-    cg->numComponents++;
+    if (ecsComponentType<T>() == ComponentType::Transform) markTransformHierarchyDirty(e.ecs);
 
-    assert(cg->numComponents < MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY);
-    
+    T* result = (T*)addArchetypeComponents(&e.ecs->archetypes, e, ecsComponentType<T>(), 1);
     return result;
 }
 
+// Returns all of the entity's components of this type, including any it already had
 template<class T>
-ComponentGroup<T, Ecs::ecsBucketSize<T>()> addComponents(Entity e, uint32 numComponents)
+ComponentGroup<T> addComponents(Entity e, uint32 numComponents)
 {
     static_assert(T::multipleAllowedPerEntity, "Multiple components of this type not allowed");
-    auto constexpr bucketSize = Ecs::ecsBucketSize<T>();
 
-    ComponentGroup<T, bucketSize> result;
+    ComponentGroup<T> result;
 
     if (e.id == 0)
     {
         return result;
     }
 
-    void* componentListPtr = e.ecs->componentListByType[typeid(T)];
-    auto componentList = (Ecs::ComponentList<T, bucketSize>*)(componentListPtr);
-    
-    //
-    // Creates new component group entry if one doesn't exist. Otherwise, modifies the existing one
-    //
-    ComponentGroup<T, bucketSize>* componentGroup = &(componentList->lookup[e.id]);
-    componentGroup->entity = e;
-    componentGroup->bucketArray = &componentList->components;
-
-    for (uint32 i = 0; i < numComponents; i++)
-    {
-        BucketLocator locator = componentList->components.occupyEmptySlot();
-        T* component = componentList->components.addressOf(locator);
-        component->entity = e;
-
-        componentGroup->components[componentGroup->numComponents] = locator;
-        componentGroup->numComponents++;
-
-        assert(componentGroup->numComponents < MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY);
-    }
+    assert(numComponents > 0);
+    addArchetypeComponents(&e.ecs->archetypes, e, ecsComponentType<T>(), numComponents);
 
-    componentGroup->bucketArray = &componentList->components;
+    result = getComponents<T>(e);
+    assert(result.numComponents <= MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY);
 
-    result = *componentGroup;
     return result;
 }
 
@@ -172,44 +226,33 @@ T* getComponent(Entity e)
 {
     if (e.id == 0) return nullptr;
 
-    auto constexpr bucketSize = Ecs::ecsBucketSize<T>();
-
-    void* componentListPtr = e.ecs->componentListByType[typeid(T)];
-    auto componentList = (Ecs::ComponentList<T, bucketSize>*)(componentListPtr);
-
-    auto it = componentList->lookup.find(e.id);
-    if (it == componentList->lookup.end())
+    EntityLocation* location = entityLocation(&e.ecs->archetypes, e.id);
+    if (location == nullptr)
     {
         return nullptr;
     }
 
-    ComponentGroup<T, bucketSize> componentGroup = it->second;
-    assert(componentGroup.numComponents > 0);
-
-    return &(componentGroup)[0];
+    return chunkComponent<T>(location->chunk, location->row);
 }
 
 template<class T>
-ComponentGroup<T, Ecs::ecsBucketSize<T>()> getComponents(Entity e)
+ComponentGroup<T> getComponents(Entity e)
 {
     static_assert(T::multipleAllowedPerEntity, "Multiple components of this type not allowed");
-    auto constexpr bucketSize = Ecs::ecsBucketSize<T>();
 
-    ComponentGroup<T, bucketSize> result;
-    result.numComponents = 0;
+    ComponentGroup<T> result;
+    result.entity = e;
 
     if (e.id == 0)
     {
         return result;
     }
 
-    void* componentListPtr = e.ecs->componentListByType[typeid(T)];
-    auto componentList = (Ecs::ComponentList<T, bucketSize>*)(componentListPtr);
-    
-    auto it = componentList->lookup.find(e.id);
-    if (it != componentList->lookup.end())
+    EntityLocation* location = entityLocation(&e.ecs->archetypes, e.id);
+    if (location != nullptr && chunkHas<T>(location->chunk))
     {
-        result = it->second;
+        result.components = chunkComponent<T>(location->chunk, location->row);
+        result.numComponents = chunkComponentCount<T>(location->chunk, location->row);
     }
 
     return result;
@@ -218,51 +261,80 @@ ComponentGroup<T, Ecs::ecsBucketSize<T>()> getComponents(Entity e)
 template<class T>
 bool removeComponent(T** component)
 {
-    auto constexpr bucketSize = Ecs::ecsBucketSize<T>();
-
     Entity e = (*component)->entity;
-    void* componentListPtr = e.ecs->componentListByType[typeid(T)];
-    auto componentList = (Ecs::ComponentList<T, bucketSize>*)(componentListPtr);
 
-    auto it = componentList->lookup.find(e.id);
-    if (it == componentList->lookup.end())
+    EntityLocation* location = entityLocation(&e.ecs->archetypes, e.id);
+    if (location == nullptr || !chunkHas<T>(location->chunk))
     {
         return false;
     }
 
-    ComponentGroup<T, bucketSize> &thisEntitiesComponents = it->second;
+    T* first = chunkComponent<T>(location->chunk, location->row);
+    uint32 count = chunkComponentCount<T>(location->chunk, location->row);
 
-    for (uint32 i = 0; i < thisEntitiesComponents.numComponents; i++)
+    if (*component < first || *component >= first + count)
     {
-        T* candidate = &thisEntitiesComponents[i];
+        return false;
+    }
+
+    (*component)->onRemoveComponent();
+
+    if (ecsComponentType<T>() == ComponentType::Transform) markTransformHierarchyDirty(e.ecs);
+    removeArchetypeComponent(&e.ecs->archetypes, e, ecsComponentType<T>(), *component - first);
 
-        if (candidate == *component)
+    *component = nullptr;
+    return true;
+}
+
+// Calls fn(T*) for every component of type T in the ECS, walking each chunk's column front to back
+template<class T, class FN>
+void forEachComponent(Ecs* ecs, FN fn)
+{
+    ArchetypeQuery query;
+    query.all = componentBit(ecsComponentType<T>());
+
+    forEachArchetypeChunk(ecs, query, [&fn](ArchetypeChunk* chunk)
+    {
+        ArchetypeColumn* column = chunkColumn(chunk, ecsComponentType<T>());
+        T* values = (T*)column->values;
+        uint32 count = T::multipleAllowedPerEntity ? column->rowStart[chunk->count] : chunk->count;
+
+        for (uint32 i = 0; i < count; i++)
         {
-            // Remove from bucket array
-            componentList->components.remove(thisEntitiesComponents.components[i]);
-                
-            // Unordered remove from the lookup entry array
-            thisEntitiesComponents.components[i] = thisEntitiesComponents.components[thisEntitiesComponents.numComponents - 1];
-            thisEntitiesComponents.numComponents--;
-
-            if (thisEntitiesComponents.numComponents == 0)
-            {
-                // Removed last of this component type for an entity, remove that entity from the
-                // lookup table
-                componentList->lookup.erase(it);
-            }
-
-            *component = nullptr;
-            return true;
+            fn(&values[i]);
         }
-    }
-
-    return false;
+    });
 }
 
 //
 // Entity functions
 //
 Entity makeEntity(Ecs* ecs, string16 friendlyName="", EntityFlags flags=g_defaultEntityFlags);
-bool   markEntityForDeletion(Entity entity);
+
+// For ids that were reserved ahead of time with allocateEntityId()
+Entity makeEntityWithId(Ecs* ecs, uint32 id, string16 friendlyName="", EntityFlags flags=g_defaultEntityFlags);
+
+// Entities are destroyed through a command buffer. See EcsCommandBuffer.h
+
+// Ids are global rather than per ECS, so an entity keeps its id if it moves to another scene
+uint32 allocateEntityId();
+void   releaseEntityId(uint32 id);
+
+//
+// Entity directory. Maps each live entity id to the ECS that owns it, so resolving an id doesn't have to search every
+// scene. Entries are checked against the id's generation, so a stale id resolves to nothing instead of to whichever
+// entity reused its index.
+//
+struct EntityDirectoryEntry
+{
+    uint8 generation = 0;
+    Ecs* ecs = nullptr;                 // nullptr while the id is only reserved, or once the entity is destroyed
+    EntityDetails* details = nullptr;
+};
+
+// makeEntity(..) registers the entity. Anything that moves an entity to another ECS must call this again.
+void setEntityOwner(uint32 id, Ecs* ecs, EntityDetails* details);
+
+// Returns nullptr if no live entity has this id
+const EntityDirectoryEntry* lookupEntity(uint32 id);
 
@@ -0,0 +1,189 @@
+#include "EcsCommandBuffer.h"
+
+#include "Game.h"
+
+#include <algorithm>
+
+namespace
+{
+    void removeAllComponents(Ecs* ecs, const std::vector<uint32>& ids)
+    {
+        // Before anything moves, so no transform's fixup writes into a hierarchy that's about to be thrown away
+        markTransformHierarchyDirty(ecs);
+
+        // Every onRemoveComponent() runs before anything moves, so they all see the components where they were
+        for (uint32 id : ids)
+        {
+            onRemoveArchetypeEntity(&ecs->archetypes, id);
+        }
+
+        removeArchetypeEntities(&ecs->archetypes, ids.data(), ids.size());
+    }
+
+    void destroyEntities(Game* game, const std::vector<PotentiallyStaleEntity>& roots)
+    {
+        //
+        // Gather the entities and all of their descendants. The flag skips entities that were destroyed more than once
+        // or that are a descendant of another destroyed entity.
+        //
+        std::vector<Entity> dying;
+        std::vector<PotentiallyStaleEntity> stack = roots;
+
+        while (!stack.empty())
+        {
+            PotentiallyStaleEntity staleEntity = stack.back();
+            stack.pop_back();
+
+            Entity e = getEntity(game, &staleEntity);
+            EntityDetails* details = getComponent<EntityDetails>(e);
+            if (details == nullptr) continue; // Already gone
+            if (details->flags & EntityFlag_MarkedForDeletion) continue;
+
+            details->flags |= EntityFlag_MarkedForDeletion;
+            dying.push_back(e);
+
+            for (PotentiallyStaleEntity child : details->children)
+            {
+                stack.push_back(child);
+            }
+        }
+
+        if (dying.empty()) return;
+
+        //
+        // Unhook everything that is being destroyed from parents that are sticking around
+        //
+        for (Entity e : dying)
+        {
+            EntityDetails* details = getComponent<EntityDetails>(e);
+
+            Entity parent = getEntity(game, &details->parent);
+            EntityDetails* parentDetails = getComponent<EntityDetails>(parent);
+
+            if (parentDetails && !(parentDetails->flags & EntityFlag_MarkedForDeletion))
+            {
+                std::vector<PotentiallyStaleEntity>* siblings = &parentDetails->children;
+                siblings->erase(
+                    std::remove_if(siblings->begin(), siblings->end(), [e](PotentiallyStaleEntity s) { return s.id == e.id; }),
+                    siblings->end());
+            }
+
+            if (game->editor.selectedEntity.id == e.id)
+            {
+                game->editor.selectedEntity.id = 0;
+            }
+        }
+
+        //
+        // Remove them from each scene's ECS
+        //
+        // @Note: This skips removeComponent(..), so removeAllComponents(..) calls onRemoveComponent() itself
+        //
+        std::vector<uint32> ids;
+
+        for (uint32 i = 0; i < game->numScenes; i++)
+        {
+            Ecs* ecs = &game->scenes[i].ecs;
+
+            ids.clear();
+            for (Entity e : dying)
+            {
+                if (e.ecs == ecs) ids.push_back(e.id);
+            }
+
+            if (ids.empty()) continue;
+
+            std::sort(ids.begin(), ids.end());
+
+            // One pass over the entity list instead of a find + erase per entity
+            ecs->entities.erase(
+                std::remove_if(ecs->entities.begin(), ecs->entities.end(), [&ids](Entity e) { return std::binary_search(ids.begin(), ids.end(), e.id); }),
+                ecs->entities.end());
+
+            removeAllComponents(ecs, ids);
+        }
+
+        // All of their components are gone, so the indices can be recycled
+        for (Entity e : dying)
+        {
+            releaseEntityId(e.id);
+        }
+    }
+}
+
+void recordCommand(EcsCommandBuffer* buffer, EcsCommand command)
+{
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->commands.push_back(std::move(command));
+}
+
+Entity recordMakeEntity(EcsCommandBuffer* buffer, Ecs* ecs, string16 friendlyName, EntityFlags flags)
+{
+    Entity result;
+    result.id = allocateEntityId();
+    result.ecs = ecs;
+
+    EcsCommand command;
+    command.type = EcsCommandType::MakeEntity;
+    command.entity = result;
+    command.ecs = ecs;
+    command.friendlyName = friendlyName;
+    command.flags = flags;
+
+    recordCommand(buffer, command);
+
+    return result;
+}
+
+void recordDestroyEntity(EcsCommandBuffer* buffer, Entity e)
+{
+    if (e.id == 0) return;
+
+    EcsCommand command;
+    command.type = EcsCommandType::DestroyEntity;
+    command.entity = e;
+
+    recordCommand(buffer, command);
+}
+
+void playbackCommandBuffer(Game* game, EcsCommandBuffer* buffer)
+{
+    // Take the commands so the lock isn't held while they run
+    std::vector<EcsCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        commands.swap(buffer->commands);
+    }
+
+    std::vector<PotentiallyStaleEntity> toDestroy;
+
+    for (EcsCommand& command : commands)
+    {
+        switch (command.type)
+        {
+            case EcsCommandType::MakeEntity:
+            {
+                makeEntityWithId(command.ecs, command.entity.id, command.friendlyName, command.flags);
+            } break;
+
+            case EcsCommandType::Apply:
+            {
+                // Entities that were destroyed before playback just drop their commands
+                Entity e = getEntity(game, &command.entity);
+                if (e.id != 0) command.apply(e);
+            } break;
+
+            case EcsCommandType::DestroyEntity:
+            {
+                toDestroy.push_back(command.entity);
+            } break;
+
+            default: assert(false);
+        }
+    }
+
+    if (!toDestroy.empty())
+    {
+        destroyEntities(game, toDestroy);
+    }
+}
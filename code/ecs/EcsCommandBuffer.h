@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Ecs.h"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+struct Game;
+
+//
+// Records structural changes (making/destroying entities, adding/removing components) so that they can be requested
+// from any system or worker thread and applied later, all at once, from the main thread.
+//
+// Playback applies the commands in the order they were recorded, except for destroys, which all happen at the end
+// as one batch. The batch gathers the dying entities and their descendants first, so each one's row is removed from
+// its archetype once, no matter how many times it was destroyed.
+//
+
+enum class EcsCommandType : uint8
+{
+    MakeEntity,
+    Apply,          // Add/remove components
+    DestroyEntity
+};
+
+struct EcsCommand
+{
+    EcsCommandType type;
+    PotentiallyStaleEntity entity;
+
+    // MakeEntity
+    Ecs* ecs = nullptr;
+    string16 friendlyName = "";
+    EntityFlags flags = g_defaultEntityFlags;
+
+    // Apply
+    std::function<void(Entity)> apply;
+};
+
+struct EcsCommandBuffer
+{
+    std::mutex mutex; // Guards commands. Recording is safe from any thread, playback is not.
+    std::vector<EcsCommand> commands;
+};
+
+void recordCommand(EcsCommandBuffer* buffer, EcsCommand command);
+
+// The id is reserved immediately, so the returned entity can be passed to later commands (in this or another buffer).
+// It doesn't exist in the ECS until playback though, so it can't be used with getComponent(..) etc. until then.
+Entity recordMakeEntity(EcsCommandBuffer* buffer, Ecs* ecs, string16 friendlyName="", EntityFlags flags=g_defaultEntityFlags);
+
+// Destroys the entity and all of its descendants
+void recordDestroyEntity(EcsCommandBuffer* buffer, Entity e);
+
+// Calls init(T*) on the new component when it is added during playback
+template<class T, class FN>
+void recordAddComponent(EcsCommandBuffer* buffer, Entity e, FN init)
+{
+    EcsCommand command;
+    command.type = EcsCommandType::Apply;
+    command.entity = e;
+    command.apply = [init](Entity e)
+    {
+        T* component = addComponent<T>(e);
+        if (component) init(component);
+    };
+
+    recordCommand(buffer, command);
+}
+
+template<class T>
+void recordAddComponent(EcsCommandBuffer* buffer, Entity e)
+{
+    recordAddComponent<T>(buffer, e, [](T*) {});
+}
+
+// Removes every component of type T that the entity has at playback time
+template<class T>
+void recordRemoveComponents(EcsCommandBuffer* buffer, Entity e)
+{
+    static_assert(ecsComponentType<T>() != ComponentType::EntityDetails && ecsComponentType<T>() != ComponentType::Transform,
+                  "Mandatory components can only be removed by destroying the entity");
+
+    EcsCommand command;
+    command.type = EcsCommandType::Apply;
+    command.entity = e;
+    command.apply = [](Entity e)
+    {
+        // Last one first, so the ones before it don't have to move down
+        while (EntityLocation* location = entityLocation(&e.ecs->archetypes, e.id))
+        {
+            uint32 count = chunkComponentCount<T>(location->chunk, location->row);
+            if (count == 0) break;
+
+            T* component = chunkComponent<T>(location->chunk, location->row, count - 1);
+            removeComponent(&component);
+        }
+    };
+
+    recordCommand(buffer, command);
+}
+
+// Removes the entity's index-th component of type T, if it still has that many at playback time
+template<class T>
+void recordRemoveComponent(EcsCommandBuffer* buffer, Entity e, uint32 index)
+{
+    static_assert(ecsComponentType<T>() != ComponentType::EntityDetails && ecsComponentType<T>() != ComponentType::Transform,
+                  "Mandatory components can only be removed by destroying the entity");
+
+    EcsCommand command;
+    command.type = EcsCommandType::Apply;
+    command.entity = e;
+    command.apply = [index](Entity e)
+    {
+        EntityLocation* location = entityLocation(&e.ecs->archetypes, e.id);
+        if (location == nullptr || index >= chunkComponentCount<T>(location->chunk, location->row)) return;
+
+        T* component = chunkComponent<T>(location->chunk, location->row, index);
+        removeComponent(&component);
+    };
+
+    recordCommand(buffer, command);
+}
+
+// Main thread only, and not while any systems are running
+void playbackCommandBuffer(Game* game, EcsCommandBuffer* buffer);
@@ -9,6 +9,23 @@ struct Ecs;
 // Note: this SHOULD be enough even for the ones that can be sprawling, like lots of submeshes (render components) or colliders
 #define MAX_NUM_OF_SAME_COMPONENTS_PER_ENTITY 64
 
+//
+// Entity ids pack a 24 bit index and an 8 bit generation. Indices get recycled when entities are deleted, and the
+// generation is bumped each time so that an id that outlived its entity won't resolve to the entity that reuses
+// the index. Index 0 is never handed out, so id 0 is always the null entity.
+//
+#define ENTITY_INDEX_BITS 24
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK 0xFF
+
+inline uint32 entityIndex(uint32 id)      { return id & ENTITY_INDEX_MASK; }
+inline uint32 entityGeneration(uint32 id) { return id >> ENTITY_INDEX_BITS; }
+
+inline uint32 makeEntityId(uint32 index, uint32 generation)
+{
+    return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+}
+
 struct Entity
 {
     uint32 id = 0;
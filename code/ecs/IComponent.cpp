@@ -7,3 +7,4 @@ IComponent::IComponent(Entity entity)
 
 void IComponent::onAddComponent() {}
 void IComponent::onRemoveComponent() {}
+void IComponent::onMoveComponent() {}
@@ -12,4 +12,7 @@ struct IComponent
 
     virtual void onAddComponent();
     virtual void onRemoveComponent();
+
+    // Called after the ECS moves the component to a new address. See Archetype.h
+    virtual void onMoveComponent();
 };
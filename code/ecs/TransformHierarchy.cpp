@@ -0,0 +1,326 @@
+#include "TransformHierarchy.h"
+
+#include "Ecs.h"
+#include "als/als_job_system.h"
+
+#include <assert.h>
+
+// Transforms per job. Also bounds the stack arrays that feed composeTrsMatrices(..)
+#define WORLD_MATRIX_BATCH_SIZE 256
+
+void markTransformHierarchyDirty(Ecs* ecs)
+{
+    ecs->transformHierarchy.isDirty = true;
+}
+
+void rebuildTransformHierarchy(Ecs* ecs)
+{
+    TransformHierarchy* hierarchy = &ecs->transformHierarchy;
+    if (!hierarchy->isDirty) return;
+
+    //
+    // Gather every transform, along with a map from entity index to its position in the gathered list
+    //
+    std::vector<TransformComponent*> gathered;
+    std::vector<int32> gatheredIndexOf(ecs->archetypes.locations.size(), -1);
+
+    ArchetypeQuery query;
+    query.all = componentBit(ComponentType::Transform);
+
+    forEachArchetypeChunk(ecs, query, [&](ArchetypeChunk* chunk)
+    {
+        for (uint32 row = 0; row < chunk->count; row++)
+        {
+            gatheredIndexOf[entityIndex(chunk->entities[row].id)] = gathered.size();
+            gathered.push_back(chunkComponent<TransformComponent>(chunk, row));
+        }
+    });
+
+    uint32 count = gathered.size();
+
+    //
+    // Find each transform's parent, as an index into the gathered list
+    //
+    std::vector<int32> parentOf(count, -1);
+    std::vector<uint32> childCountOf(count, 0);
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        EntityDetails* details = getComponent<EntityDetails>(gathered[i]->entity);
+        if (details == nullptr || details->parent.id == 0) continue;
+
+        EntityLocation* parentLocation = entityLocation(&ecs->archetypes, details->parent.id);
+        if (parentLocation == nullptr || !chunkHas<TransformComponent>(parentLocation->chunk))
+        {
+            // Parents are expected to live in the same ECS
+            assert(false);
+            continue;
+        }
+
+        parentOf[i] = gatheredIndexOf[entityIndex(details->parent.id)];
+        childCountOf[parentOf[i]]++;
+    }
+
+    //
+    // Children of each transform, packed into one array
+    //
+    std::vector<uint32> childrenStart(count + 1, 0);
+    for (uint32 i = 0; i < count; i++)
+    {
+        childrenStart[i + 1] = childrenStart[i] + childCountOf[i];
+    }
+
+    std::vector<uint32> children(childrenStart[count]);
+    {
+        std::vector<uint32> cursor(childrenStart.begin(), childrenStart.end() - 1);
+        for (uint32 i = 0; i < count; i++)
+        {
+            if (parentOf[i] >= 0) children[cursor[parentOf[i]]++] = i;
+        }
+    }
+
+    //
+    // Breadth first walk from the roots. order holds gathered indices in hierarchy order.
+    //
+    std::vector<uint32> order;
+    order.reserve(count);
+
+    hierarchy->parentIndices.clear();
+    hierarchy->firstChildIndices.clear();
+    hierarchy->childCounts.clear();
+    hierarchy->levelStarts.clear();
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        if (parentOf[i] < 0)
+        {
+            order.push_back(i);
+            hierarchy->parentIndices.push_back(-1);
+        }
+    }
+
+    if (count > 0) hierarchy->levelStarts.push_back(0);
+
+    uint32 levelEnd = order.size();
+    for (uint32 i = 0; i < order.size(); i++)
+    {
+        if (i == levelEnd)
+        {
+            // Everything queued so far is the next level
+            hierarchy->levelStarts.push_back(i);
+            levelEnd = order.size();
+        }
+
+        uint32 gatheredIndex = order[i];
+
+        // Leaves still get the position their children would have had, so that the next level of any range of
+        // nodes is [firstChild of the first, firstChild + childCount of the last)
+        hierarchy->firstChildIndices.push_back(order.size());
+        hierarchy->childCounts.push_back(childCountOf[gatheredIndex]);
+
+        for (uint32 c = childrenStart[gatheredIndex]; c < childrenStart[gatheredIndex + 1]; c++)
+        {
+            order.push_back(children[c]);
+            hierarchy->parentIndices.push_back(i);
+        }
+    }
+
+    if (count > 0) hierarchy->levelStarts.push_back(order.size());
+
+    // Anything that wasn't reached is part of a parenting cycle
+    assert(order.size() == count);
+
+    hierarchy->worldMatrices.resize(order.size());
+    hierarchy->worldMatrixDirty.assign(order.size(), 1);
+
+    hierarchy->transforms.resize(order.size());
+    for (uint32 i = 0; i < order.size(); i++)
+    {
+        TransformComponent* xfm = gathered[order[i]];
+        xfm->hierarchyIndex = i;
+        hierarchy->transforms[i] = xfm;
+    }
+
+    // Indices changed, so there's nothing to interpolate from until the next step
+    hierarchy->previousPositions.clear();
+    hierarchy->previousOrientations.clear();
+    hierarchy->movedLastStep.clear();
+
+    hierarchy->isDirty = false;
+}
+
+static void recalculateWorldIfDirty(TransformHierarchy* hierarchy, uint32 index)
+{
+    TransformComponent* xfm = hierarchy->transforms[index];
+
+    if (xfm->isWorldDirty())
+    {
+        int32 parentIndex = hierarchy->parentIndices[index];
+        xfm->recalculateWorld(parentIndex >= 0 ? hierarchy->transforms[parentIndex] : nullptr);
+    }
+}
+
+static bool hasInterpolationState(TransformHierarchy* hierarchy)
+{
+    return !hierarchy->isDirty && hierarchy->movedLastStep.size() == hierarchy->transforms.size();
+}
+
+// Normalized lerp. Close enough to a slerp over the few degrees anything turns in one step.
+static Quaternion blendOrientations(Quaternion from, Quaternion to, float32 alpha)
+{
+    // q and -q are the same orientation. Blend towards whichever is closer, so it doesn't go the long way around.
+    float32 cosAngle = from.x * to.x + from.y * to.y + from.z * to.z + from.w * to.w;
+    if (cosAngle < 0) to = -to;
+
+    return normalize(from * (1 - alpha) + to * alpha);
+}
+
+void refreshWorldTransforms(JobSystem* jobs, Ecs* ecs)
+{
+    rebuildTransformHierarchy(ecs);
+
+    TransformHierarchy* hierarchy = &ecs->transformHierarchy;
+
+    for (uint32 depth = 0; depth < transformHierarchyDepthCount(hierarchy); depth++)
+    {
+        uint32 levelStart = hierarchy->levelStarts[depth];
+        uint32 levelCount = hierarchy->levelStarts[depth + 1] - levelStart;
+
+        parallelFor(jobs, levelCount, WORLD_MATRIX_BATCH_SIZE, [hierarchy, levelStart](uint32 begin, uint32 end)
+        {
+            for (uint32 i = levelStart + begin; i < levelStart + end; i++)
+            {
+                recalculateWorldIfDirty(hierarchy, i);
+            }
+        });
+    }
+}
+
+void updateWorldMatrices(JobSystem* jobs, Ecs* ecs, float32 alpha)
+{
+    rebuildTransformHierarchy(ecs);
+
+    TransformHierarchy* hierarchy = &ecs->transformHierarchy;
+    bool interpolate = hasInterpolationState(hierarchy);
+
+    for (uint32 depth = 0; depth < transformHierarchyDepthCount(hierarchy); depth++)
+    {
+        uint32 levelStart = hierarchy->levelStarts[depth];
+        uint32 levelCount = hierarchy->levelStarts[depth + 1] - levelStart;
+
+        parallelFor(jobs, levelCount, WORLD_MATRIX_BATCH_SIZE, [hierarchy, levelStart, interpolate, alpha](uint32 begin, uint32 end)
+        {
+            // Packed inputs for composeTrsMatrices(..)
+            Vec3 positions[WORLD_MATRIX_BATCH_SIZE];
+            Quaternion orientations[WORLD_MATRIX_BATCH_SIZE];
+            Vec3 scales[WORLD_MATRIX_BATCH_SIZE];
+            Mat4* out[WORLD_MATRIX_BATCH_SIZE];
+            uint32 dirtyCount = 0;
+
+            for (uint32 i = levelStart + begin; i < levelStart + end; i++)
+            {
+                TransformComponent* xfm = hierarchy->transforms[i];
+                recalculateWorldIfDirty(hierarchy, i);
+
+                bool blend = interpolate && hierarchy->movedLastStep[i];
+
+                if (!hierarchy->worldMatrixDirty[i] && !blend) continue;
+                hierarchy->worldMatrixDirty[i] = 0;
+
+                if (blend)
+                {
+                    positions[dirtyCount] = hierarchy->previousPositions[i] + (xfm->position() - hierarchy->previousPositions[i]) * alpha;
+                    orientations[dirtyCount] = blendOrientations(hierarchy->previousOrientations[i], xfm->orientation(), alpha);
+                }
+                else
+                {
+                    positions[dirtyCount] = xfm->position();
+                    orientations[dirtyCount] = xfm->orientation();
+                }
+
+                scales[dirtyCount] = xfm->scale();
+                out[dirtyCount] = &hierarchy->worldMatrices[i];
+                dirtyCount++;
+            }
+
+            composeTrsMatrices(positions, orientations, scales, dirtyCount, out);
+        });
+    }
+}
+
+void snapshotTransforms(JobSystem* jobs, Ecs* ecs)
+{
+    rebuildTransformHierarchy(ecs);
+
+    TransformHierarchy* hierarchy = &ecs->transformHierarchy;
+    uint32 count = hierarchy->transforms.size();
+
+    // Whatever was blended last step has a matrix that isn't where it is anymore
+    if (hasInterpolationState(hierarchy))
+    {
+        for (uint32 i = 0; i < count; i++)
+        {
+            if (hierarchy->movedLastStep[i]) hierarchy->worldMatrixDirty[i] = 1;
+        }
+    }
+
+    hierarchy->previousPositions.resize(count);
+    hierarchy->previousOrientations.resize(count);
+    hierarchy->movedLastStep.assign(count, 0);
+
+    // The world values are already up to date, so unlike updateWorldMatrices(..) this doesn't need to go level by level
+    parallelFor(jobs, count, WORLD_MATRIX_BATCH_SIZE, [hierarchy](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; i++)
+        {
+            // Other systems read transforms alongside this one, so it can't refresh them itself
+            assert(!hierarchy->transforms[i]->isWorldDirty());
+
+            hierarchy->previousPositions[i] = hierarchy->transforms[i]->position();
+            hierarchy->previousOrientations[i] = hierarchy->transforms[i]->orientation();
+        }
+    });
+}
+
+void markMovedTransforms(JobSystem* jobs, Ecs* ecs)
+{
+    rebuildTransformHierarchy(ecs);
+
+    TransformHierarchy* hierarchy = &ecs->transformHierarchy;
+
+    // Something was added or reparented during the step. Nothing gets interpolated until the next one.
+    if (!hasInterpolationState(hierarchy)) return;
+
+    parallelFor(jobs, hierarchy->transforms.size(), WORLD_MATRIX_BATCH_SIZE, [hierarchy](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; i++)
+        {
+            assert(!hierarchy->transforms[i]->isWorldDirty());
+
+            Vec3 position = hierarchy->transforms[i]->position();
+            Quaternion orientation = hierarchy->transforms[i]->orientation();
+            Vec3 previousPosition = hierarchy->previousPositions[i];
+            Quaternion previousOrientation = hierarchy->previousOrientations[i];
+
+            hierarchy->movedLastStep[i] =
+                position.x != previousPosition.x || position.y != previousPosition.y || position.z != previousPosition.z ||
+                orientation.x != previousOrientation.x || orientation.y != previousOrientation.y ||
+                orientation.z != previousOrientation.z || orientation.w != previousOrientation.w;
+        }
+    });
+}
+
+Vec3 interpolatedPosition(TransformHierarchy* hierarchy, TransformComponent* xfm, float32 alpha)
+{
+    if (!hasInterpolationState(hierarchy) || !hierarchy->movedLastStep[xfm->hierarchyIndex]) return xfm->position();
+
+    Vec3 previous = hierarchy->previousPositions[xfm->hierarchyIndex];
+    return previous + (xfm->position() - previous) * alpha;
+}
+
+Quaternion interpolatedOrientation(TransformHierarchy* hierarchy, TransformComponent* xfm, float32 alpha)
+{
+    if (!hasInterpolationState(hierarchy) || !hierarchy->movedLastStep[xfm->hierarchyIndex]) return xfm->orientation();
+
+    return blendOrientations(hierarchy->previousOrientations[xfm->hierarchyIndex], xfm->orientation(), alpha);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_math.h"
+#include "ecs/components/TransformComponent.h"
+
+#include <assert.h>
+#include <vector>
+
+struct Ecs;
+struct JobSystem;
+
+//
+// Flattened copy of an ECS's parent/child relationships, for transform propagation. EntityDetails is still the
+// authority on who is parented to whom (the editor edits it), this is just a cache of it that is rebuilt after
+// anything is reparented or any transform is added or removed.
+//
+// Entries are sorted breadth first: all roots (depth 0), then everything at depth 1, and so on. So every parent comes
+// before its children, each depth level is a contiguous range, and the children of a node are a contiguous range of
+// the next level.
+//
+// Each TransformComponent knows its index in here (hierarchyIndex), so getting its parent or walking its children is
+// an array lookup instead of going through getEntity(..) and getComponent(..).
+//
+// updateWorldMatrices(..) also writes every transform's world matrix into one contiguous array, in the same order.
+// Render reads them from there rather than calling matrix() on each transform.
+//
+
+struct TransformHierarchy
+{
+    std::vector<TransformComponent*> transforms;
+    std::vector<int32> parentIndices;       // -1 for roots
+    std::vector<uint32> firstChildIndices;
+    std::vector<uint32> childCounts;
+
+    // Depth d is [levelStarts[d], levelStarts[d + 1])
+    std::vector<uint32> levelStarts;
+
+    std::vector<Mat4> worldMatrices;
+    std::vector<uint8> worldMatrixDirty; // Set by TransformComponent::markSelfAndChildrenDirty(), cleared by updateWorldMatrices(..)
+
+    //
+    // For interpolating between simulation steps. World position and orientation of every transform as of the last
+    // snapshotTransforms(..), and which ones markMovedTransforms(..) found had moved since. Empty until the first step
+    // after a rebuild.
+    //
+    std::vector<Vec3> previousPositions;
+    std::vector<Quaternion> previousOrientations;
+    std::vector<uint8> movedLastStep;
+
+    bool isDirty = true;
+};
+
+void markTransformHierarchyDirty(Ecs* ecs);
+void rebuildTransformHierarchy(Ecs* ecs);
+
+inline uint32 transformHierarchyDepthCount(TransformHierarchy* hierarchy)
+{
+    return hierarchy->levelStarts.empty() ? 0 : hierarchy->levelStarts.size() - 1;
+}
+
+//
+// Brings every transform's cached world position, orientation and scale up to date, one level at a time like
+// updateWorldMatrices(..). Reading a clean transform doesn't write to it, so once this has run any number of systems can
+// read transforms at once. The scheduler runs it after every system that writes transforms (see SystemScheduler.h).
+//
+void refreshWorldTransforms(JobSystem* jobs, Ecs* ecs);
+
+// Brings every transform's cached world values up to date and rebuilds the dirty entries of worldMatrices, one level at
+// a time. Each level only reads the (already updated) level above it, so the transforms within a level are updated in
+// parallel, and their matrices are built 4 at a time with composeTrsMatrices(..).
+//
+// Transforms that moved during the last simulation step get a matrix alpha of the way from where they were before it
+// to where they are now, and are rebuilt every time.
+void updateWorldMatrices(JobSystem* jobs, Ecs* ecs, float32 alpha=1);
+
+//
+// Call before each simulation step. Records every transform's world position and orientation. Only reads the transforms,
+// so their world values must already be refreshed.
+//
+void snapshotTransforms(JobSystem* jobs, Ecs* ecs);
+
+//
+// Call after the last simulation step of a frame. Finds the transforms that moved since snapshotTransforms(..), which are
+// the ones that get interpolated. Anything moved outside of the simulation (the camera, the editor) is drawn where it
+// is. Only reads the transforms, like snapshotTransforms(..).
+//
+// @Note: Only the last step is interpolated, so there's no need to call it after the steps before that. The next
+//        snapshotTransforms(..) would throw away what it found.
+//
+void markMovedTransforms(JobSystem* jobs, Ecs* ecs);
+
+// The transform's world position/orientation, alpha of the way through the last simulation step. Just its current
+// value if it didn't move during it.
+Vec3 interpolatedPosition(TransformHierarchy* hierarchy, TransformComponent* xfm, float32 alpha);
+Quaternion interpolatedOrientation(TransformHierarchy* hierarchy, TransformComponent* xfm, float32 alpha);
+
+// The transform's world matrix as of the last updateWorldMatrices(..). Only valid until the transform is moved or
+// anything is reparented/added/removed.
+inline Mat4* worldMatrix(TransformHierarchy* hierarchy, TransformComponent* xfm)
+{
+    assert(!hierarchy->isDirty);
+    assert(!hierarchy->worldMatrixDirty[xfm->hierarchyIndex]);
+
+    return &hierarchy->worldMatrices[xfm->hierarchyIndex];
+}
@@ -3,8 +3,20 @@
 #include "als/als_math.h"
 #include "ecs/IComponent.h"
 
+//
+// What an agent wants to do this frame. Whatever drives the agent (player input, AI) fills this in before
+// updateCharacterControllers(..) moves it.
+//
+struct AgentIntent
+{
+    Vec2 move;          // World space direction on the xz plane (x, z). Longer than 1 gets normalized.
+    bool jump = false;  // Only does anything if the agent is grounded. Cleared by the step that sees it.
+};
+
 struct AgentComponent : public IComponent
 {
+    AgentIntent intent;
+
     // Note: These are not stored in a Vec3 because yVelocity (gravity) is treated differently than the other velocities in the movement code.
     //       Math isn't done in the velocities as a 3D vector
     Vec2 velocity;
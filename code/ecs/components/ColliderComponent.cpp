@@ -5,6 +5,7 @@
 #include "ecs/Ecs.h"
 
 #include "Aabb.h"
+#include "ecs/systems/CollisionSystem.h"
 
 ColliderComponent::ColliderComponent()
 {
@@ -25,6 +26,16 @@ ColliderComponent::ColliderComponent(Entity e, Aabb aabb)
     this->rect3Lengths.z = aabb.halfDim.z * 2;
 }
 
+void ColliderComponent::onRemoveComponent()
+{
+    onColliderRemoved(this->entity.ecs, this);
+}
+
+void ColliderComponent::onMoveComponent()
+{
+    onColliderMoved(this->entity.ecs, this);
+}
+
 Vec3 ColliderComponent::center()
 {
     TransformComponent *xfm = getComponent<TransformComponent>(this->entity);
@@ -33,7 +44,20 @@ Vec3 ColliderComponent::center()
     return xfm->position() + rotatedOffset;
 }
 
-Vec3 ColliderComponent::support(Vec3 direction)
+ColliderKey ColliderComponent::colliderKey()
+{
+    ComponentGroup<ColliderComponent> siblings = getComponents<ColliderComponent>(this->entity);
+
+    uint32 index = (uint32)(this - siblings.components);
+    assert(index < siblings.numComponents);
+
+    ColliderKey result;
+    result.entityId = this->entity.id;
+    result.slot = ColliderSlot_Primitive | index;
+    return result;
+}
+
+Vec3 ColliderComponent::support(Vec3 direction, HullSupportWarmStart* warmStart)
 {
     // Consider collider in identity position/orientation.
     // Need to rotate direction accordingly
@@ -43,9 +67,89 @@ Vec3 ColliderComponent::support(Vec3 direction)
     Quaternion toIdentity = relativeRotation(orientation, Quaternion());
 
     Vec3 relativeDirection = toIdentity * direction;
-    Vec3 result; // After storing result here, we will rotate it back into the correct orientation
-    
-    switch (this->type)
+
+    ScaledColliderShape shape = scaledColliderShape(this);
+    Vec3 result = scaledColliderShapeSupport(&shape, relativeDirection);
+
+    // Re-orient and offset
+    result = orientation * result;
+    result = this->center() + result;
+    return result;
+}
+
+uint32 ColliderComponent::supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart)
+{
+    // Same transforms as support(..)
+    direction.normalizeInPlace();
+
+    Quaternion orientation = getComponent<TransformComponent>(this->entity)->orientation();
+    Quaternion toIdentity = relativeRotation(orientation, Quaternion());
+
+    ScaledColliderShape shape = scaledColliderShape(this);
+    uint32 count = scaledColliderShapeFeature(&shape, toIdentity * direction, tolerance, out, maxCount);
+
+    Vec3 center = this->center();
+    for (uint32 i = 0; i < count; i++)
+    {
+        out[i] = center + orientation * out[i];
+    }
+
+    return count;
+}
+
+PrimitiveShape ColliderComponent::primitiveShape()
+{
+    if (this->type == ColliderType::CYLINDER) return PrimitiveShape();
+
+    // Same as center(..), but with the one lookup
+    TransformComponent* xfm = getComponent<TransformComponent>(this->entity);
+    Quaternion orientation = xfm->orientation();
+    Vec3 center = xfm->position() + orientation * hadamard(this->xfmOffset, xfm->scale());
+
+    ScaledColliderShape shape = scaledColliderShape(this);
+    return scaledColliderShapePrimitive(&shape, center, orientation);
+}
+
+ScaledColliderShape scaledColliderShape(ColliderComponent* collider)
+{
+    ScaledColliderShape result;
+    result.type = collider->type;
+    result.axis = Axis3D::X;
+    result.length = 0;
+    result.radius = 0;
+    result.rect3Lengths = Vec3(0);
+
+    switch (collider->type)
+    {
+        case ColliderType::RECT3:
+        {
+            result.rect3Lengths = scaledRect3Lengths(collider);
+        } break;
+
+        case ColliderType::SPHERE:
+        {
+            result.radius = scaledRadius(collider);
+        } break;
+
+        case ColliderType::CYLINDER:
+        case ColliderType::CAPSULE:
+        {
+            result.axis = collider->axis;
+            result.length = scaledLength(collider);
+            result.radius = scaledRadius(collider);
+        } break;
+
+        default: assert(false);
+    }
+
+    return result;
+}
+
+Vec3 scaledColliderShapeSupport(ScaledColliderShape* shape, Vec3 relativeDirection)
+{
+    Vec3 result;
+
+    switch (shape->type)
     {
         case ColliderType::RECT3:
         {
@@ -54,9 +158,9 @@ Vec3 ColliderComponent::support(Vec3 direction)
             Vec3 yAxis = Vec3(Axis3D::Y);
             Vec3 zAxis = Vec3(Axis3D::Z);
 
-            float32 xLen = scaledXLength(this);
-            float32 yLen = scaledYLength(this);
-            float32 zLen = scaledZLength(this);
+            float32 xLen = shape->rect3Lengths.x;
+            float32 yLen = shape->rect3Lengths.y;
+            float32 zLen = shape->rect3Lengths.z;
             //   a
             //    |
             //    |  b
@@ -113,35 +217,35 @@ Vec3 ColliderComponent::support(Vec3 direction)
 
         case ColliderType::SPHERE:
         {
-            result = scaledRadius(this) * relativeDirection;
+            result = shape->radius * relativeDirection;
         } break;
 
         case ColliderType::CYLINDER:
         {            
-            if (this->axis == Axis3D::X)
+            if (shape->axis == Axis3D::X)
             {
-                result.x = scaledLength(this) / 2 * (relativeDirection.x > 0 ? 1 : -1);
+                result.x = shape->length / 2 * (relativeDirection.x > 0 ? 1 : -1);
 
                 Vec3 circlePart = normalize(Vec3(0, relativeDirection.y, relativeDirection.z));
-                circlePart *= scaledRadius(this);
+                circlePart *= shape->radius;
                 result.y = circlePart.y;
                 result.z = circlePart.z;
             }
-            else if (this->axis == Axis3D::Y)
+            else if (shape->axis == Axis3D::Y)
             {
-                result.y = scaledLength(this) / 2 * (relativeDirection.y > 0 ? 1 : -1);
+                result.y = shape->length / 2 * (relativeDirection.y > 0 ? 1 : -1);
 
                 Vec3 circlePart = normalize(Vec3(relativeDirection.x, 0, relativeDirection.z));
-                circlePart *= scaledRadius(this);
+                circlePart *= shape->radius;
                 result.x = circlePart.x;
                 result.z = circlePart.z;
             }
-            else if (this->axis == Axis3D::Z)
+            else if (shape->axis == Axis3D::Z)
             {
-                result.z = scaledLength(this) / 2 * (relativeDirection.z > 0 ? 1 : -1);
+                result.z = shape->length / 2 * (relativeDirection.z > 0 ? 1 : -1);
 
                 Vec3 circlePart = normalize(Vec3(relativeDirection.x, relativeDirection.y, 0));
-                circlePart *= scaledRadius(this);
+                circlePart *= shape->radius;
                 result.x = circlePart.x;
                 result.y = circlePart.y;
             }
@@ -151,20 +255,20 @@ Vec3 ColliderComponent::support(Vec3 direction)
 
         case ColliderType::CAPSULE:
         {            
-            if (this->axis == Axis3D::X)
+            if (shape->axis == Axis3D::X)
             {
-                Vec3 endpointSphereCenter = scaledLength(this) / 2 * Vec3(Axis3D::X) * (relativeDirection.x > 0 ? 1 : -1);
-                result = endpointSphereCenter + normalize(relativeDirection) * scaledRadius(this);
+                Vec3 endpointSphereCenter = shape->length / 2 * Vec3(Axis3D::X) * (relativeDirection.x > 0 ? 1 : -1);
+                result = endpointSphereCenter + normalize(relativeDirection) * shape->radius;
             }
-            else if (this->axis == Axis3D::Y)
+            else if (shape->axis == Axis3D::Y)
             {
-                Vec3 endpointSphereCenter = scaledLength(this) / 2 * Vec3(Axis3D::Y) * (relativeDirection.y > 0 ? 1 : -1);
-                result = endpointSphereCenter + normalize(relativeDirection) * scaledRadius(this);
+                Vec3 endpointSphereCenter = shape->length / 2 * Vec3(Axis3D::Y) * (relativeDirection.y > 0 ? 1 : -1);
+                result = endpointSphereCenter + normalize(relativeDirection) * shape->radius;
             }
-            else if (this->axis == Axis3D::Z)
+            else if (shape->axis == Axis3D::Z)
             {
-                Vec3 endpointSphereCenter = scaledLength(this) / 2 * Vec3(Axis3D::Z) * (relativeDirection.z > 0 ? 1 : -1);
-                result = endpointSphereCenter + normalize(relativeDirection) * scaledRadius(this);
+                Vec3 endpointSphereCenter = shape->length / 2 * Vec3(Axis3D::Z) * (relativeDirection.z > 0 ? 1 : -1);
+                result = endpointSphereCenter + normalize(relativeDirection) * shape->radius;
             }
             else assert(false);
 
@@ -176,9 +280,86 @@ Vec3 ColliderComponent::support(Vec3 direction)
         }
     }
 
-    // Re-orient and offset
-    result = orientation * result;
-    result = this->center() + result;
+    return result;
+}
+
+uint32 scaledColliderShapeFeature(ScaledColliderShape* shape, Vec3 relativeDirection, float32 tolerance, Vec3* out, uint32 maxCount)
+{
+    assert(maxCount > 0);
+
+    if (shape->type != ColliderType::RECT3)
+    {
+        // @Think: a cylinder's cap or a capsule lying on its side has more than one point, if manifolds against them
+        //         ever matter
+        out[0] = scaledColliderShapeSupport(shape, relativeDirection);
+        return 1;
+    }
+
+    Vec3 halfLengths = shape->rect3Lengths / 2;
+    float32 furthest = fabs(relativeDirection.x) * halfLengths.x +
+                       fabs(relativeDirection.y) * halfLengths.y +
+                       fabs(relativeDirection.z) * halfLengths.z;
+
+    uint32 count = 0;
+    for (uint32 i = 0; i < 8 && count < maxCount; i++)
+    {
+        Vec3 corner = Vec3(
+            (i & 1) ? halfLengths.x : -halfLengths.x,
+            (i & 2) ? halfLengths.y : -halfLengths.y,
+            (i & 4) ? halfLengths.z : -halfLengths.z
+        );
+
+        if (dot(corner, relativeDirection) >= furthest - tolerance)
+        {
+            out[count] = corner;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+PrimitiveShape scaledColliderShapePrimitive(ScaledColliderShape* shape, Vec3 center, Quaternion orientation)
+{
+    PrimitiveShape result;
+    result.center = center;
+
+    switch (shape->type)
+    {
+        case ColliderType::RECT3:
+        {
+            result.type = PrimitiveShapeType::BOX;
+            result.axes[0] = orientation * Vec3(Axis3D::X);
+            result.axes[1] = orientation * Vec3(Axis3D::Y);
+            result.axes[2] = orientation * Vec3(Axis3D::Z);
+            result.halfExtents = shape->rect3Lengths / 2;
+        } break;
+
+        case ColliderType::SPHERE:
+        {
+            result.type = PrimitiveShapeType::SPHERE;
+            result.radius = shape->radius;
+        } break;
+
+        case ColliderType::CAPSULE:
+        {
+            Vec3 halfSegment = orientation * (shape->length / 2 * Vec3(shape->axis));
+
+            result.type = PrimitiveShapeType::CAPSULE;
+            result.radius = shape->radius;
+            result.segmentA = center - halfSegment;
+            result.segmentB = center + halfSegment;
+        } break;
+
+        case ColliderType::CYLINDER:
+        {
+            // @Think: cylinders are rare enough that GJK is fine for them
+            result.type = PrimitiveShapeType::NONE;
+        } break;
+
+        default: assert(false);
+    }
+
     return result;
 }
 
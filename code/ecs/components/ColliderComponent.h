@@ -44,9 +44,36 @@ struct ColliderComponent : public IComponent, public ICollider
     static constexpr bool multipleAllowedPerEntity = true;
 
     Vec3 center() override;
-    Vec3 support(Vec3 direction) override;
+    ColliderKey colliderKey() override;
+    Vec3 support(Vec3 direction, HullSupportWarmStart* warmStart) override;
+    uint32 supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart) override;
+    PrimitiveShape primitiveShape() override;
+
+    void onRemoveComponent() override;
+    void onMoveComponent() override;
+};
+
+// The collider's shape with its transform's scale applied, around its own center and unrotated
+struct ScaledColliderShape
+{
+    ColliderType type;
+    Axis3D axis;            // Cylinder and capsule
+    float32 length;         // Cylinder and capsule
+    float32 radius;         // Sphere, cylinder and capsule
+    Vec3 rect3Lengths;      // Rect3
 };
 
+ScaledColliderShape scaledColliderShape(ColliderComponent* collider);
+
+// Support point of the shape in its local space. The caller rotates the direction into that space and the result back out.
+Vec3 scaledColliderShapeSupport(ScaledColliderShape* shape, Vec3 relativeDirection);
+
+// Same as ICollider::supportFeature(..), in the shape's local space like scaledColliderShapeSupport(..)
+uint32 scaledColliderShapeFeature(ScaledColliderShape* shape, Vec3 relativeDirection, float32 tolerance, Vec3* out, uint32 maxCount);
+
+// The shape placed at center with orientation, for ICollider::primitiveShape(..). Cylinders are type NONE.
+PrimitiveShape scaledColliderShapePrimitive(ScaledColliderShape* shape, Vec3 center, Quaternion orientation);
+
 Vec3 scaledXfmOffset(ColliderComponent* collider);
 float32 scaledLength(ColliderComponent* collider);
 float32 scaledRadius(ColliderComponent* collider);
@@ -2,35 +2,140 @@
 
 #include "ecs/Ecs.h"
 #include "ecs/components/TransformComponent.h"
+#include "ecs/systems/CollisionSystem.h"
+
+void ConvexHullColliderComponent::onRemoveComponent()
+{
+    onColliderRemoved(this->entity.ecs, this);
+    invalidateWorldPositions(this);
+}
+
+void ConvexHullColliderComponent::onMoveComponent()
+{
+    // The transform moves along with it
+    this->_transform = nullptr;
+
+    onColliderMoved(this->entity.ecs, this);
+}
 
 Vec3 ConvexHullColliderComponent::center()
 {
-    if (!_centerCalculated)
-    {
-        this->_centerCalculated = true;
-        this->_colliderCenter = approximateHullCentroid(this); // Note: this assumes the hull never changes (it shouldn't)
-    }
-    
-    return this->_colliderCenter;
+    updateWorldPositions(this);
+    return this->_worldCenter;
+}
+
+ColliderKey ConvexHullColliderComponent::colliderKey()
+{
+    ComponentGroup<ConvexHullColliderComponent> siblings = getComponents<ConvexHullColliderComponent>(this->entity);
+
+    uint32 index = (uint32)(this - siblings.components);
+    assert(index < siblings.numComponents);
+
+    ColliderKey result;
+    result.entityId = this->entity.id;
+    result.slot = ColliderSlot_Hull | index;
+    return result;
+}
+
+Vec3 ConvexHullColliderComponent::support(Vec3 direction, HullSupportWarmStart* warmStart)
+{
+    updateWorldPositions(this);
+
+    uint32 index = hullSupportIndex(
+        this->_worldXs.data(), this->_worldYs.data(), this->_worldZs.data(), this->_worldXs.size(),
+        this->adjacencyOffsets, this->adjacency, warmStart, direction);
+
+    return Vec3(this->_worldXs[index], this->_worldYs[index], this->_worldZs[index]);
+}
+
+uint32 ConvexHullColliderComponent::supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart)
+{
+    updateWorldPositions(this);
+
+    return hullSupportFeature(
+        this->_worldXs.data(), this->_worldYs.data(), this->_worldZs.data(), this->_worldXs.size(),
+        this->adjacencyOffsets, this->adjacency, warmStart, direction, tolerance, out, maxCount);
+}
+
+PrimitiveShape ConvexHullColliderComponent::primitiveShape()
+{
+    updateWorldPositions(this);
+
+    PrimitiveShape result;
+    result.type = PrimitiveShapeType::HULL;
+    result.center = this->_worldCenter;
+    result.planeXs = this->_worldPlaneXs.data();
+    result.planeYs = this->_worldPlaneYs.data();
+    result.planeZs = this->_worldPlaneZs.data();
+    result.planeOffsets = this->_worldPlaneOffsets.data();
+    result.planeCount = this->_worldPlaneOffsets.size();
+
+    return result;
 }
 
-Vec3 ConvexHullColliderComponent::support(Vec3 direction)
+void updateWorldPositions(ConvexHullColliderComponent* collider)
 {
-    TransformComponent* xfm = getComponent<TransformComponent>(this->entity);
-    Vec3 result;
-    float32 biggestDot = -FLT_MAX;
+    if (!collider->_transform)
+    {
+        collider->_transform = getComponent<TransformComponent>(collider->entity);
+    }
 
-    for (Vec3 position: this->positions)
+    TransformComponent* xfm = collider->_transform;
+    if (collider->_worldPositionsCached && collider->_worldPositionsVersion == xfm->worldVersion()) return;
+
+    if (!collider->_centerCalculated)
     {
-        Vec3 worldPosition = xfm->position() + position;
-
-        float32 dotp = dot(worldPosition, direction);
-        if (dotp > biggestDot)
-        {
-            result = worldPosition;
-            biggestDot = dotp;
-        }
+        collider->_centerCalculated = true;
+        collider->_colliderCenter = approximateHullCentroid(collider); // Note: this assumes the hull never changes (it shouldn't)
     }
 
-    return result;
+    Vec3 position = xfm->position();
+    Quaternion orientation = xfm->orientation();
+    Vec3 scale = xfm->scale();
+
+    uint32 count = collider->positions.size();
+    collider->_worldXs.resize(count);
+    collider->_worldYs.resize(count);
+    collider->_worldZs.resize(count);
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        Vec3 worldPosition = position + orientation * hadamard(scale, collider->positions[i]);
+
+        collider->_worldXs[i] = worldPosition.x;
+        collider->_worldYs[i] = worldPosition.y;
+        collider->_worldZs[i] = worldPosition.z;
+    }
+
+    // Normals go through the inverse transpose, which for TRS is just dividing by the scale instead of multiplying
+    uint32 faceCount = collider->faces.size();
+    collider->_worldPlaneXs.resize(faceCount);
+    collider->_worldPlaneYs.resize(faceCount);
+    collider->_worldPlaneZs.resize(faceCount);
+    collider->_worldPlaneOffsets.resize(faceCount);
+
+    for (uint32 i = 0; i < faceCount; i++)
+    {
+        ConvexHullFace* face = &collider->faces[i];
+
+        Vec3 worldNormal = normalize(orientation * hadamardDivide(face->normal, scale));
+        Vec3 worldVertex = Vec3(collider->_worldXs[face->vertex], collider->_worldYs[face->vertex], collider->_worldZs[face->vertex]);
+
+        collider->_worldPlaneXs[i] = worldNormal.x;
+        collider->_worldPlaneYs[i] = worldNormal.y;
+        collider->_worldPlaneZs[i] = worldNormal.z;
+        collider->_worldPlaneOffsets[i] = dot(worldNormal, worldVertex);
+    }
+
+    collider->_worldCenter = position + orientation * hadamard(scale, collider->_colliderCenter);
+
+    collider->_worldPositionsVersion = xfm->worldVersion();
+    collider->_worldPositionsCached = true;
+}
+
+void invalidateWorldPositions(ConvexHullColliderComponent* collider)
+{
+    collider->_transform = nullptr;
+    collider->_centerCalculated = false;
+    collider->_worldPositionsCached = false;
 }
@@ -4,6 +4,9 @@
 #include "ConvexHull.h"
 #include "ICollider.h"
 #include <utility>
+#include <vector>
+
+struct TransformComponent;
 
 struct ConvexHullColliderComponent : public IComponent, public ConvexHull, public ICollider
 {
@@ -13,16 +16,51 @@ struct ConvexHullColliderComponent : public IComponent, public ConvexHull, publi
 
     bool showInEditor = true;
 
-    bool _centerCalculated;
+    bool _centerCalculated = false;
     Vec3 _colliderCenter;
 
+    //
+    // positions in world space, split into x, y and z so support(..) can run maxDotIndex(..) over them. Rebuilt by
+    // updateWorldPositions(..) whenever the transform's worldVersion() moves on.
+    //
+    std::vector<float32> _worldXs;
+    std::vector<float32> _worldYs;
+    std::vector<float32> _worldZs;
+    Vec3 _worldCenter;
+
+    // Face planes in world space, same layout. dot(normal, p) > offset for points p outside the face.
+    std::vector<float32> _worldPlaneXs;
+    std::vector<float32> _worldPlaneYs;
+    std::vector<float32> _worldPlaneZs;
+    std::vector<float32> _worldPlaneOffsets;
+
+    TransformComponent* _transform = nullptr;
+    uint32 _worldPositionsVersion = 0;
+    bool _worldPositionsCached = false;
+
     Vec3 center() override;
-    Vec3 support(Vec3 direction) override;
+    ColliderKey colliderKey() override;
+    Vec3 support(Vec3 direction, HullSupportWarmStart* warmStart) override;
+    uint32 supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart) override;
+    PrimitiveShape primitiveShape() override;
+
+    void onRemoveComponent() override;
+    void onMoveComponent() override;
 };
 
+// Brings the world space positions up to date with the transform. Does nothing if the transform hasn't changed.
+void updateWorldPositions(ConvexHullColliderComponent* collider);
+
+// Call when the hull or the entity it belongs to changes
+void invalidateWorldPositions(ConvexHullColliderComponent* collider);
+
 inline void stdmoveConvexHullIntoComponent(ConvexHullColliderComponent* component, ConvexHull* hull)
 {
     component->positions = std::move(hull->positions);
     component->edges = std::move(hull->edges);
+    component->faces = std::move(hull->faces);
+    component->adjacencyOffsets = std::move(hull->adjacencyOffsets);
+    component->adjacency = std::move(hull->adjacency);
     component->bounds = hull->bounds;
+    invalidateWorldPositions(component);
 };
@@ -8,6 +8,16 @@
 
 EntityFlags g_defaultEntityFlags = EntityFlag_Static;
 
+void EntityDetails::onMoveComponent()
+{
+    // The directory points at this for lookups. Entities that haven't been registered yet are left alone.
+    const EntityDirectoryEntry* entry = lookupEntity(this->entity.id);
+    if (entry && entry->ecs == this->entity.ecs)
+    {
+        setEntityOwner(this->entity.id, this->entity.ecs, this);
+    }
+}
+
 void removeParent(Entity e)
 {
     if (e.id == 0) return;
@@ -17,6 +27,8 @@ void removeParent(Entity e)
 
     if (parent.id == 0) return;
 
+    markTransformHierarchyDirty(e.ecs);
+
     TransformComponent* xfm = getComponent<TransformComponent>(e);
     Vec3 oldWorldPosition;
     Vec3 oldWorldScale;
@@ -74,6 +86,8 @@ void setParent(Entity child, Entity parent)
 
     if (parent.id == 0) return;
 
+    markTransformHierarchyDirty(child.ecs);
+
     //
     // Store old world xfm
     //
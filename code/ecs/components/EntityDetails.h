@@ -23,6 +23,8 @@ struct EntityDetails : public IComponent
     std::vector<PotentiallyStaleEntity> children;
 
     static const bool multipleAllowedPerEntity = false;
+
+    void onMoveComponent() override;
 };
 
 void removeParent(Entity e);
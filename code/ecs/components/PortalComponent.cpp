@@ -119,10 +119,9 @@ void rebaseTransformInPlace(PortalComponent* portal, ITransform* transform)
 
 void createPortalFromTwoBlankEntities(Entity portal1, Entity portal2, ITransform* portal1Xfm, ITransform* portal2Xfm, Vec2 dimensions)
 {
-    PortalComponent* portal1Component = addComponent<PortalComponent>(portal1);
-    PortalComponent* portal2Component = addComponent<PortalComponent>(portal2);
-    portal1Component->connectedPortal = portal2;
-    portal2Component->connectedPortal = portal1;
+    // Each add can move the other portal's components, so nothing is held on to across them
+    addComponent<PortalComponent>(portal1)->connectedPortal = portal2;
+    addComponent<PortalComponent>(portal2)->connectedPortal = portal1;
     
     TransformComponent* portal1XfmComponent = getComponent<TransformComponent>(portal1);
     portal1XfmComponent->setPosition(portal1Xfm->position());
@@ -151,5 +150,5 @@ void createPortalFromTwoBlankEntities(Entity portal1, Entity portal2, ITransform
     portal2Collider->rect3Lengths.z = colliderDepth;
     portal2Collider->type = ColliderType::RECT3;
 
-    setDimensions(portal1Component, dimensions, true);
+    setDimensions(getComponent<PortalComponent>(portal1), dimensions, true);
 }
@@ -27,13 +27,12 @@ Mesh* getMesh(Entity e)
     return r->submesh->mesh;
 }
 
-void drawRenderComponent(RenderComponent* renderComponent, ITransform *xfm, ICamera* camera, ITransform *cameraXfm, uint32 shadowMapTextureId, Mat4& lightMatrix)
+void drawRenderComponent(RenderComponent* renderComponent, Mat4* modelToWorld, ICamera* camera, ITransform *cameraXfm, uint32 shadowMapTextureId, Mat4& lightMatrix)
 {
-    Mat4 m2w = xfm->matrix();;
     Mat4 w2v = worldToView(cameraXfm);
 
     bind(renderComponent->material);
-    setMat4(renderComponent->material->shader, "model", m2w);
+    setMat4(renderComponent->material->shader, "model", *modelToWorld);
     setMat4(renderComponent->material->shader, "view", w2v);
     setMat4(renderComponent->material->shader, "projection", camera->projectionMatrix);
 	setMat4(renderComponent->material->shader, "lightMatrix", lightMatrix);
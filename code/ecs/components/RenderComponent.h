@@ -24,13 +24,12 @@ struct RenderComponent : public IComponent
     static constexpr bool multipleAllowedPerEntity = true;
 };
 
-void drawRenderComponent(RenderComponent* renderComponent, ITransform *xfm,  ICamera* camera, ITransform *cameraXfm, uint32 shadowMapTextureId, Mat4& lightMatrix);
+void drawRenderComponent(RenderComponent* renderComponent, Mat4* modelToWorld, ICamera* camera, ITransform *cameraXfm, uint32 shadowMapTextureId, Mat4& lightMatrix);
 void drawRenderComponentWithBoundShader(RenderComponent* renderComponent);
 
 Mesh* getMesh(Entity e);
 
-template<int BUCKET_SIZE>
-void initRenderComponents(ComponentGroup<RenderComponent, BUCKET_SIZE>* renderComponentGroup, Mesh* mesh)
+inline void initRenderComponents(ComponentGroup<RenderComponent>* renderComponentGroup, Mesh* mesh)
 {
     assert(renderComponentGroup->numComponents == mesh->submeshes.size());
 
@@ -329,6 +329,17 @@ TerrainComponent::TerrainComponent(Entity entity, FilenameString heightMapFile,
     }
 }
 
+void TerrainComponent::onMoveComponent()
+{
+    for (auto& row : this->chunks)
+    {
+        for (TerrainChunk& chunk : row)
+        {
+            chunk.terrainComponent = this;
+        }
+    }
+}
+
 uint32 xVerticesInChunk(TerrainChunk* chunk)
 {
     uint32 result = chunk->terrainComponent->xVerticesPerChunk + (chunk->hasExtraXVertex ? 1 : 0);
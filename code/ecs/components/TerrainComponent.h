@@ -64,6 +64,8 @@ struct TerrainComponent : public IComponent
     std::vector<std::vector<TerrainChunk>> chunks;
 
     static constexpr bool multipleAllowedPerEntity = true;
+
+    void onMoveComponent() override;
 };
 
 uint32 xVerticesInChunk(TerrainChunk* chunk);
@@ -31,6 +31,14 @@ TransformComponent::TransformComponent(Entity e, Vec3 position, Quaternion orien
 
 ITransform* TransformComponent::getParent()
 {
+    TransformHierarchy* hierarchy = &this->entity.ecs->transformHierarchy;
+    if (!hierarchy->isDirty)
+    {
+        int32 parentIndex = hierarchy->parentIndices[this->hierarchyIndex];
+        return (parentIndex >= 0) ? hierarchy->transforms[parentIndex] : nullptr;
+    }
+
+    // Something was reparented, added or removed since the last rebuild. Look it up the slow way
     PotentiallyStaleEntity parent = ::getParent(this->entity);
     TransformComponent* result = getComponent<TransformComponent>(getEntity(getGame(this->entity), &parent));
     return result;
@@ -40,7 +48,20 @@ std::vector<ITransform*> TransformComponent::getChildren()
 {
     std::vector<ITransform*> result;
 
-    
+    TransformHierarchy* hierarchy = &this->entity.ecs->transformHierarchy;
+    if (!hierarchy->isDirty)
+    {
+        uint32 firstChild = hierarchy->firstChildIndices[this->hierarchyIndex];
+        uint32 childCount = hierarchy->childCounts[this->hierarchyIndex];
+
+        for (uint32 i = firstChild; i < firstChild + childCount; i++)
+        {
+            result.push_back(hierarchy->transforms[i]);
+        }
+
+        return result;
+    }
+
     for (auto e : *::getChildren(this->entity))
     {
         TransformComponent* xfm = getComponent<TransformComponent>(getEntity(getGame(this->entity), &e));
@@ -53,3 +74,53 @@ std::vector<ITransform*> TransformComponent::getChildren()
     
     return result;
 }
+
+void TransformComponent::markSelfAndChildrenDirty()
+{
+    // Whatever moves with a transform has to be refit in the picking tree. ECSs that aren't a scene's (the editor's
+    // pseudo ECS) don't have one.
+    Scene* scene = this->entity.ecs->scene;
+    PickingTree* pickingTree = scene ? &scene->pickingTree : nullptr;
+
+    TransformHierarchy* hierarchy = &this->entity.ecs->transformHierarchy;
+    if (hierarchy->isDirty)
+    {
+        // Recurses back into here for each child
+        if (pickingTree) markPickingEntityDirty(pickingTree, this->entity);
+        ITransform::markSelfAndChildrenDirty();
+        return;
+    }
+
+    //
+    // The hierarchy is breadth first, so the descendants at each depth are one contiguous range: the children of
+    // the first node in the range through the children of the last one
+    //
+    uint32 begin = this->hierarchyIndex;
+    uint32 end = begin + 1;
+
+    while (begin < end)
+    {
+        for (uint32 i = begin; i < end; i++)
+        {
+            hierarchy->transforms[i]->markSelfDirty();
+            hierarchy->worldMatrixDirty[i] = 1;
+            if (pickingTree) markPickingEntityDirty(pickingTree, hierarchy->transforms[i]->entity);
+        }
+
+        uint32 nextBegin = hierarchy->firstChildIndices[begin];
+        uint32 nextEnd = hierarchy->firstChildIndices[end - 1] + hierarchy->childCounts[end - 1];
+
+        begin = nextBegin;
+        end = nextEnd;
+    }
+}
+
+void TransformComponent::onMoveComponent()
+{
+    // hierarchyIndex came along with the move, so the hierarchy only needs to be pointed at the new address
+    TransformHierarchy* hierarchy = &this->entity.ecs->transformHierarchy;
+    if (!hierarchy->isDirty)
+    {
+        hierarchy->transforms[this->hierarchyIndex] = this;
+    }
+}
@@ -16,6 +16,12 @@ struct TransformComponent : public IComponent, public ITransform
 
     virtual ITransform* getParent() override;
     virtual std::vector<ITransform*> getChildren() override;
+    virtual void markSelfAndChildrenDirty() override;
+
+    void onMoveComponent() override;
+
+    // Index in the ECS's TransformHierarchy. Only valid while the hierarchy isn't dirty.
+    uint32 hierarchyIndex = 0;
 
     static constexpr bool multipleAllowedPerEntity = false;
 };
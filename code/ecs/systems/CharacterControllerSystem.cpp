@@ -0,0 +1,471 @@
+#include "CharacterControllerSystem.h"
+
+#include "ecs/Ecs.h"
+
+#include "ecs/components/AgentComponent.h"
+#include "ecs/components/ColliderComponent.h"
+#include "ecs/components/ConvexHullColliderComponent.h"
+#include "ecs/components/TransformComponent.h"
+
+#include "Aabb.h"
+#include "ConvexHull.h"
+#include "Gjk.h"
+#include "ContactManifold.h"
+#include "Narrowphase.h"
+#include "ecs/systems/CollisionSystem.h"
+
+#include "als/als_job_system.h"
+
+#include <algorithm>
+#include <vector>
+
+#define CHARACTER_ACCELERATION 45.0f
+#define CHARACTER_FRICTION 6.0f
+#define CHARACTER_JUMP_VELOCITY 20.0f
+#define CHARACTER_GRAVITY -30.0f
+#define CHARACTER_DRAG 1.0f
+
+// How far below it an agent that was grounded looks for the ground, per unit of horizontal speed (e.g., walking down a ramp)
+#define CHARACTER_SNAP_FACTOR 0.1f
+
+// Sweeps stop this far short of a hit, so the next one doesn't start out touching it
+#define CHARACTER_SKIN 0.001f
+#define CHARACTER_MAX_SLIDES 3
+
+// Candidates are gathered this much further out than the agent can move in a frame, to cover being pushed out of things
+#define CHARACTER_CANDIDATE_MARGIN 0.5f
+
+// Pushes out of overlaps are solved over every contact point at once, this many times round
+#define CHARACTER_SOLVER_ITERATIONS 4
+
+// Pushes go this much further than the overlap, so the agent doesn't end up exactly touching
+#define CHARACTER_PUSH_OUT_FACTOR 1.0005f
+
+// Agents per job
+#define CHARACTER_BATCH_SIZE 8
+
+namespace
+{
+    //
+    // An agent's collider, moved by offset without touching its transform. Every agent moves at once, and writing a
+    // transform marks the shared transform hierarchy dirty, so they all stay put until the write back.
+    //
+    struct MovedCollider : public ICollider
+    {
+        ICollider* collider = nullptr;
+        Vec3 offset;
+
+        Vec3 center() override
+        {
+            return this->collider->center() + this->offset;
+        }
+
+        // The collider it stands in for's, so its pairs are cached under the real collider
+        ColliderKey colliderKey() override
+        {
+            return this->collider->colliderKey();
+        }
+
+        Vec3 support(Vec3 direction, HullSupportWarmStart* warmStart) override
+        {
+            return this->collider->support(direction, warmStart) + this->offset;
+        }
+
+        uint32 supportFeature(Vec3 direction, float32 tolerance, Vec3* out, uint32 maxCount, HullSupportWarmStart* warmStart) override
+        {
+            uint32 count = this->collider->supportFeature(direction, tolerance, out, maxCount, warmStart);
+            for (uint32 i = 0; i < count; i++) out[i] += this->offset;
+            return count;
+        }
+
+        PrimitiveShape primitiveShape() override
+        {
+            PrimitiveShape result = this->collider->primitiveShape();
+
+            // Hull planes point into the collider's own world space cache, which can't be moved. GJK handles it.
+            if (result.type == PrimitiveShapeType::HULL) return PrimitiveShape();
+
+            result.center += this->offset;
+            result.segmentA += this->offset;
+            result.segmentB += this->offset;
+            return result;
+        }
+    };
+
+    struct AgentStep
+    {
+        AgentComponent* agent;
+        TransformComponent* xfm;
+
+        // collider.collider is nullptr if the agent doesn't have one. collider.offset is how far it has moved so far.
+        MovedCollider collider;
+
+        // This agent's range in CharacterBatch::candidates
+        uint32 firstCandidate = 0;
+        uint32 candidateCount = 0;
+
+        Quaternion orientation;
+
+        // Everything the agent was pushed out of, with the pushes it took. Stored in the manifold cache in the write back.
+        std::vector<ContactManifold> contacts;
+    };
+
+    struct CharacterBatch
+    {
+        std::vector<AgentStep> steps;
+
+        // Every agent's candidates, back to back
+        std::vector<ICollider*> candidates;
+        std::vector<GjkCache*> candidateCaches;
+
+        // Only read while agents move, for warm starting their contacts
+        ContactManifoldCache* manifolds;
+    };
+
+    Vec2 walkAcceleration(AgentComponent* agent)
+    {
+        Vec2 move = agent->intent.move;
+        if (length(move) > 1) move.normalizeInPlace();
+
+        return CHARACTER_ACCELERATION * move - CHARACTER_FRICTION * agent->velocity;
+    }
+
+    float32 gravityAcceleration(float32 yVelocity)
+    {
+        return CHARACTER_GRAVITY - CHARACTER_DRAG * yVelocity;
+    }
+
+    //
+    // How far the agent could get this frame, in any direction: the walk, gravity (or the jump) and the snap to ground,
+    // if none of them hit anything.
+    //
+    float32 agentReach(AgentComponent* agent, float32 deltaTS)
+    {
+        Vec2 acceleration = walkAcceleration(agent);
+        Vec2 walk = 0.5 * acceleration * deltaTS * deltaTS + agent->velocity * deltaTS;
+
+        float32 yVelocity = (agent->isGrounded && agent->intent.jump) ? CHARACTER_JUMP_VELOCITY : agent->yVelocity;
+        float32 fall = 0.5 * gravityAcceleration(yVelocity) * deltaTS * deltaTS + yVelocity * deltaTS;
+
+        float32 snap = CHARACTER_SNAP_FACTOR * length(agent->velocity + acceleration * deltaTS);
+
+        return length(walk) + fabs(fall) + snap;
+    }
+
+    //
+    // Pushes the agent out of everything it overlaps where it is now. Each overlap gets a contact manifold, and the push
+    // is solved against all of their points together, so being pushed out of one collider into another one it was also
+    // overlapping (a floor and a wall, say) is settled in this call. Returns whether it overlapped anything.
+    //
+    // The points warm start from the pair's manifold last frame, so an agent resting on something starts out at last
+    // frame's push and only needs the iterations to correct it.
+    //
+    // @Note: Anything the agent only overlaps after being pushed is picked up by the next call, not this one.
+    //
+    bool resolveCollisions(CharacterBatch* batch, AgentStep* step)
+    {
+        if (!step->collider.collider) return false;
+
+        uint32 firstContact = step->contacts.size();
+
+        for (uint32 i = step->firstCandidate; i < step->firstCandidate + step->candidateCount; i++)
+        {
+            GjkResult collisionResult = narrowphase(&step->collider, batch->candidates[i], true, batch->candidateCaches[i]);
+            if (!collisionResult.collides) continue;
+
+            step->contacts.emplace_back();
+            ContactManifold* manifold = &step->contacts.back();
+            buildContactManifold(&step->collider, batch->candidates[i], &collisionResult, manifold);
+
+            // Built where the agent is now, but kept under its real collider
+            manifold->a = step->collider.collider;
+
+            ContactManifold* old = findContactManifold(batch->manifolds, manifold->a, manifold->b);
+            if (old) warmStartContactManifold(old, manifold);
+        }
+
+        if (step->contacts.size() == firstContact) return false;
+
+        //
+        // Every point's normalImpulse is how far it has pushed the agent along -normal, which separates all the points of
+        // its manifold by that much. Each iteration tops every point up to its depth, given what the others already push,
+        // and never lets one pull.
+        //
+        Vec3 push(0, 0, 0);
+
+        for (uint32 i = firstContact; i < step->contacts.size(); i++)
+        {
+            ContactManifold* manifold = &step->contacts[i];
+            for (uint32 j = 0; j < manifold->pointCount; j++)
+            {
+                push -= manifold->normal * manifold->points[j].normalImpulse;
+            }
+        }
+
+        for (uint32 iteration = 0; iteration < CHARACTER_SOLVER_ITERATIONS; iteration++)
+        {
+            for (uint32 i = firstContact; i < step->contacts.size(); i++)
+            {
+                ContactManifold* manifold = &step->contacts[i];
+                for (uint32 j = 0; j < manifold->pointCount; j++)
+                {
+                    ContactPoint* point = &manifold->points[j];
+
+                    float32 separation = -dot(push, manifold->normal);
+                    float32 impulse = fmax(0, point->normalImpulse + point->depth * CHARACTER_PUSH_OUT_FACTOR - separation);
+
+                    push -= manifold->normal * (impulse - point->normalImpulse);
+                    point->normalImpulse = impulse;
+                }
+            }
+        }
+
+        step->collider.offset += push;
+
+        return true;
+    }
+
+    //
+    // Moves the agent by displacement, stopping where its collider would first touch something on the way instead of
+    // stepping over it. If slide is set, what's left of displacement after a hit carries on along the surface. Returns
+    // whether it hit anything.
+    //
+    // Anything the agent already overlaps doesn't stop it. That's left for resolveCollisions(..).
+    //
+    bool sweepMove(CharacterBatch* batch, AgentStep* step, Vec3 displacement, bool slide)
+    {
+        bool hit = false;
+
+        for (uint32 slideIndex = 0; slideIndex < CHARACTER_MAX_SLIDES; slideIndex++)
+        {
+            float32 distance = length(displacement);
+
+            if (!step->collider.collider || distance <= CHARACTER_SKIN)
+            {
+                step->collider.offset += displacement;
+                break;
+            }
+
+            GjkSweepResult first;
+            for (uint32 i = step->firstCandidate; i < step->firstCandidate + step->candidateCount; i++)
+            {
+                GjkSweepResult sweep = gjkSweep(&step->collider, displacement, batch->candidates[i], batch->candidateCaches[i]);
+
+                // A zero normal means it's already overlapping
+                if (sweep.hit && !isZeroVector(sweep.normal) && (!first.hit || sweep.t < first.t))
+                {
+                    first = sweep;
+                }
+            }
+
+            if (!first.hit)
+            {
+                step->collider.offset += displacement;
+                break;
+            }
+
+            hit = true;
+
+            float32 t = fmax(0, first.t - CHARACTER_SKIN / distance);
+            step->collider.offset += displacement * t;
+
+            if (!slide) break;
+
+            Vec3 remaining = displacement * (1 - t);
+            displacement = remaining - first.normal * dot(remaining, first.normal);
+        }
+
+        return hit;
+    }
+
+    // Runs on a worker. Writes only to step and its agent.
+    void stepAgent(CharacterBatch* batch, AgentStep* step, float32 deltaTS)
+    {
+        AgentComponent* agent = step->agent;
+
+        //
+        // Move (w/o gravity)
+        //
+        {
+            Vec2 acceleration = walkAcceleration(agent);
+
+            sweepMove(batch, step, 0.5 * Vec3(acceleration.x, 0, acceleration.y) * deltaTS * deltaTS + Vec3(agent->velocity.x, 0, agent->velocity.y) * deltaTS, true);
+
+            resolveCollisions(batch, step);
+
+            agent->velocity += acceleration * deltaTS;
+            float32 yaw = TO_DEG(atan2(-agent->velocity.y, agent->velocity.x));
+            step->orientation = axisAngle(Vec3(0, 1, 0), yaw - 90);
+        }
+
+        //
+        // Apply gravity / jump
+        //
+        if (agent->isGrounded && agent->intent.jump)
+        {
+            agent->yVelocity = CHARACTER_JUMP_VELOCITY;
+            agent->isGrounded = false;
+        }
+
+        agent->intent.jump = false; // Used up, whether or not it could jump
+
+        float32 gravAccel = gravityAcceleration(agent->yVelocity);
+        Vec3 gravAccelVector = Vec3(0, gravAccel, 0);
+        Vec3 gravVelVector = Vec3(0, agent->yVelocity, 0);
+
+        Vec3 offsetBeforeGravity = step->collider.offset;
+        bool hitDuringGravity = sweepMove(batch, step, 0.5 * gravAccelVector * deltaTS * deltaTS + gravVelVector * deltaTS, true);
+
+        // The sweep stops short of what it hits, so it won't be overlapping it afterwards. Either one counts.
+        if (resolveCollisions(batch, step) || hitDuringGravity)
+        {
+            //
+            // On ground
+            //
+
+            if (agent->isGrounded)
+            {
+                step->collider.offset = offsetBeforeGravity; // Was grounded, is still grounded. Undo the gravity step as it could have pushed it in a direction, such as "down" a ramp
+            }
+
+            agent->isGrounded = true;
+            agent->yVelocity = 0;
+        }
+        else
+        {
+            //
+            // In air
+            //
+
+            if (agent->isGrounded)
+            {
+                //
+                // Try to snap to ground (e.g., walking down ramp)
+                //
+                float32 snapDistance = CHARACTER_SNAP_FACTOR * length(agent->velocity);
+
+                Vec3 offsetBeforeSnap = step->collider.offset;
+
+                if (sweepMove(batch, step, Vec3(0, -1, 0) * snapDistance, false))
+                {
+                    // snap succeeded
+                }
+                else
+                {
+                    agent->isGrounded = false; // Gravity will apply next turn
+                    step->collider.offset = offsetBeforeSnap;
+                }
+            }
+
+            agent->yVelocity += gravAccel * deltaTS;
+        }
+    }
+}
+
+void updateCharacterControllers(Ecs* ecs, JobSystem* jobs, float32 deltaTS)
+{
+    // @Slow: Allocates every frame. Fine for a few hundred agents, but could be kept around on the Ecs.
+    CharacterBatch batch;
+    batch.manifolds = &ecs->contactManifolds;
+
+    ArchetypeQuery query;
+    query.all = componentBit(ComponentType::Transform) | componentBit(ComponentType::Agent);
+
+    //
+    // Gather. Each agent queries the broadphase once, for everywhere it could get to this frame, instead of once per
+    // sweep and push out.
+    //
+    // updateBroadphase(..) ran before this system, which also brought every collider's cached transform values up to
+    // date. Nothing writes a transform until the write back, so the parallel pass only reads them.
+    //
+    // @Note: With sweep and prune this moves each agent's proxy, so nothing else may touch the broadphase while this
+    //        system runs. The only other system that does (updateBroadphase) writes colliders, so the scheduler already
+    //        keeps them apart. gjkCacheForPair(..) isn't thread safe either, so the caches are looked up here too.
+    //
+    {
+        std::vector<ICollider*> agentColliders;
+
+        forEachArchetypeChunk(ecs, query, [&](ArchetypeChunk* chunk)
+        {
+            for (uint32 row = 0; row < chunk->count; row++)
+            {
+                EntityDetails* details = getComponent<EntityDetails>(chunk->entities[row]);
+                assert((details->flags & EntityFlag_Static) == 0); // only dynamic object can walk!
+
+                batch.steps.emplace_back();
+                AgentStep* step = &batch.steps.back();
+                step->agent = chunkComponent<AgentComponent>(chunk, row);
+                step->xfm = chunkComponent<TransformComponent>(chunk, row);
+                step->orientation = step->xfm->orientation();
+
+                if (chunkComponentCount<ColliderComponent>(chunk, row) == 0) continue;
+
+                ColliderComponent* collider = chunkComponent<ColliderComponent>(chunk, row);
+                step->collider.collider = collider;
+
+                // The agent's own colliders are in the collider tree too
+                agentColliders.clear();
+                for (uint32 i = 0; i < chunkComponentCount<ColliderComponent>(chunk, row); i++)
+                {
+                    agentColliders.push_back(chunkComponent<ColliderComponent>(chunk, row, i));
+                }
+
+                for (uint32 i = 0; i < chunkComponentCount<ConvexHullColliderComponent>(chunk, row); i++)
+                {
+                    agentColliders.push_back(chunkComponent<ConvexHullColliderComponent>(chunk, row, i));
+                }
+
+                Aabb bounds = aabbFromCollider(collider);
+                bounds.halfDim += Vec3(agentReach(step->agent, deltaTS) + CHARACTER_CANDIDATE_MARGIN);
+
+                step->firstCandidate = batch.candidates.size();
+                gatherBroadphaseCandidates(ecs, collider, bounds, &batch.candidates);
+
+                batch.candidates.erase(
+                    std::remove_if(batch.candidates.begin() + step->firstCandidate, batch.candidates.end(), [&agentColliders](ICollider* candidate)
+                    {
+                        if (candidate->isTrigger) return true;
+                        return std::find(agentColliders.begin(), agentColliders.end(), candidate) != agentColliders.end();
+                    }),
+                    batch.candidates.end());
+
+                step->candidateCount = batch.candidates.size() - step->firstCandidate;
+
+                for (uint32 i = step->firstCandidate; i < batch.candidates.size(); i++)
+                {
+                    batch.candidateCaches.push_back(gjkCacheForPair(&ecs->gjkCache, collider, batch.candidates[i]));
+                }
+            }
+        });
+    }
+
+    //
+    // Move. Every agent only writes its own step, AgentComponent and the GjkCaches of its own pairs, and only reads the
+    // manifold cache. Hull warm starts live in those caches, so agents that share a hull (the level, mostly) don't share
+    // a warm start, and each one's results only depend on its own pairs' history, not on which agents ran first.
+    //
+    parallelFor(jobs, batch.steps.size(), CHARACTER_BATCH_SIZE, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; i++)
+        {
+            stepAgent(&batch, &batch.steps[i], deltaTS);
+        }
+    });
+
+    //
+    // Write back, in the same order they were gathered.
+    //
+    // @Note: An agent touching another agent was solved against where that one was before anything moved, and that's
+    //        the manifold that's kept.
+    //
+    for (AgentStep& step : batch.steps)
+    {
+        for (ContactManifold& manifold : step.contacts)
+        {
+            storeContactManifold(&ecs->contactManifolds, &manifold);
+        }
+
+        step.xfm->setPosition(step.xfm->position() + step.collider.offset);
+        step.xfm->setOrientation(step.orientation);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "als/als_types.h"
+
+struct Ecs;
+struct JobSystem;
+
+//
+// Moves every agent (entities with an AgentComponent and a transform) by its intent: walking, jumping, gravity and
+// snapping to the ground, colliding with the world and each other. In three passes:
+//
+//  1. Serially, each agent gathers broadphase candidates once for everywhere it could get to this frame.
+//  2. In parallel, each agent moves against its own candidates. Nothing writes a transform, so every agent sees the
+//     others where they were at the start of the frame.
+//  3. Serially, in the same order every frame, the results are written to the transforms and contact manifolds.
+//
+// The results don't depend on how the agents were split between workers.
+//
+void updateCharacterControllers(Ecs* ecs, JobSystem* jobs, float32 deltaTS);
@@ -0,0 +1,196 @@
+#include "CollisionSystem.h"
+
+#include "ecs/Ecs.h"
+#include "ecs/components/ColliderComponent.h"
+#include "ecs/components/ConvexHullColliderComponent.h"
+
+#include "Aabb.h"
+#include "AabbTree.h"
+#include "SweepAndPrune.h"
+#include "StaticCollisionWorld.h"
+#include "Gjk.h"
+#include "ContactManifold.h"
+
+namespace
+{
+    bool proxyIsStale(ICollider* collider, uint32 worldVersion)
+    {
+        return collider->broadphaseProxy < 0 || collider->proxyBoundsDirty || collider->proxyWorldVersion != worldVersion;
+    }
+
+    void updateProxy(Ecs* ecs, ICollider* collider, Aabb bounds, uint32 worldVersion)
+    {
+        collider->proxyWorldVersion = worldVersion;
+        collider->proxyBoundsDirty = false;
+
+        switch (ecs->broadphase)
+        {
+            case Broadphase::AabbTree:
+            {
+                if (collider->broadphaseProxy < 0)
+                {
+                    collider->broadphaseProxy = insertProxy(&ecs->colliderTree, bounds, collider);
+                }
+                else
+                {
+                    moveProxy(&ecs->colliderTree, collider->broadphaseProxy, bounds);
+                }
+            } break;
+
+            case Broadphase::SweepAndPrune:
+            {
+                if (collider->broadphaseProxy < 0)
+                {
+                    collider->broadphaseProxy = addSapProxy(&ecs->colliderSap, bounds, collider);
+                }
+                else
+                {
+                    moveSapProxy(&ecs->colliderSap, collider->broadphaseProxy, bounds);
+                }
+            } break;
+
+            default: assert(false);
+        }
+    }
+}
+
+void updateBroadphase(Ecs* ecs)
+{
+    ageGjkPairCache(&ecs->gjkCache);
+    ageContactManifoldCache(&ecs->contactManifolds);
+
+    if (ecs->staticCollisionWorld.needsRebake)
+    {
+        bakeStaticCollisionWorld(ecs);
+    }
+
+    //
+    // Only colliders whose transforms moved since their proxies were last refit need new bounds. Everything else is
+    // skipped without computing them.
+    //
+    ArchetypeQuery query;
+    query.any = componentBit(ComponentType::Collider) | componentBit(ComponentType::ConvexHullCollider);
+
+    forEachArchetypeChunk(ecs, query, [ecs](ArchetypeChunk* chunk)
+    {
+        for (uint32 row = 0; row < chunk->count; row++)
+        {
+            uint32 worldVersion = chunkComponent<TransformComponent>(chunk, row)->worldVersion();
+
+            for (uint32 i = 0; i < chunkComponentCount<ColliderComponent>(chunk, row); i++)
+            {
+                ColliderComponent* collider = chunkComponent<ColliderComponent>(chunk, row, i);
+                if (collider->isBaked || !proxyIsStale(collider, worldVersion)) continue;
+
+                updateProxy(ecs, collider, aabbFromCollider(collider), worldVersion);
+            }
+
+            for (uint32 i = 0; i < chunkComponentCount<ConvexHullColliderComponent>(chunk, row); i++)
+            {
+                ConvexHullColliderComponent* collider = chunkComponent<ConvexHullColliderComponent>(chunk, row, i);
+                if (collider->isBaked) continue;
+
+                // Done here so that the narrowphase, which runs in parallel, only ever reads the cached positions. Does
+                // nothing if the transform didn't move.
+                updateWorldPositions(collider);
+
+                if (!proxyIsStale(collider, worldVersion)) continue;
+
+                updateProxy(ecs, collider, aabbFromConvexCollider(collider), worldVersion);
+            }
+        }
+    });
+}
+
+void setBroadphase(Ecs* ecs, Broadphase broadphase)
+{
+    if (ecs->broadphase == broadphase) return;
+
+    forEachComponent<ColliderComponent>(ecs, [](ColliderComponent* collider) { collider->broadphaseProxy = -1; });
+    forEachComponent<ConvexHullColliderComponent>(ecs, [](ConvexHullColliderComponent* collider) { collider->broadphaseProxy = -1; });
+
+    clearAabbTree(&ecs->colliderTree);
+    clearSweepAndPrune(&ecs->colliderSap);
+
+    ecs->broadphase = broadphase;
+}
+
+void markColliderBoundsDirty(ICollider* collider)
+{
+    collider->proxyBoundsDirty = true;
+}
+
+void onColliderRemoved(Ecs* ecs, ICollider* collider)
+{
+    if (collider->isBaked)
+    {
+        // Its baked copy goes away on the next rebake
+        markStaticCollisionWorldDirty(ecs);
+        collider->isBaked = false;
+    }
+
+    removeColliderProxy(ecs, collider);
+}
+
+void removeColliderProxy(Ecs* ecs, ICollider* collider)
+{
+    if (collider->broadphaseProxy < 0) return;
+
+    switch (ecs->broadphase)
+    {
+        case Broadphase::AabbTree: removeProxy(&ecs->colliderTree, collider->broadphaseProxy); break;
+        case Broadphase::SweepAndPrune: removeSapProxy(&ecs->colliderSap, collider->broadphaseProxy); break;
+        default: assert(false);
+    }
+
+    collider->broadphaseProxy = -1;
+}
+
+void onColliderMoved(Ecs* ecs, ICollider* collider)
+{
+    if (collider->broadphaseProxy < 0) return;
+
+    switch (ecs->broadphase)
+    {
+        case Broadphase::AabbTree: setProxyUserData(&ecs->colliderTree, collider->broadphaseProxy, collider); break;
+        case Broadphase::SweepAndPrune: setSapProxyUserData(&ecs->colliderSap, collider->broadphaseProxy, collider); break;
+        default: assert(false);
+    }
+}
+
+void gatherBroadphaseCandidates(Ecs* ecs, ICollider* collider, Aabb bounds, std::vector<ICollider*>* candidates)
+{
+    assert(collider->broadphaseProxy >= 0);
+
+    queryStaticOverlap(&ecs->staticCollisionWorld, bounds, [candidates](StaticCollider* staticCollider)
+    {
+        candidates->push_back(staticCollider);
+    });
+
+    switch (ecs->broadphase)
+    {
+        case Broadphase::AabbTree:
+        {
+            queryOverlap(&ecs->colliderTree, bounds, [collider, candidates](int32 proxy, void* userData)
+            {
+                if (userData != collider) candidates->push_back((ICollider*)userData);
+            });
+        } break;
+
+        case Broadphase::SweepAndPrune:
+        {
+            SweepAndPrune* sap = &ecs->colliderSap;
+            int32 proxy = collider->broadphaseProxy;
+
+            moveSapProxy(sap, proxy, bounds);
+
+            // The move updates the proxy's pairs, so its overlaps are exactly what bounds touches
+            forEachSapOverlap(sap, proxy, [sap, candidates](int32 other)
+            {
+                candidates->push_back((ICollider*)sapProxyUserData(sap, other));
+            });
+        } break;
+
+        default: assert(false);
+    }
+}
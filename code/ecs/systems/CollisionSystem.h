@@ -0,0 +1,36 @@
+#pragma once
+
+#include "als/als_types.h"
+
+#include <vector>
+
+struct Aabb;
+struct Ecs;
+struct ICollider;
+enum class Broadphase : uint8;
+
+// Adds new colliders to the ECS's broadphase and refits the ones whose transforms moved
+void updateBroadphase(Ecs* ecs);
+
+// Throws away the current broadphase's proxies. The next updateBroadphase(..) adds everything to the new one.
+void setBroadphase(Ecs* ecs, Broadphase broadphase);
+
+// For changes to a collider's bounds that its transform doesn't know about, like the editor resizing it. Its proxy is
+// refit by the next updateBroadphase(..).
+void markColliderBoundsDirty(ICollider* collider);
+
+// Called when a collider is removed from the ECS
+void onColliderRemoved(Ecs* ecs, ICollider* collider);
+
+void removeColliderProxy(Ecs* ecs, ICollider* collider);
+
+// Called when the ECS moves a collider to a new address, so its proxy points at the new one
+void onColliderMoved(Ecs* ecs, ICollider* collider);
+
+//
+// Appends the colliders that might touch collider, whose current bounds are given, to candidates. collider must already
+// be in the broadphase. Candidates from the static collision world are its baked StaticColliders, not the components.
+//
+// With sweep and prune this moves collider's proxy to the new bounds.
+//
+void gatherBroadphaseCandidates(Ecs* ecs, ICollider* collider, Aabb bounds, std::vector<ICollider*>* candidates);
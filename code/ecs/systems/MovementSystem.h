@@ -1,3 +1,4 @@
 struct Game;
 
-void walkAndCamera(Game* game);
+// Turns the joystick into the player's AgentIntent, relative to the active camera
+void updatePlayerIntent(Game* game);
@@ -1,5 +1,3 @@
-#include "als/als_bucket_array.h"
-
 #include "Quad.h"
 #include "DebugDraw.h"
 #include "RenderSystem.h"
@@ -16,6 +14,7 @@
 #include "Game.h"
 
 #include <string>
+#include <vector>
 
 void initRenderer(Renderer* renderer, Window* window)
 {
@@ -44,13 +43,12 @@ PointLightComponent* closestPointLight(Ecs* ecs, ITransform* xfm)
     PointLightComponent* closest = nullptr;
     float32 closestDistance = FLT_MAX;
 
-    FOR_BUCKET_ARRAY (ecs->pointLights.components)
+    forEachComponent<PointLightComponent>(ecs, [xfm, &closest, &closestDistance](PointLightComponent* pl)
     {
-        PointLightComponent* pl = it.ptr;
         TransformComponent* plXfm = getComponent<TransformComponent>(pl->entity);
 
         assert(plXfm != nullptr);
-        if (plXfm == nullptr) continue;
+        if (plXfm == nullptr) return;
         
         float32 dist = distance(xfm->position(), plXfm->position());
 
@@ -59,7 +57,7 @@ PointLightComponent* closestPointLight(Ecs* ecs, ITransform* xfm)
             closestDistance = dist;
             closest = pl;
         }
-    }
+    });
 
     return closest;
 }
@@ -69,11 +67,14 @@ void renderAllRenderComponents(Renderer* renderer, Ecs* ecs, CameraComponent* ca
     // TODO: better way of picking which directional light to use for shadow mapping?
     Mat4 lightMatrix;
 
-    if (ecs->directionalLights.count() > 0)
+    std::vector<DirectionalLightComponent*> directionalLights;
+    forEachComponent<DirectionalLightComponent>(ecs, [&directionalLights](DirectionalLightComponent* dlc) { directionalLights.push_back(dlc); });
+
+    if (directionalLights.size() > 0)
     {
         const uint32 farAway = 40;
 
-        DirectionalLightComponent* dirLight = &ecs->directionalLights[0];
+        DirectionalLightComponent* dirLight = directionalLights[0];
 
         // TODO: cache these on the light itself?
         Camera lightCamera;
@@ -116,17 +117,27 @@ void renderAllRenderComponents(Renderer* renderer, Ecs* ecs, CameraComponent* ca
 
             if (!renderingViaPortal) // TODO: figure out this story
             {
-                FOR_BUCKET_ARRAY(ecs->renderComponents.components)
-                {
-                    RenderComponent &rc = *it.ptr;
-                    if (!rc.isVisible) continue;
-
-                    TransformComponent* xfm = getComponent<TransformComponent>(rc.entity);
-                    Mat4 m2w = xfm->matrix();;
-                    setMat4(simpleDepthShader, "model", m2w);
+                ArchetypeQuery query;
+                query.all = componentBit(ComponentType::Transform) | componentBit(ComponentType::Render);
 
-                    drawRenderComponentWithBoundShader(&rc);
-                }
+                forEachArchetypeChunk(ecs, query, [&](ArchetypeChunk* chunk)
+                {
+                    for (uint32 row = 0; row < chunk->count; row++)
+                    {
+                        TransformComponent* xfm = chunkComponent<TransformComponent>(chunk, row);
+                        Mat4* m2w = worldMatrix(&ecs->transformHierarchy, xfm);
+
+                        uint32 rcCount = chunkComponentCount<RenderComponent>(chunk, row);
+                        for (uint32 i = 0; i < rcCount; i++)
+                        {
+                            RenderComponent* rc = chunkComponent<RenderComponent>(chunk, row, i);
+                            if (!rc->isVisible) continue;
+
+                            setMat4(simpleDepthShader, "model", *m2w);
+                            drawRenderComponentWithBoundShader(rc);
+                        }
+                    }
+                });
             }
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -134,64 +145,75 @@ void renderAllRenderComponents(Renderer* renderer, Ecs* ecs, CameraComponent* ca
         glViewport(0, 0, camera->window->width, camera->window->height);
     }
 
-    FOR_BUCKET_ARRAY (ecs->renderComponents.components)
-    {
-        RenderComponent &rc = *it.ptr;
-        if (!rc.isVisible) continue;
-          
-        TransformComponent* xfm = getComponent<TransformComponent>(rc.entity);
-
-        if (renderingViaPortal)
-        {
-            bool behindDestPortal = dot(destPortalXfm->forward(), destPortalXfm->position() - xfm->position()) > 0;
-            if (behindDestPortal) continue;
-        }
+    ArchetypeQuery query;
+    query.all = componentBit(ComponentType::Transform) | componentBit(ComponentType::Render);
 
-        // TODO: Lighting is a total mess... figure out a better way to do it
-        if (rc.material->receiveLight)
+    forEachArchetypeChunk(ecs, query, [&](ArchetypeChunk* chunk)
+    {
+        for (uint32 row = 0; row < chunk->count; row++)
         {
-            PointLightComponent* pl = closestPointLight(ecs, xfm);
-            Shader* shader = rc.material->shader;
-            bind(shader);
+            TransformComponent* xfm = chunkComponent<TransformComponent>(chunk, row);
 
-            if (pl != nullptr)
-            {
-                TransformComponent* plXfm = getComponent<TransformComponent>(pl->entity);
-              
-                setVec3(shader, "pointLights[0].posWorld", plXfm->position());
-                setVec3(shader, "pointLights[0].intensity", pl->intensity);
-                setFloat(shader, "pointLights[0].attenuationConstant", pl->attenuationConstant);
-                setFloat(shader, "pointLights[0].attenuationLinear", pl->attenuationLinear);
-                setFloat(shader, "pointLights[0].attenuationQuadratic", pl->attenuationQuadratic);
-            }
-            else
+            if (renderingViaPortal)
             {
-                setVec3(shader, "pointLights[0].intensity", Vec3(0));
+                bool behindDestPortal = dot(destPortalXfm->forward(), destPortalXfm->position() - xfm->position()) > 0;
+                if (behindDestPortal) continue;
             }
 
-            FOR_BUCKET_ARRAY (ecs->directionalLights.components)
-            {
-                // TODO: what happens if the number of directional lights exceeds the number allowed in the shader?
-                // How can we guarantee it doesnt? Should we just hard code a limit that is the same as the limit
-                // in the shader? Is that robust when we change the shader?
-                DirectionalLightComponent* dlc = it.ptr;
-
-                string64 directionVarName = ("directionalLights[" + std::to_string(it.index) + "].direction").c_str();
-                string64 intensityVarName = ("directionalLights[" + std::to_string(it.index) + "].intensity").c_str();
-                  
-                setVec3(shader, directionVarName, dlc->direction);
-                setVec3(shader, intensityVarName, dlc->intensity);
-            }
+            Mat4* m2w = worldMatrix(&ecs->transformHierarchy, xfm);
 
-            if (ecs->directionalLights.count() == 0)
+            uint32 rcCount = chunkComponentCount<RenderComponent>(chunk, row);
+            for (uint32 i = 0; i < rcCount; i++)
             {
-                string64 intensityVarName = ("directionalLights[" + std::to_string(it.index) + "].intensity").c_str();
-                setVec3(shader, intensityVarName, Vec3(0, 0, 0));
+                RenderComponent* rc = chunkComponent<RenderComponent>(chunk, row, i);
+                if (!rc->isVisible) continue;
+
+                // TODO: Lighting is a total mess... figure out a better way to do it
+                if (rc->material->receiveLight)
+                {
+                    PointLightComponent* pl = closestPointLight(ecs, xfm);
+                    Shader* shader = rc->material->shader;
+                    bind(shader);
+
+                    if (pl != nullptr)
+                    {
+                        TransformComponent* plXfm = getComponent<TransformComponent>(pl->entity);
+
+                        setVec3(shader, "pointLights[0].posWorld", plXfm->position());
+                        setVec3(shader, "pointLights[0].intensity", pl->intensity);
+                        setFloat(shader, "pointLights[0].attenuationConstant", pl->attenuationConstant);
+                        setFloat(shader, "pointLights[0].attenuationLinear", pl->attenuationLinear);
+                        setFloat(shader, "pointLights[0].attenuationQuadratic", pl->attenuationQuadratic);
+                    }
+                    else
+                    {
+                        setVec3(shader, "pointLights[0].intensity", Vec3(0));
+                    }
+
+                    for (uint32 i = 0; i < directionalLights.size(); i++)
+                    {
+                        // TODO: what happens if the number of directional lights exceeds the number allowed in the shader?
+                        // How can we guarantee it doesnt? Should we just hard code a limit that is the same as the limit
+                        // in the shader? Is that robust when we change the shader?
+                        DirectionalLightComponent* dlc = directionalLights[i];
+
+                        string64 directionVarName = ("directionalLights[" + std::to_string(i) + "].direction").c_str();
+                        string64 intensityVarName = ("directionalLights[" + std::to_string(i) + "].intensity").c_str();
+
+                        setVec3(shader, directionVarName, dlc->direction);
+                        setVec3(shader, intensityVarName, dlc->intensity);
+                    }
+
+                    if (directionalLights.size() == 0)
+                    {
+                        setVec3(shader, "directionalLights[0].intensity", Vec3(0, 0, 0));
+                    }
+                }
+
+                drawRenderComponent(rc, m2w, camera, cameraXfm, renderer->shadowMap.textureId, lightMatrix);
             }
         }
-
-        drawRenderComponent(&rc, xfm, camera, cameraXfm, renderer->shadowMap.textureId, lightMatrix);
-    }
+    });
     
        // DEBUG:
        // Draw's shadowmap onto textured quad
@@ -233,13 +255,15 @@ void renderContentsOfAllPortals(Renderer* renderer, Scene* scene, CameraComponen
         return;
     }
 
-    FOR_BUCKET_ARRAY(scene->ecs.portals.components)
+    std::vector<PortalComponent*> portals;
+    forEachComponent<PortalComponent>(&scene->ecs, [&portals](PortalComponent* pc) { portals.push_back(pc); });
+
+    for (PortalComponent* pc : portals)
     {
         //
         // Calculate the position and orientation of the camera sitting in the dest scene and looking "through" the portal
         // into the dest scene.
         //
-        PortalComponent* pc = scene->ecs.portals.components.addressOf(it.locator);
         if (pc->connectedPortal.id == 0) continue;
 
         TransformComponent* sourceSceneXfm = getComponent<TransformComponent>(pc->entity);
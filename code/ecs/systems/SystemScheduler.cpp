@@ -0,0 +1,197 @@
+#include "SystemScheduler.h"
+#include "ecs/TransformHierarchy.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace
+{
+    ComponentMask allComponents()
+    {
+        return componentBit(ComponentType::ENUM_VALUE_COUNT) - 1;
+    }
+
+    void startSystem(SystemScheduler* scheduler, uint32 systemIndex);
+
+    void finishSystem(SystemScheduler* scheduler, uint32 systemIndex)
+    {
+        SystemDesc* system = &scheduler->systems[systemIndex];
+
+        // Structural systems dirty the transform hierarchy. Every later system on that ECS depends on this one, so
+        // rebuilding here (before any of them are released) keeps the rebuild from racing with their updates.
+        if ((system->flags & SystemFlag_Structural) && system->ecs)
+        {
+            rebuildTransformHierarchy(system->ecs);
+        }
+
+        // Same for the world values of the transforms it moved, so the systems that only read them don't refresh them
+        if ((system->writes & componentBit(ComponentType::Transform)) && system->ecs)
+        {
+            refreshWorldTransforms(scheduler->jobs, system->ecs);
+        }
+
+        std::vector<uint32> nowReady;
+
+        {
+            std::lock_guard<std::mutex> lock(scheduler->mutex);
+
+            for (uint32 dependent : scheduler->dependents[systemIndex])
+            {
+                assert(scheduler->unfinishedDependencyCount[dependent] > 0);
+                scheduler->unfinishedDependencyCount[dependent]--;
+
+                if (scheduler->unfinishedDependencyCount[dependent] == 0)
+                {
+                    nowReady.push_back(dependent);
+                }
+            }
+        }
+
+        for (uint32 dependent : nowReady)
+        {
+            startSystem(scheduler, dependent);
+        }
+
+        scheduler->finishedCount++;
+    }
+
+    void startSystem(SystemScheduler* scheduler, uint32 systemIndex)
+    {
+        if (scheduler->systems[systemIndex].flags & SystemFlag_MainThreadOnly)
+        {
+            std::lock_guard<std::mutex> lock(scheduler->mutex);
+            scheduler->readyForMainThread.push_back(systemIndex);
+        }
+        else
+        {
+            submitJob(scheduler->jobs, [scheduler, systemIndex]()
+            {
+                scheduler->systems[systemIndex].update();
+                finishSystem(scheduler, systemIndex);
+            }, nullptr);
+        }
+    }
+}
+
+void initSystemScheduler(SystemScheduler* scheduler, JobSystem* jobs)
+{
+    scheduler->jobs = jobs;
+}
+
+void clearSystems(SystemScheduler* scheduler)
+{
+    scheduler->systems.clear();
+}
+
+void addSystem(SystemScheduler* scheduler, SystemDesc system)
+{
+    assert(system.update);
+    assert(system.ecs || !(system.flags & SystemFlag_Structural)); // Structural systems need to say which transform hierarchy to rebuild
+
+    if (system.flags & SystemFlag_Structural)
+    {
+        system.writes = allComponents();
+    }
+
+    scheduler->systems.push_back(system);
+}
+
+bool systemsConflict(const SystemDesc& a, const SystemDesc& b)
+{
+    if ((a.flags & SystemFlag_Structural) && (b.flags & SystemFlag_Structural)) return true;
+
+    bool sameEcs = a.ecs == nullptr || b.ecs == nullptr || a.ecs == b.ecs;
+    if (!sameEcs) return false;
+
+    if (a.writes & (b.reads | b.writes)) return true;
+    if (b.writes & a.reads) return true;
+
+    return false;
+}
+
+void runSystems(SystemScheduler* scheduler)
+{
+    uint32 systemCount = scheduler->systems.size();
+    if (systemCount == 0) return;
+
+    //
+    // Build the graph. An edge i -> j for every conflicting pair with i < j keeps conflicting systems in
+    // the order they were added.
+    // @Slow: O(n^2), but n is the number of systems, not entities.
+    //
+    scheduler->dependents.assign(systemCount, std::vector<uint32>());
+    scheduler->unfinishedDependencyCount.assign(systemCount, 0);
+    scheduler->readyForMainThread.clear();
+    scheduler->finishedCount = 0;
+
+    for (uint32 j = 0; j < systemCount; j++)
+    {
+        for (uint32 i = 0; i < j; i++)
+        {
+            if (systemsConflict(scheduler->systems[i], scheduler->systems[j]))
+            {
+                scheduler->dependents[i].push_back(j);
+                scheduler->unfinishedDependencyCount[j]++;
+            }
+        }
+    }
+
+    // Updating world matrices rebuilds the transform hierarchy if it is dirty, which isn't safe to do from several
+    // systems at once. Get it out of the way up front, along with anything moved since the last run.
+    std::vector<Ecs*> ecss;
+    for (SystemDesc& system : scheduler->systems)
+    {
+        if (system.ecs && std::find(ecss.begin(), ecss.end(), system.ecs) == ecss.end())
+        {
+            ecss.push_back(system.ecs);
+        }
+    }
+
+    for (Ecs* ecs : ecss)
+    {
+        refreshWorldTransforms(scheduler->jobs, ecs);
+    }
+
+    // Collect the roots before starting any of them. Once one is running, it can release later systems, which
+    // would then look like roots too.
+    std::vector<uint32> roots;
+    for (uint32 i = 0; i < systemCount; i++)
+    {
+        if (scheduler->unfinishedDependencyCount[i] == 0) roots.push_back(i);
+    }
+
+    for (uint32 i : roots)
+    {
+        startSystem(scheduler, i);
+    }
+
+    //
+    // The main thread runs the main-thread-only systems, and helps out with the other jobs when it has nothing
+    // else to do
+    //
+    while (scheduler->finishedCount < systemCount)
+    {
+        int32 systemIndex = -1;
+
+        {
+            std::lock_guard<std::mutex> lock(scheduler->mutex);
+
+            if (!scheduler->readyForMainThread.empty())
+            {
+                // FIFO, so main thread systems run in the order they were added
+                systemIndex = scheduler->readyForMainThread.front();
+                scheduler->readyForMainThread.erase(scheduler->readyForMainThread.begin());
+            }
+        }
+
+        if (systemIndex >= 0)
+        {
+            scheduler->systems[systemIndex].update();
+            finishSystem(scheduler, systemIndex);
+        }
+        else if (!tryRunJob(scheduler->jobs))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "als/als_types.h"
+#include "als/als_job_system.h"
+#include "ecs/Archetype.h"
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <mutex>
+
+struct Ecs;
+
+//
+// Runs a frame's worth of systems as a dependency graph. Each system declares the component types it reads and
+// writes (and which ECS it touches). Two systems conflict if they touch the same ECS and one writes something the
+// other reads or writes. Conflicting systems run in the order they were added, everything else is free to run
+// concurrently as jobs on the job system.
+//
+// @Note: Reading a transform's world values lazily updates its cache when it's dirty. The scheduler refreshes the caches
+//        (refreshWorldTransforms(..)) before the first system runs and after every system that writes transforms, so
+//        systems that only read them really do only read, and can run at the same time. Systems that write transforms
+//        without being confined to one ECS have to leave them refreshed themselves, like updateWorldMatrices(..) does.
+//
+
+enum SystemFlags : uint32
+{
+    SystemFlag_None = 0,
+
+    // Must run on the main thread. Anything that touches GL, ImGui, GLFW or the temp allocator
+    SystemFlag_MainThreadOnly = 1 << 0,
+
+    // Adds/removes components or makes/deletes entities. Conflicts with every other system on the same ECS
+    // and with every other structural system, since entity ids are allocated globally.
+    SystemFlag_Structural = 1 << 1,
+};
+
+struct SystemDesc
+{
+    const char* name = "";
+
+    // nullptr means the system isn't confined to one ECS, and conflicts with everything that overlaps its
+    // read/write sets in any ECS
+    Ecs* ecs = nullptr;
+
+    ComponentMask reads = 0;
+    ComponentMask writes = 0;
+    uint32 flags = SystemFlag_None;
+
+    std::function<void()> update;
+};
+
+struct SystemScheduler
+{
+    JobSystem* jobs = nullptr;
+
+    std::vector<SystemDesc> systems;
+
+    //
+    // Per-run graph state
+    //
+    std::vector<std::vector<uint32>> dependents;
+    std::vector<uint32> unfinishedDependencyCount;
+
+    std::mutex mutex; // Guards unfinishedDependencyCount and readyForMainThread
+    std::vector<uint32> readyForMainThread;
+    std::atomic<uint32> finishedCount { 0 };
+};
+
+void initSystemScheduler(SystemScheduler* scheduler, JobSystem* jobs);
+
+void clearSystems(SystemScheduler* scheduler);
+void addSystem(SystemScheduler* scheduler, SystemDesc system);
+
+// Blocks until every system added since the last clearSystems(..) has run
+void runSystems(SystemScheduler* scheduler);
+
+bool systemsConflict(const SystemDesc& a, const SystemDesc& b);
@@ -102,11 +102,20 @@ Shader* ResourceManager::initShader(FilenameString vertFilename, FilenameString
     return initResource(shader, shaders, loadNow);
 }
 
-Mesh* ResourceManager::initMesh(FilenameString relFilename, bool useMaterialsRefrencedInObjFile, MeshLoadOptions loadNow)
+Mesh* ResourceManager::initMesh(FilenameString relFilename, bool useMaterialsRefrencedInObjFile, MeshLoadOptions loadNow, bool withTriangleBvhs)
 {
     Mesh m(relFilename, useMaterialsRefrencedInObjFile);
+    m.withTriangleBvhs = withTriangleBvhs;
+
     Mesh* result = initResource(m, meshes, loadNow == MeshLoadOptions::CPU || loadNow == MeshLoadOptions::CPU_AND_GPU);
 
+    // Already existed without them
+    if (withTriangleBvhs && !result->withTriangleBvhs)
+    {
+        result->withTriangleBvhs = true;
+        if (result->isLoaded) buildTriangleBvhs(result);
+    }
+
     if (loadNow == MeshLoadOptions::CPU_AND_GPU)
     {
         uploadToGpuOpenGl(result);
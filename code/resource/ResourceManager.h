@@ -52,7 +52,7 @@ struct ResourceManager
     Texture* initTexture(FilenameString relFilename, bool gammaCorrect, bool loadNow);
     Texture* getTexture(ResourceIdString relFilename);
     
-    Mesh* initMesh(FilenameString relFilename, bool useMaterialsRefrencedInObjFile, MeshLoadOptions loadNow);
+    Mesh* initMesh(FilenameString relFilename, bool useMaterialsRefrencedInObjFile, MeshLoadOptions loadNow, bool withTriangleBvhs=false);
     Mesh* initMesh(FilenameString filename, string64 subObjectName);
     Mesh* getMesh(ResourceIdString relFilename);
     
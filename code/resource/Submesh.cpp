@@ -243,6 +243,16 @@ void recalculatePositionsRelativeToCentroid(Submesh* submesh, Vec3 centroid)
     }
 
     recalculateBounds(submesh);
+
+    if (isBuilt(&submesh->triangleBvh))
+    {
+        buildTriangleBvh(submesh);
+    }
+}
+
+void buildTriangleBvh(Submesh* submesh)
+{
+    buildTriangleBvh(&submesh->triangleBvh, submesh->vertices, submesh->indices);
 }
 
 void reuploadModifiedVerticesToGpu(Submesh* submesh)
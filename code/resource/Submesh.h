@@ -8,6 +8,7 @@
 #include "Resource.h"
 
 #include "Aabb.h"
+#include "TriangleBvh.h"
 
 struct Mesh;
 struct Material;
@@ -36,6 +37,9 @@ struct Submesh
 
     Aabb bounds;
 
+    // Optional, see buildTriangleBvh(..)
+    TriangleBvh triangleBvh;
+
     Mesh* mesh;
     Material* material;
 
@@ -50,6 +54,9 @@ void uploadToGpuOpenGl(Submesh* submesh);
 void recalculatePositionsRelativeToCentroid(Submesh* submesh, Vec3 centroid);
 void recalculateBounds(Submesh* submesh);
 
+// For raycasts against the triangles. Has to be rebuilt whenever the vertices move.
+void buildTriangleBvh(Submesh* submesh);
+
 // Note: only works after MODIFYING vertices... do NOT
 // add/remove vertices and then call this
 void reuploadModifiedVerticesToGpu(Submesh* submesh);
@@ -46,6 +46,12 @@ bool load(Mesh* mesh)
 
     loadObjIntoMesh(mesh->filename, mesh);
     recalculateBounds(mesh);
+
+    if (mesh->withTriangleBvhs)
+    {
+        buildTriangleBvhs(mesh);
+    }
+
     mesh->isLoaded = true;
 
     return true;
@@ -103,6 +109,14 @@ void recalculateBounds(Mesh* mesh)
     mesh->bounds.center = minPoint + mesh->bounds.halfDim;
 }
 
+void buildTriangleBvhs(Mesh* mesh)
+{
+    for (Submesh& submesh : mesh->submeshes)
+    {
+        buildTriangleBvh(&submesh);
+    }
+}
+
 bool isUploadedToGpuOpenGl(Mesh* mesh)
 {
     if (mesh) return false;
@@ -14,6 +14,7 @@ struct Mesh
     Mesh(FilenameString filename, string64 subObjectName); // from a specific point in the obj file until it reaches the next "o" or eof
     
     bool useMaterialsReferencedInObjFile = false;
+    bool withTriangleBvhs = false; // Build each submesh's triangle BVH when loading
     bool isLoaded = false;
     ResourceIdString id;
     FilenameString filename;
@@ -31,6 +32,8 @@ bool unload(Mesh* mesh);
 void recalculatePositionsRelativeToCentroid(Mesh* mesh, Vec3 centroid);
 void recalculateBounds(Mesh* mesh);
 
+void buildTriangleBvhs(Mesh* mesh);
+
 bool isUploadedToGpuOpenGl(Mesh* mesh);
 void uploadToGpuOpenGl(Mesh* mesh);
 
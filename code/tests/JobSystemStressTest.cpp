@@ -0,0 +1,88 @@
+//
+// Headless stress test for the job system. Only links als_job_system, so it builds and runs without a window, GL or
+// any of the game. See the Makefile next to this file.
+//
+
+#include "als/als_types.h"
+#include "als/als_job_system.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Unlike assert, stays in release builds and reports the line instead of aborting
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); failureCount++; } } while (0)
+
+static uint32 failureCount = 0;
+
+// parallelFor touches every index exactly once
+static void testParallelFor(JobSystem* jobs, uint32 round)
+{
+    const uint32 count = 10000 + round * 37;
+    std::vector<uint32> hits(count, 0);
+
+    parallelFor(jobs, count, 64, [&hits](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; i++) hits[i]++;
+    });
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        if (hits[i] != 1)
+        {
+            CHECK(hits[i] == 1);
+            break;
+        }
+    }
+}
+
+// Nested jobs that wait on their own sub-jobs
+static void testNestedJobs(JobSystem* jobs)
+{
+    std::atomic<uint32> leafCount(0);
+    JobCounter outer;
+
+    for (uint32 i = 0; i < 16; i++)
+    {
+        submitJob(jobs, [jobs, &leafCount]()
+        {
+            JobCounter inner;
+            for (uint32 j = 0; j < 16; j++)
+            {
+                submitJob(jobs, [&leafCount]() { leafCount++; }, &inner);
+            }
+
+            waitForCounter(jobs, &inner);
+        }, &outer);
+    }
+
+    waitForCounter(jobs, &outer);
+    CHECK(leafCount == 16 * 16);
+}
+
+int main()
+{
+    JobSystem jobs;
+    uint32 hardwareThreads = std::thread::hardware_concurrency();
+    initJobSystem(&jobs, hardwareThreads > 1 ? hardwareThreads - 1 : 3);
+
+    const uint32 roundCount = 200;
+    for (uint32 round = 0; round < roundCount && failureCount == 0; round++)
+    {
+        testParallelFor(&jobs, round);
+        testNestedJobs(&jobs);
+    }
+
+    shutdownJobSystem(&jobs);
+
+    if (failureCount > 0)
+    {
+        printf("Job system stress test: %u failures\n", failureCount);
+        return 1;
+    }
+
+    printf("Job system stress test: %u rounds on %u workers passed\n", roundCount, hardwareThreads > 1 ? hardwareThreads : 4);
+    return 0;
+}